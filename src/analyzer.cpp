@@ -0,0 +1,400 @@
+// 对局分析工具:读取对局记录,用搜索引擎重新计算每一盘每一步之前的局面,找出失误和形势的大起大落
+// 读取线程逐盘读出对局放进有界队列,每个分析线程持有自己的搜索引擎,从队列中取出整盘分析;
+// 内存中最多只有队列容量加上线程数那么多盘棋,多大的记录文件都可以流式处理
+// 每盘开始时清空置换表,同一盘的分析结果与线程数和调度顺序无关
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "engine/search.h"
+#include "engine/record.h"
+
+// 胜负已定的分数(见SCORE_WIN)都截到这个值,不区分几步成五,也避免很大的分数参与减法
+const int ANALYSIS_WIN_SCORE = 100000;
+
+// 每个局面根节点威胁空间搜索的默认节点预算:引擎默认的20000个节点占去分析的大部分时间,
+// 批量分析时每秒的局面数差六倍多,找出的失误基本相同
+const long long ANALYSIS_THREAT_NODES = 2000;
+
+// 分析选项
+struct AnalysisConfig
+{
+    int depth = 4;          // 每个局面搜索的深度
+    int blunder = 1500;     // 走棋一方的分数下降至少这么多,且与引擎的走法不同时算失误
+    int swing = 3000;       // 相邻两个局面的分数变化至少这么多时算大起大落
+    int skipPlies = 4;      // 跳过每盘开头的几步,开局的分数没有参考价值
+    bool quiet = false;     // 只输出汇总
+    bool dump = false;      // 记下每个局面的搜索分数,写成神经网络评估的训练样本
+};
+
+// 一盘棋中发现的一处问题
+struct Finding
+{
+    int ply;                   // 第几步(从0开始)
+    Piece side;                // 走棋一方
+    std::pair<int, int> move;  // 实际的走法
+    std::pair<int, int> best;  // 引擎的走法
+    int before;                // 走之前的分数,黑方视角
+    int after;                 // 走之后的分数,黑方视角
+    bool blunder;              // 失误,否则是大起大落
+};
+
+// 一盘棋的分析结果
+struct GameReport
+{
+    long long index = 0;
+    int positions = 0;
+    std::vector<Finding> findings;
+    std::vector<std::pair<int, int>> samples; // 导出的训练样本:(局面之前的步数, 搜索分数,黑方视角)
+};
+
+// 有界队列:读取线程放入,分析线程取出;满时放入等待,关闭且为空时取出返回false
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t maxSize) : capacity(maxSize) {}
+
+    void Push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]()
+                     { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+    }
+
+    bool Pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]()
+                      { return !items.empty() || closed; });
+        if (items.empty())
+            return false;
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // 不再放入,等待中的取出在队列取空后返回false
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+struct QueuedGame
+{
+    long long index;
+    GameRecord game;
+};
+
+int ClampScore(int score)
+{
+    return std::max(-ANALYSIS_WIN_SCORE, std::min(score, ANALYSIS_WIN_SCORE));
+}
+
+// 分析一盘棋:从头摆棋,搜索每一步之前的局面,再比较相邻两个局面的分数
+template <int N>
+GameReport AnalyzeGame(SearchEngineT<N> &engine, const GameRecord &game, const AnalysisConfig &analysis)
+{
+    GameReport report;
+    engine.NewGame();
+    PositionT<N> pos;
+    pos.Clear();
+    std::vector<int> scores;
+    std::vector<std::pair<int, int>> bestMoves;
+    Piece side = PIECE_BLACK;
+    for (size_t ply = 0; ply < game.moves.size(); ply++)
+    {
+        int x = game.moves[ply].first, y = game.moves[ply].second;
+        if (!pos.board.IsEmpty(x, y))
+            break;
+        if ((int)ply >= analysis.skipPlies)
+        {
+            SearchResult result = engine.Think(pos, side, analysis.depth);
+            scores.push_back(ClampScore(result.score));
+            // 胜负已定的局面分数不连续,不适合拟合
+            if (analysis.dump && !IsWinScore(result.score))
+                report.samples.push_back({(int)ply, result.score});
+            bestMoves.push_back(result.bestMove);
+            report.positions++;
+        }
+        else
+        {
+            scores.push_back(0);
+            bestMoves.push_back({-1, -1});
+        }
+        pos.MakeMove(x, y, side);
+        // 成五之后没有局面可以搜索,最后一步不参与比较
+        if (pos.CheckWin(x, y))
+            break;
+        side = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    }
+
+    // 威胁空间搜索只替轮到的一方找必胜,对方已经必胜的局面常常只得到普通的分数,
+    // 所以必胜的分数会隔一步出现一次;看相邻两个局面中的任意一个,
+    // 同一方在这一步之前和之后都已经必胜时,这一步没有改变胜负,不算问题
+    auto decided = [&](size_t j)
+    {
+        if (j < (size_t)analysis.skipPlies || j >= scores.size())
+            return PIECE_EMPTY;
+        return scores[j] == ANALYSIS_WIN_SCORE ? PIECE_BLACK : scores[j] == -ANALYSIS_WIN_SCORE ? PIECE_WHITE : PIECE_EMPTY;
+    };
+    for (size_t i = analysis.skipPlies; i + 1 < scores.size(); i++)
+    {
+        Piece winnerBefore = decided(i) != PIECE_EMPTY ? decided(i) : decided(i - 1);
+        Piece winnerAfter = decided(i + 1) != PIECE_EMPTY ? decided(i + 1) : decided(i + 2);
+        if (winnerBefore != PIECE_EMPTY && winnerBefore == winnerAfter)
+            continue;
+        Piece mover = (i % 2 == 0) ? PIECE_BLACK : PIECE_WHITE;
+        int before = scores[i], after = scores[i + 1];
+        int loss = (mover == PIECE_BLACK) ? before - after : after - before;
+        bool blunder = loss >= analysis.blunder && game.moves[i] != bestMoves[i];
+        if (blunder || std::abs(after - before) >= analysis.swing)
+            report.findings.push_back({(int)i, mover, game.moves[i], bestMoves[i], before, after, blunder});
+    }
+    return report;
+}
+
+// 分析线程:每种棋盘大小的搜索引擎在第一次用到时创建
+class AnalysisWorker
+{
+public:
+    AnalysisWorker(const AIConfig &engineConfig, const AnalysisConfig &analysisConfig)
+        : config(engineConfig), analysis(analysisConfig) {}
+
+    GameReport Analyze(const QueuedGame &queued)
+    {
+        GameReport report;
+        if (queued.game.boardSize == 19)
+            report = AnalyzeGame(Engine(engine19), queued.game, analysis);
+        else
+            report = AnalyzeGame(Engine(engine15), queued.game, analysis);
+        report.index = queued.index;
+        return report;
+    }
+
+private:
+    AIConfig config;
+    AnalysisConfig analysis;
+    std::unique_ptr<SearchEngineT<15>> engine15;
+    std::unique_ptr<SearchEngineT<19>> engine19;
+
+    template <int N>
+    SearchEngineT<N> &Engine(std::unique_ptr<SearchEngineT<N>> &engine)
+    {
+        if (!engine)
+        {
+            engine.reset(new SearchEngineT<N>());
+            // 启动时已经检查过文件,这里只会是网络的棋盘大小不同,改用棋型评估
+            if (!engine->Configure(config))
+                std::cerr << "warning: " << engine->ConfigError() << std::endl;
+        }
+        return *engine;
+    }
+};
+
+const char *SideName(Piece side)
+{
+    return side == PIECE_BLACK ? "black" : "white";
+}
+
+// 训练样本每行一个局面: <棋盘大小> <对局结果> <搜索分数> <x,y>...
+// 对局结果和分数都是黑方视角,结果1为黑胜,0为白胜,0.5为和棋或未下完;走法从黑方开始黑白交替,摆完就是这个局面
+void WriteSamples(FILE *file, const GameRecord &game, const GameReport &report)
+{
+    const char *result = game.winner == PIECE_BLACK ? "1" : game.winner == PIECE_WHITE ? "0" : "0.5";
+    for (const auto &sample : report.samples)
+    {
+        fprintf(file, "%d %s %d", game.boardSize, result, sample.second);
+        for (int i = 0; i < sample.first; i++)
+            fprintf(file, " %d,%d", game.moves[i].first, game.moves[i].second);
+        fprintf(file, "\n");
+    }
+}
+
+void PrintReport(const GameReport &report)
+{
+    for (const Finding &f : report.findings)
+    {
+        int delta = (f.side == PIECE_BLACK) ? f.after - f.before : f.before - f.after;
+        printf("game %lld ply %d %s (%d,%d) %s %+d: %d -> %d", report.index, f.ply, SideName(f.side),
+               f.move.first, f.move.second, f.blunder ? "blunder" : "swing", delta, f.before, f.after);
+        if (f.blunder)
+            printf(", best (%d,%d)", f.best.first, f.best.second);
+        printf("\n");
+    }
+}
+
+// 主函数
+// 用法: gomoku-analyze [选项] <记录文件>...
+// 可选参数:
+//   --depth <d>      每个局面搜索的深度(默认4)
+//   --workers <n>    分析线程数(默认为CPU核数),每个线程的搜索引擎是单线程的
+//   --blunder <n>    失误的阈值:走棋一方的分数下降至少n,且与引擎的走法不同(默认1500)
+//   --swing <n>      大起大落的阈值:相邻两个局面的分数变化至少n(默认3000)
+//   --skip <n>       跳过每盘开头的n步(默认4)
+//   --max-games <n>  最多分析n盘,0表示不限
+//   --quiet          只输出汇总
+//   --dump <file>    把每个局面和它的搜索分数写成神经网络评估的训练样本(文本,每行一个局面)
+//   --hash <MB> 以及威胁空间搜索的参数与图形界面相同,置换表是每个线程各一份(默认16MB),
+//                    --threat-nodes 默认2000,比图形界面小
+int main(int argc, char *argv[])
+{
+    AIConfig config;
+    config.hashMegabytes = 16;
+    config.moveTimeMs = 0;
+    config.threatNodes = ANALYSIS_THREAT_NODES;
+    config.threatTimeMs = 0; // 只用节点预算,结果不受机器快慢影响
+    AnalysisConfig analysis;
+    int workers = std::max((int)std::thread::hardware_concurrency(), 1);
+    long long maxGames = 0;
+    std::vector<std::string> paths;
+    std::string dumpPath;
+    for (int i = 1; i < argc; i++)
+    {
+        if (ParseAIConfigArg(argc, argv, i, config))
+            continue;
+        if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+            analysis.depth = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+            workers = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--blunder") == 0 && i + 1 < argc)
+            analysis.blunder = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--swing") == 0 && i + 1 < argc)
+            analysis.swing = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc)
+            analysis.skipPlies = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--max-games") == 0 && i + 1 < argc)
+            maxGames = std::max(atoll(argv[++i]), 0LL);
+        else if (strcmp(argv[i], "--quiet") == 0)
+            analysis.quiet = true;
+        else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+            dumpPath = argv[++i];
+        else if (argv[i][0] == '-')
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+    {
+        std::cerr << "usage: gomoku-analyze [--depth <d>] [--workers <n>] <records>..." << std::endl;
+        return 1;
+    }
+    std::string error;
+    if (!CheckAIConfigFiles(config, 0, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    // 分析只看搜索的结果,不查开局库,每个引擎单线程
+    config.bookPath.clear();
+    config.threads = 1;
+    FILE *dumpFile = nullptr;
+    if (!dumpPath.empty())
+    {
+        dumpFile = fopen(dumpPath.c_str(), "w");
+        if (!dumpFile)
+        {
+            std::cerr << "cannot write " << dumpPath << std::endl;
+            return 1;
+        }
+        analysis.dump = true;
+    }
+
+    BoundedQueue<QueuedGame> queue((size_t)workers * 2);
+    std::mutex outputMutex;
+    std::atomic<long long> gamesDone(0), positions(0), blunders(0), swings(0), samples(0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; w++)
+    {
+        threads.emplace_back([&]()
+                             {
+                                 AnalysisWorker worker(config, analysis);
+                                 QueuedGame queued;
+                                 while (queue.Pop(queued))
+                                 {
+                                     GameReport report = worker.Analyze(queued);
+                                     long long found = 0;
+                                     for (const Finding &f : report.findings)
+                                         found += f.blunder ? 1 : 0;
+                                     blunders += found;
+                                     swings += (long long)report.findings.size() - found;
+                                     positions += report.positions;
+                                     samples += (long long)report.samples.size();
+                                     gamesDone++;
+                                     std::lock_guard<std::mutex> lock(outputMutex);
+                                     if (!analysis.quiet)
+                                         PrintReport(report);
+                                     if (dumpFile)
+                                         WriteSamples(dumpFile, queued.game, report);
+                                 } });
+    }
+
+    long long index = 0;
+    bool ok = true;
+    for (const std::string &path : paths)
+    {
+        GameRecordReader reader;
+        if (!reader.Open(path))
+        {
+            std::cerr << "cannot open records " << path << std::endl;
+            ok = false;
+            continue;
+        }
+        QueuedGame queued;
+        while ((maxGames == 0 || index < maxGames) && reader.Next(queued.game))
+        {
+            queued.index = index++;
+            queue.Push(queued);
+        }
+        if (reader.Corrupted())
+        {
+            std::cerr << "corrupted record in " << path << " after " << index << " games" << std::endl;
+            ok = false;
+        }
+    }
+    queue.Close();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    if (dumpFile && fclose(dumpFile) != 0)
+    {
+        std::cerr << "cannot write " << dumpPath << std::endl;
+        ok = false;
+    }
+    else if (dumpFile)
+        printf("%lld samples -> %s\n", samples.load(), dumpPath.c_str());
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("games %lld  positions %lld  blunders %lld  swings %lld  time %.1fs  %.0f positions/s  workers %d\n",
+           gamesDone.load(), positions.load(), blunders.load(), swings.load(), seconds,
+           seconds > 0 ? positions.load() / seconds : 0.0, workers);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+// 资源包:把音效等资源文件打成一个带索引的文件,程序启动时只读索引,用到哪个资源再读哪个
+// 文件格式(小端):
+//   文件头 AssetPackHeader,16字节
+//   count条 AssetPackEntry,每条64字节
+//   各资源的数据,位置和长度由索引给出
+// 资源按文件名查找,不区分大小写
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <utility>
+#include <vector>
+
+const char ASSET_PACK_MAGIC[8] = {'G', 'M', 'K', 'P', 'A', 'C', 'K', '1'};
+const uint32_t ASSET_PACK_VERSION = 1;
+const int ASSET_NAME_LENGTH = 48; // 文件名最长47个字符
+
+struct AssetPackHeader
+{
+    char magic[8];    // ASSET_PACK_MAGIC
+    uint32_t version; // ASSET_PACK_VERSION
+    uint32_t count;   // 资源个数
+};
+
+struct AssetPackEntry
+{
+    char name[ASSET_NAME_LENGTH]; // 文件名,不含目录,以0结尾
+    uint64_t offset;              // 数据在文件中的位置
+    uint64_t size;                // 数据长度
+};
+
+static_assert(sizeof(AssetPackHeader) == 16 && sizeof(AssetPackEntry) == 64, "资源包的文件格式依赖这两个结构的大小");
+
+inline bool SameAssetName(const char *a, const char *b)
+{
+    for (; *a && *b; a++, b++)
+    {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b))
+            return false;
+    }
+    return *a == *b;
+}
+
+// 读整个文件,失败时返回false
+inline bool ReadWholeFile(const std::string &path, std::vector<unsigned char> &data)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? (size_t)size : 0);
+    bool ok = size > 0 && fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return ok;
+}
+
+// 只读的资源包,Open只读索引,Read时才读对应的数据
+class AssetPack
+{
+public:
+    // 索引中的个数,位置和长度都要落在文件之内,否则当作损坏的资源包,不按它分配内存
+    bool Open(const std::string &packPath)
+    {
+        entries.clear();
+        path = packPath;
+        FILE *file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+        bool ok = fseek(file, 0, SEEK_END) == 0;
+        long fileSize = ok ? ftell(file) : -1;
+        ok = fileSize >= (long)sizeof(AssetPackHeader) && fseek(file, 0, SEEK_SET) == 0;
+        AssetPackHeader header;
+        ok = ok && fread(&header, sizeof(header), 1, file) == 1 &&
+             memcmp(header.magic, ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC)) == 0 &&
+             header.version == ASSET_PACK_VERSION &&
+             header.count <= ((uint64_t)fileSize - sizeof(AssetPackHeader)) / sizeof(AssetPackEntry);
+        if (ok)
+        {
+            entries.resize(header.count);
+            ok = header.count == 0 || fread(entries.data(), sizeof(AssetPackEntry), header.count, file) == header.count;
+        }
+        for (size_t i = 0; ok && i < entries.size(); i++)
+        {
+            const AssetPackEntry &entry = entries[i];
+            ok = memchr(entry.name, 0, sizeof(entry.name)) != nullptr && entry.offset <= (uint64_t)fileSize &&
+                 entry.size <= (uint64_t)fileSize - entry.offset;
+        }
+        fclose(file);
+        if (!ok)
+            entries.clear();
+        return ok;
+    }
+
+    bool IsOpen() const { return !entries.empty(); }
+
+    // 按文件名读取资源的数据,资源不存在或读取失败时返回false
+    bool Read(const char *name, std::vector<unsigned char> &data) const
+    {
+        for (const AssetPackEntry &entry : entries)
+        {
+            if (!SameAssetName(entry.name, name))
+                continue;
+            FILE *file = fopen(path.c_str(), "rb");
+            if (!file)
+                return false;
+            data.resize((size_t)entry.size);
+            bool ok = fseek(file, (long)entry.offset, SEEK_SET) == 0 &&
+                      fread(data.data(), 1, data.size(), file) == data.size();
+            fclose(file);
+            return ok;
+        }
+        return false;
+    }
+
+private:
+    std::string path;
+    std::vector<AssetPackEntry> entries;
+};
+
+// 把若干(文件名,数据)写成资源包
+inline bool WriteAssetPack(const std::string &path, const std::vector<std::pair<std::string, std::vector<unsigned char>>> &assets)
+{
+    AssetPackHeader header;
+    memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC));
+    header.version = ASSET_PACK_VERSION;
+    header.count = (uint32_t)assets.size();
+    std::vector<AssetPackEntry> entries(assets.size());
+    uint64_t offset = sizeof(AssetPackHeader) + assets.size() * sizeof(AssetPackEntry);
+    for (size_t i = 0; i < assets.size(); i++)
+    {
+        if (assets[i].first.size() >= (size_t)ASSET_NAME_LENGTH)
+            return false;
+        memset(entries[i].name, 0, sizeof(entries[i].name));
+        memcpy(entries[i].name, assets[i].first.c_str(), assets[i].first.size());
+        entries[i].offset = offset;
+        entries[i].size = assets[i].second.size();
+        offset += assets[i].second.size();
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (entries.empty() || fwrite(entries.data(), sizeof(AssetPackEntry), entries.size(), file) == entries.size());
+    for (size_t i = 0; ok && i < assets.size(); i++)
+        ok = assets[i].second.empty() || fwrite(assets[i].second.data(), 1, assets[i].second.size(), file) == assets[i].second.size();
+    return fclose(file) == 0 && ok;
+}
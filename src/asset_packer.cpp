@@ -0,0 +1,49 @@
+// 资源打包工具:把给出的文件按文件名(不含目录)打成一个资源包
+// 用法: gomoku-pack --out <pack> <file>...
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "asset_pack.h"
+
+int main(int argc, char *argv[])
+{
+    std::string outPath;
+    std::vector<std::pair<std::string, std::vector<unsigned char>>> assets;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            outPath = argv[++i];
+            continue;
+        }
+        std::string path = argv[i];
+        size_t slash = path.find_last_of("/\\");
+        std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+        std::vector<unsigned char> data;
+        if (!ReadWholeFile(path, data))
+        {
+            std::cerr << "cannot read " << path << std::endl;
+            return 1;
+        }
+        assets.emplace_back(name, data);
+    }
+    if (outPath.empty() || assets.empty())
+    {
+        std::cerr << "usage: gomoku-pack --out <pack> <file>..." << std::endl;
+        return 1;
+    }
+    if (!WriteAssetPack(outPath, assets))
+    {
+        std::cerr << "cannot write " << outPath << std::endl;
+        return 1;
+    }
+    size_t total = 0;
+    for (const auto &asset : assets)
+    {
+        std::cout << asset.first << " " << asset.second.size() << " bytes" << std::endl;
+        total += asset.second.size();
+    }
+    std::cout << assets.size() << " assets, " << total << " bytes -> " << outPath << std::endl;
+    return 0;
+}
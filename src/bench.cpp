@@ -0,0 +1,510 @@
+// 搜索基准测试:在一组固定局面上运行搜索,输出节点数,速度,到达各深度的用时,分支因子和最佳走法
+// 修改搜索,评估或走法生成之后,用它比较速度;用节点数签名检查搜索行为是否被意外改变
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "engine/search.h"
+#include "engine/line_kernel.h"
+
+// 基准局面,落子序列黑白交替,从黑方开始
+struct BenchPosition
+{
+    std::string name;
+    std::string category; // opening(开局), midgame(中局), tactical(战术)
+    std::vector<std::pair<int, int>> moves;
+};
+
+// 内置的局面集合,修改它会改变签名
+const std::vector<BenchPosition> DEFAULT_CORPUS = {
+    {"open-center", "opening", {{7, 7}, {8, 8}}},
+    {"open-direct", "opening", {{7, 7}, {7, 8}, {8, 8}}},
+    {"open-indirect", "opening", {{7, 7}, {8, 8}, {8, 6}, {6, 8}}},
+    {"open-flower", "opening", {{7, 7}, {8, 8}, {7, 8}, {7, 6}}},
+    {"mid-row", "midgame", {{7, 7}, {8, 6}, {8, 7}, {6, 7}, {9, 7}, {10, 7}}},
+    {"mid-diagonal", "midgame", {{7, 7}, {7, 8}, {8, 8}, {6, 6}, {9, 9}, {10, 10}, {8, 6}, {8, 7}}},
+    {"mid-cluster", "midgame", {{7, 7}, {6, 8}, {8, 8}, {9, 9}, {8, 6}, {8, 7}, {6, 6}, {7, 6}, {9, 7}}},
+    {"mid-spread", "midgame", {{7, 7}, {8, 7}, {7, 8}, {7, 6}, {6, 9}, {5, 10}, {8, 8}, {9, 9}, {6, 8}, {5, 8}}},
+    {"mid-crowded", "midgame", {{7, 7}, {7, 8}, {8, 7}, {6, 7}, {8, 8}, {9, 9}, {8, 6}, {8, 9}, {9, 6}, {6, 9}, {10, 5}, {11, 4}, {6, 6}, {5, 5}, {9, 7}, {10, 8}}},
+    {"mid-edge", "midgame", {{2, 2}, {3, 3}, {2, 3}, {2, 4}, {3, 2}, {4, 1}, {4, 2}, {5, 2}, {1, 3}, {4, 4}}},
+    {"tac-win-in-1", "tactical", {{7, 7}, {6, 7}, {8, 7}, {8, 8}, {9, 7}, {9, 9}, {10, 7}, {7, 9}}},
+    {"tac-block-four", "tactical", {{7, 7}, {8, 8}, {7, 8}, {6, 6}, {7, 6}, {7, 5}, {7, 9}}},
+    {"tac-block-three", "tactical", {{7, 7}, {8, 8}, {7, 8}, {6, 6}, {7, 6}}},
+    {"tac-double-three", "tactical", {{7, 7}, {6, 6}, {8, 7}, {5, 5}, {9, 8}, {10, 10}, {9, 9}, {4, 4}}},
+};
+
+// 从文件读取局面集合,每行为"名字 类别 x,y x,y ...",空行和#开头的行忽略
+bool LoadCorpus(const std::string &path, std::vector<BenchPosition> &corpus)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "cannot open corpus " << path << std::endl;
+        return false;
+    }
+    corpus.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        std::istringstream in(line);
+        BenchPosition position;
+        if (!(in >> position.name) || position.name[0] == '#')
+            continue;
+        in >> position.category;
+        std::string coords;
+        while (in >> coords)
+        {
+            int x, y;
+            if (sscanf(coords.c_str(), "%d,%d", &x, &y) != 2)
+            {
+                std::cerr << path << ":" << lineNumber << ": bad move " << coords << std::endl;
+                return false;
+            }
+            position.moves.emplace_back(x, y);
+        }
+        corpus.push_back(position);
+    }
+    return !corpus.empty();
+}
+
+// 按落子序列摆出局面,返回轮到走棋的一方;序列不合法或对局已经结束时返回PIECE_EMPTY
+Piece SetupPosition(const BenchPosition &bench, Position &pos)
+{
+    pos.Clear();
+    Piece side = PIECE_BLACK;
+    for (const auto &move : bench.moves)
+    {
+        int x = move.first, y = move.second;
+        if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE || !pos.board.IsEmpty(x, y))
+            return PIECE_EMPTY;
+        pos.MakeMove(x, y, side);
+        if (pos.CheckWin(x, y))
+            return PIECE_EMPTY;
+        side = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    }
+    return side;
+}
+
+// 有效分支因子:最后一层新增的节点数与前一层新增的节点数之比,不足两层时为0
+double BranchingFactor(const std::vector<IterationInfo> &iterations)
+{
+    size_t n = iterations.size();
+    if (n < 2)
+        return 0;
+    long long last = iterations[n - 1].nodes - iterations[n - 2].nodes;
+    long long previous = iterations[n - 2].nodes - (n >= 3 ? iterations[n - 3].nodes : 0);
+    return previous > 0 ? (double)last / previous : 0;
+}
+
+long long NodesPerSecond(long long nodes, double timeMs)
+{
+    return timeMs > 0 ? (long long)(nodes * 1000.0 / timeMs) : 0;
+}
+
+// 一个局面的测试结果
+struct BenchRecord
+{
+    const BenchPosition *position;
+    Piece side;
+    SearchResult result;
+};
+
+// 一轮测试:固定深度或固定时间,对每个局面都从新的一局开始,结果不受前一个局面影响
+struct BenchRun
+{
+    std::string mode; // "depth" 或 "time"
+    int limit;        // 深度或毫秒
+    std::vector<BenchRecord> records;
+    long long totalNodes = 0;
+    double totalMs = 0;
+};
+
+BenchRun RunSuite(const std::vector<BenchPosition> &corpus, AIConfig config, const std::string &mode, int limit)
+{
+    BenchRun run;
+    run.mode = mode;
+    run.limit = limit;
+    config.moveTimeMs = (mode == "time") ? limit : 0;
+    config.moveNodes = 0;
+    // 固定深度测试只按节点数限制威胁空间搜索,保证结果与机器速度无关
+    if (mode == "depth")
+        config.threatTimeMs = 0;
+    SearchEngine engine;
+    engine.Configure(config);
+    for (const auto &bench : corpus)
+    {
+        Position pos;
+        Piece side = SetupPosition(bench, pos);
+        if (side == PIECE_EMPTY)
+        {
+            std::cerr << "skipping invalid position " << bench.name << std::endl;
+            continue;
+        }
+        engine.NewGame();
+        BenchRecord record;
+        record.position = &bench;
+        record.side = side;
+        record.result = (mode == "depth") ? engine.Think(pos, side, limit) : engine.Think(pos, side);
+        run.totalNodes += record.result.nodes;
+        run.totalMs += record.result.timeMs;
+        run.records.push_back(record);
+    }
+    return run;
+}
+
+void PrintRunText(const BenchRun &run)
+{
+    if (run.mode == "depth")
+        printf("== fixed depth %d ==\n", run.limit);
+    else
+        printf("== fixed time %d ms ==\n", run.limit);
+    printf("%-18s %-9s %-5s %5s %8s %12s %10s %10s %9s %6s  %s\n",
+           "position", "category", "side", "depth", "best", "score", "nodes", "time(ms)", "nps", "ebf", "time-to-depth(ms)");
+    double ebfSum = 0;
+    int ebfCount = 0;
+    for (const auto &record : run.records)
+    {
+        const SearchResult &result = record.result;
+        char best[16];
+        snprintf(best, sizeof(best), "(%d,%d)", result.bestMove.first, result.bestMove.second);
+        double ebf = BranchingFactor(result.iterations);
+        if (ebf > 0)
+        {
+            ebfSum += ebf;
+            ebfCount++;
+        }
+        printf("%-18s %-9s %-5s %5d %8s %12d %10lld %10.1f %9lld %6.2f ",
+               record.position->name.c_str(), record.position->category.c_str(),
+               record.side == PIECE_BLACK ? "black" : "white", result.depth, best, result.score,
+               result.nodes, result.timeMs, NodesPerSecond(result.nodes, result.timeMs), ebf);
+        for (const auto &iteration : result.iterations)
+            printf(" %d:%.1f", iteration.depth, iteration.timeMs);
+        printf("\n");
+    }
+    printf("total: nodes %lld  time %.1f ms  nps %lld  mean ebf %.2f\n",
+           run.totalNodes, run.totalMs, NodesPerSecond(run.totalNodes, run.totalMs),
+           ebfCount ? ebfSum / ebfCount : 0.0);
+    if (STATS_ENABLED)
+    {
+        // 剪枝按走法序号的分布,第一个走法的比例反映走法排序的质量
+        SearchCounters counters;
+        for (const auto &record : run.records)
+            counters.Add(record.result.counters);
+        long long cutoffs = counters.TotalCutoffs();
+        printf("counters: leaf evals %lld  re-searches %lld  beta cutoffs %lld  by move index",
+               counters.leafEvals.Value(), counters.reSearches.Value(), cutoffs);
+        for (int i = 0; i < CUTOFF_SLOTS; i++)
+            printf(" %.1f%%", cutoffs ? 100.0 * counters.betaCutoffs[i].Value() / cutoffs : 0.0);
+        printf("\n");
+    }
+    printf("\n");
+}
+
+std::string JsonString(const std::string &text)
+{
+    std::string out = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+void PrintRunJson(const BenchRun &run)
+{
+    printf("    {\"mode\": \"%s\", \"limit\": %d, \"total_nodes\": %lld, \"total_time_ms\": %.3f, \"nps\": %lld,\n",
+           run.mode.c_str(), run.limit, run.totalNodes, run.totalMs, NodesPerSecond(run.totalNodes, run.totalMs));
+    printf("     \"positions\": [\n");
+    for (size_t i = 0; i < run.records.size(); i++)
+    {
+        const BenchRecord &record = run.records[i];
+        const SearchResult &result = record.result;
+        printf("       {\"name\": %s, \"category\": %s, \"side\": \"%s\", \"depth\": %d, \"best\": [%d, %d], "
+               "\"score\": %d, \"nodes\": %lld, \"time_ms\": %.3f, \"nps\": %lld, \"ebf\": %.3f,\n",
+               JsonString(record.position->name).c_str(), JsonString(record.position->category).c_str(),
+               record.side == PIECE_BLACK ? "black" : "white", result.depth,
+               result.bestMove.first, result.bestMove.second, result.score, result.nodes, result.timeMs,
+               NodesPerSecond(result.nodes, result.timeMs), BranchingFactor(result.iterations));
+        printf("        \"iterations\": [");
+        for (size_t j = 0; j < result.iterations.size(); j++)
+        {
+            const IterationInfo &iteration = result.iterations[j];
+            printf("%s{\"depth\": %d, \"score\": %d, \"best\": [%d, %d], \"nodes\": %lld, \"time_ms\": %.3f}",
+                   j ? ", " : "", iteration.depth, iteration.score, iteration.bestMove.first,
+                   iteration.bestMove.second, iteration.nodes, iteration.timeMs);
+        }
+        printf("]}%s\n", i + 1 < run.records.size() ? "," : "");
+    }
+    printf("     ]}");
+}
+
+// 多线程加速比:分别用1,2,4...个线程把所有局面搜索到同一深度,比较平均用时
+void RunSmpBenchmark(const std::vector<BenchPosition> &corpus, AIConfig config, int depth, int maxThreads)
+{
+    double baseline = 0;
+    printf("threads  time-to-depth%d(ms)  speedup  nodes\n", depth);
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        config.threads = threads;
+        BenchRun run = RunSuite(corpus, config, "depth", depth);
+        double average = run.records.empty() ? 0 : run.totalMs / run.records.size();
+        if (threads == 1)
+            baseline = average;
+        printf("%7d  %18.1f  %7.2f  %lld\n", threads, average, average > 0 ? baseline / average : 0.0, run.totalNodes);
+    }
+}
+
+volatile long long evalSink;
+
+// 整盘线评估的速度:每个局面用各个实现重复计算,先核对结果与标量实现完全相同
+int RunEvalBenchmark(const std::vector<BenchPosition> &corpus, int repeat)
+{
+    int scores[4][BitBoard::LINE_COUNT], expectedScores[4][BitBoard::LINE_COUNT];
+    uint8_t fives[4][BitBoard::LINE_COUNT], expectedFives[4][BitBoard::LINE_COUNT];
+    printf("kernel   ns/board\n");
+    for (int kind = LINE_KERNEL_SCALAR; kind <= LINE_KERNEL_AVX2; kind++)
+    {
+        LineKernelKind kernel = (LineKernelKind)kind;
+        if (!LineKernelSupported(kernel))
+            continue;
+        double totalMs = 0;
+        long long boards = 0;
+        for (const auto &bench : corpus)
+        {
+            Position pos;
+            if (SetupPosition(bench, pos) == PIECE_EMPTY)
+                continue;
+            EvaluateAllLines(pos.board, LINE_KERNEL_SCALAR, PATTERNS.entries, expectedScores, expectedFives);
+            EvaluateAllLines(pos.board, kernel, PATTERNS.entries, scores, fives);
+            for (int line = 0; line < 4; line++)
+            {
+                for (int index = 0; index < IncrementalEvaluator::LineCount(line); index++)
+                {
+                    if (scores[line][index] != expectedScores[line][index] || fives[line][index] != expectedFives[line][index])
+                    {
+                        fprintf(stderr, "%s differs from scalar on %s\n", LineKernelName(kernel), bench.name.c_str());
+                        return 1;
+                    }
+                }
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeat; i++)
+            {
+                EvaluateAllLines(pos.board, kernel, PATTERNS.entries, scores, fives);
+                evalSink += scores[i & 3][i % BOARD_SIZE]; // 使用计算结果,避免循环被优化掉
+            }
+            totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            boards += repeat;
+        }
+        printf("%-8s %8.1f\n", LineKernelName(kernel), boards ? totalMs * 1e6 / boards : 0.0);
+    }
+    return 0;
+}
+
+// 神经网络评估与棋型评估的对比:叶节点评估一次和落子加悔棋一次的用时(纳秒)
+// 同时核对标量和AVX2推理的结果一致,以及增量更新的累加器与从整个棋盘重算的相同
+int RunNnueBenchmark(const std::vector<BenchPosition> &corpus, const std::string &path, int repeat)
+{
+    NnueNetwork network;
+    if (!network.Load(path) || network.BoardSize() != BOARD_SIZE)
+    {
+        std::cerr << "cannot load network " << path << std::endl;
+        return 1;
+    }
+    double patternEvalMs = 0, patternMoveMs = 0, nnueMoveMs = 0;
+    double nnueEvalMs[LINE_KERNEL_AVX2 + 1] = {};
+    long long count = 0;
+    for (const auto &bench : corpus)
+    {
+        Position pos;
+        Piece side = SetupPosition(bench, pos);
+        if (side == PIECE_EMPTY)
+            continue;
+        std::vector<std::pair<int, int>> moves = pos.GetPossibleMoves();
+        int x = moves[0].first, y = moves[0].second;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++)
+        {
+            pos.MakeMove(x, y, side);
+            pos.UnmakeMove(x, y);
+        }
+        patternMoveMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++)
+            evalSink += pos.Evaluate(side);
+        patternEvalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        pos.SetNetwork(&network);
+        const NnueAccumulator &acc = pos.nnue;
+        int own = side - 1;
+        int expected = network.Evaluate(acc.values[own], acc.values[1 - own], LINE_KERNEL_SCALAR);
+        for (int kind = LINE_KERNEL_SCALAR; kind <= LINE_KERNEL_AVX2; kind++)
+        {
+            LineKernelKind kernel = (LineKernelKind)kind;
+            if (!LineKernelSupported(kernel))
+                continue;
+            if (network.Evaluate(acc.values[own], acc.values[1 - own], kernel) != expected)
+            {
+                fprintf(stderr, "nnue %s differs from scalar on %s\n", LineKernelName(kernel), bench.name.c_str());
+                return 1;
+            }
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeat; i++)
+                evalSink += network.Evaluate(acc.values[own], acc.values[1 - own], kernel);
+            nnueEvalMs[kind] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++)
+        {
+            pos.MakeMove(x, y, side);
+            pos.UnmakeMove(x, y);
+        }
+        nnueMoveMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        // 每个候选走法落子后与重算的结果比对
+        for (const auto &move : moves)
+        {
+            pos.MakeMove(move.first, move.second, side);
+            NnueAccumulator fresh;
+            fresh.Reset(pos.board, &network);
+            bool same = memcmp(fresh.values, pos.nnue.values, sizeof(fresh.values)) == 0;
+            pos.UnmakeMove(move.first, move.second);
+            if (!same)
+            {
+                fprintf(stderr, "incremental accumulator differs on %s\n", bench.name.c_str());
+                return 1;
+            }
+        }
+        count += repeat;
+    }
+    printf("\nevaluator      eval ns  make+unmake ns\n");
+    printf("%-14s %7.1f  %14.1f\n", "pattern", patternEvalMs * 1e6 / count, patternMoveMs * 1e6 / count);
+    for (int kind = LINE_KERNEL_SCALAR; kind <= LINE_KERNEL_AVX2; kind++)
+    {
+        if (LineKernelSupported((LineKernelKind)kind))
+            printf("nnue-%-9s %7.1f  %14.1f\n", LineKernelName((LineKernelKind)kind), nnueEvalMs[kind] * 1e6 / count,
+                   nnueMoveMs * 1e6 / count);
+    }
+    return 0;
+}
+
+// 主函数
+// 可选参数:
+//   --depth <d>      固定深度测试的深度(默认7)
+//   --movetime <ms>  固定时间测试每个局面的时间(默认500),0表示跳过固定时间测试
+//   --corpus <file>  从文件读取局面集合,代替内置的局面
+//   --json           以JSON格式输出
+//   --signature      只做固定深度测试并输出总节点数,单线程下结果完全确定,用于比较两次提交的搜索行为
+//   --smp            分别用1,2,4...个线程做固定深度测试,输出加速比
+//   --eval-bench     比较整盘线评估各个实现(标量,AVX2)的速度,并核对结果一致;
+//                    同时给出 --nnue 时再比较神经网络评估和棋型评估的速度
+//   --hash <MB>, --threads <n> 与图形界面相同
+int main(int argc, char *argv[])
+{
+    AIConfig config;
+    int depth = 7;
+    bool json = false, signature = false, smp = false, evalBench = false;
+    std::vector<BenchPosition> corpus = DEFAULT_CORPUS;
+    for (int i = 1; i < argc; i++)
+    {
+        if (ParseAIConfigArg(argc, argv, i, config))
+            continue;
+        if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+        {
+            depth = std::min(std::max(atoi(argv[++i]), 1), AI_MAX_DEPTH);
+        }
+        else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc)
+        {
+            if (!LoadCorpus(argv[++i], corpus))
+                return 1;
+        }
+        else if (strcmp(argv[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (strcmp(argv[i], "--signature") == 0)
+        {
+            signature = true;
+        }
+        else if (strcmp(argv[i], "--smp") == 0)
+        {
+            smp = true;
+        }
+        else if (strcmp(argv[i], "--eval-bench") == 0)
+        {
+            evalBench = true;
+        }
+        else
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    std::string error;
+    if (!CheckAIConfigFiles(config, BOARD_SIZE, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    if (evalBench)
+    {
+        int status = RunEvalBenchmark(corpus, 100000);
+        if (status == 0 && !config.nnuePath.empty())
+            status = RunNnueBenchmark(corpus, config.nnuePath, 100000);
+        return status;
+    }
+
+    if (smp)
+    {
+        int maxThreads = std::max((int)std::thread::hardware_concurrency(), config.threads);
+        RunSmpBenchmark(corpus, config, depth, maxThreads);
+        return 0;
+    }
+
+    if (signature)
+    {
+        // 多线程的节点数取决于线程调度,签名只在单线程下有意义
+        config.threads = 1;
+        BenchRun run = RunSuite(corpus, config, "depth", depth);
+        if (json)
+            printf("{\"depth\": %d, \"positions\": %zu, \"signature\": %lld}\n", depth, run.records.size(), run.totalNodes);
+        else
+            printf("signature %lld\n", run.totalNodes);
+        return 0;
+    }
+
+    std::vector<BenchRun> runs;
+    runs.push_back(RunSuite(corpus, config, "depth", depth));
+    if (config.moveTimeMs > 0)
+        runs.push_back(RunSuite(corpus, config, "time", config.moveTimeMs));
+
+    if (json)
+    {
+        printf("{\"threads\": %d, \"hash_mb\": %d, \"signature\": %lld,\n \"runs\": [\n",
+               config.threads, config.hashMegabytes, config.threads == 1 ? runs[0].totalNodes : 0LL);
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            PrintRunJson(runs[i]);
+            printf("%s\n", i + 1 < runs.size() ? "," : "");
+        }
+        printf(" ]}\n");
+    }
+    else
+    {
+        printf("threads %d  hash %d MB  positions %zu\n\n", config.threads, config.hashMegabytes, runs[0].records.size());
+        for (const auto &run : runs)
+            PrintRunText(run);
+        if (config.threads == 1)
+            printf("signature %lld\n", runs[0].totalNodes);
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+// 开局库生成工具:用自我对局或者棋谱统计开局阶段每个局面下走过的棋和最终胜负,写成开局库文件
+// 每个局面的每个走法按走棋一方的结果计分:赢2分,和1分,输不计;分数就是开局库中的权重
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "engine/search.h"
+#include "engine/book.h"
+#include "engine/record.h"
+
+// 从头摆一遍棋,检查落子合法并找出胜方,遇到非法落子时截断到它之前
+void ReplayGame(GameRecord &game)
+{
+    Position pos;
+    pos.Clear();
+    Piece side = PIECE_BLACK;
+    game.winner = PIECE_EMPTY;
+    game.finished = false;
+    for (size_t i = 0; i < game.moves.size(); i++)
+    {
+        int x = game.moves[i].first, y = game.moves[i].second;
+        if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE || !pos.board.IsEmpty(x, y))
+        {
+            game.moves.resize(i);
+            return;
+        }
+        pos.MakeMove(x, y, side);
+        if (pos.CheckWin(x, y))
+        {
+            game.winner = side;
+            game.finished = true;
+            game.moves.resize(i + 1);
+            return;
+        }
+        side = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    }
+    game.finished = game.moves.size() == (size_t)(BOARD_SIZE * BOARD_SIZE);
+}
+
+// 读取棋谱文件,每行一盘,形如"x,y"的词是落子,其他词忽略,
+// 所以基准测试的局面文件("名字 类别 x,y ...")也可以直接使用;空行和#开头的行忽略
+bool LoadGames(const std::string &path, std::vector<GameRecord> &games)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "cannot open games " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream in(line);
+        GameRecord game;
+        std::string word;
+        while (in >> word)
+        {
+            int x, y;
+            if (sscanf(word.c_str(), "%d,%d", &x, &y) == 2)
+                game.moves.emplace_back(x, y);
+        }
+        ReplayGame(game);
+        if (!game.moves.empty())
+            games.push_back(game);
+    }
+    return true;
+}
+
+// 读取二进制的对局记录文件(见engine/record.h),开局库只统计15路棋盘的对局
+bool LoadRecords(const std::string &path, std::vector<GameRecord> &games)
+{
+    GameRecordReader reader;
+    if (!reader.Open(path))
+    {
+        std::cerr << "cannot open records " << path << std::endl;
+        return false;
+    }
+    GameRecord game;
+    while (reader.Next(game))
+    {
+        if (game.boardSize != BOARD_SIZE)
+            continue;
+        ReplayGame(game);
+        if (!game.moves.empty())
+            games.push_back(game);
+    }
+    if (reader.Corrupted())
+        std::cerr << "corrupted record in " << path << ", using the games before it" << std::endl;
+    return true;
+}
+
+bool SaveRecords(const std::string &path, const std::vector<GameRecord> &games)
+{
+    GameRecordWriter writer;
+    if (!writer.Open(path))
+        return false;
+    for (const auto &game : games)
+    {
+        if (!writer.Write(game))
+            return false;
+    }
+    return writer.Flush();
+}
+
+void SaveGames(const std::string &path, const std::vector<GameRecord> &games)
+{
+    std::ofstream file(path);
+    for (const auto &game : games)
+    {
+        for (size_t i = 0; i < game.moves.size(); i++)
+            file << (i ? " " : "") << game.moves[i].first << "," << game.moves[i].second;
+        file << "\n";
+    }
+}
+
+// 自我对局:黑方先下天元,白方的第一步和黑方的第二步在天元附近随机选,之后双方都用搜索引擎下
+// 随机的前三步让每盘棋走向不同的开局
+std::vector<GameRecord> SelfPlay(int count, const AIConfig &config, unsigned seed)
+{
+    std::vector<GameRecord> games;
+    std::mt19937 rng(seed);
+    SearchEngine engine;
+    engine.Configure(config);
+    const int center = BOARD_SIZE / 2;
+    for (int g = 0; g < count; g++)
+    {
+        engine.NewGame();
+        Position pos;
+        pos.Clear();
+        GameRecord game;
+        Piece side = PIECE_BLACK;
+        while ((int)game.moves.size() < BOARD_SIZE * BOARD_SIZE)
+        {
+            std::pair<int, int> move;
+            int ply = (int)game.moves.size();
+            if (ply < 3)
+            {
+                int radius = (ply == 0) ? 0 : ply;
+                do
+                {
+                    move.first = center - radius + (int)(rng() % (2 * radius + 1));
+                    move.second = center - radius + (int)(rng() % (2 * radius + 1));
+                } while (!pos.board.IsEmpty(move.first, move.second));
+            }
+            else
+            {
+                // 搜索没有给出合法的走法时不再往下走,这盘没下完,建库时跳过
+                move = engine.Think(pos, side).bestMove;
+                if (move.first < 0 || move.first >= BOARD_SIZE || move.second < 0 || move.second >= BOARD_SIZE ||
+                    !pos.board.IsEmpty(move.first, move.second))
+                    break;
+            }
+            pos.MakeMove(move.first, move.second, side);
+            game.moves.push_back(move);
+            if (pos.CheckWin(move.first, move.second))
+            {
+                game.winner = side;
+                game.finished = true;
+                break;
+            }
+            side = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+        }
+        game.finished = game.finished || game.moves.size() == (size_t)(BOARD_SIZE * BOARD_SIZE);
+        game.moveTimeMs = config.moveTimeMs;
+        games.push_back(game);
+        fprintf(stderr, "\rself-play %d/%d", g + 1, count);
+    }
+    fprintf(stderr, "\n");
+    return games;
+}
+
+// 统计每盘棋前plies步的局面和走法,键和走法都换到规范方向
+void AddGame(const GameRecord &game, int plies, std::map<std::pair<uint64_t, uint16_t>, int> &weights)
+{
+    Position pos;
+    pos.Clear();
+    Piece side = PIECE_BLACK;
+    for (int i = 0; i < plies && i < (int)game.moves.size(); i++)
+    {
+        int x = game.moves[i].first, y = game.moves[i].second;
+        int points = (game.winner == side) ? 2 : (game.winner == PIECE_EMPTY) ? 1 : 0;
+        if (points > 0)
+        {
+            int sym, tx, ty;
+            uint64_t key = CanonicalBookKey<BOARD_SIZE>(pos.board, side, sym);
+            TransformPoint<BOARD_SIZE>(sym, x, y, tx, ty);
+            weights[{key, (uint16_t)(ty * BOARD_SIZE + tx)}] += points;
+        }
+        pos.MakeMove(x, y, side);
+        side = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    }
+}
+
+// 主函数
+// 可选参数:
+//   --out <file>         输出的开局库文件(必需)
+//   --games <file>       从棋谱文件统计,可以给出多次
+//   --records <file>     从二进制的对局记录文件(例如图形界面保存的games.gmr)统计,可以给出多次
+//   --selfplay <n>       自我对局n盘,与棋谱一起统计
+//   --save-games <file>  把自我对局的棋谱保存下来,以后可以用--games重新统计
+//   --save-records <file> 把参与统计的所有对局(读入的和自我对局的)写成二进制的对局记录
+//   --plies <n>          统计每盘棋的前n步(默认10)
+//   --min-weight <n>     权重低于n的走法不写入开局库(默认2,即至少赢过一次)
+//   --seed <n>           自我对局的随机种子
+//   --movetime <ms>, --hash <MB>, --threads <n> 等 自我对局时搜索引擎的参数,与图形界面相同
+int main(int argc, char *argv[])
+{
+    AIConfig config;
+    config.moveTimeMs = 100;
+    std::string outPath, savePath, saveRecordsPath;
+    std::vector<std::string> gamePaths, recordPaths;
+    int selfPlayGames = 0, plies = 10, minWeight = 2;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (ParseAIConfigArg(argc, argv, i, config))
+            continue;
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+            gamePaths.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--records") == 0 && i + 1 < argc)
+            recordPaths.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--save-records") == 0 && i + 1 < argc)
+            saveRecordsPath = argv[++i];
+        else if (strcmp(argv[i], "--selfplay") == 0 && i + 1 < argc)
+            selfPlayGames = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--save-games") == 0 && i + 1 < argc)
+            savePath = argv[++i];
+        else if (strcmp(argv[i], "--plies") == 0 && i + 1 < argc)
+            plies = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--min-weight") == 0 && i + 1 < argc)
+            minWeight = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = (unsigned)atoi(argv[++i]);
+        else
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (outPath.empty() || (gamePaths.empty() && recordPaths.empty() && selfPlayGames == 0))
+    {
+        std::cerr << "usage: gomoku-book --out <file> [--games <file>]... [--records <file>]... [--selfplay <n>] [--plies <n>]" << std::endl;
+        return 1;
+    }
+    std::string error;
+    if (!CheckAIConfigFiles(config, BOARD_SIZE, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    std::vector<GameRecord> games;
+    for (const auto &path : gamePaths)
+    {
+        if (!LoadGames(path, games))
+            return 1;
+    }
+    for (const auto &path : recordPaths)
+    {
+        if (!LoadRecords(path, games))
+            return 1;
+    }
+    if (selfPlayGames > 0)
+    {
+        // 自我对局不查旧的开局库,否则统计的只是旧库本身的走法
+        config.bookPath.clear();
+        std::vector<GameRecord> played = SelfPlay(selfPlayGames, config, seed);
+        if (!savePath.empty())
+            SaveGames(savePath, played);
+        games.insert(games.end(), played.begin(), played.end());
+    }
+    if (!saveRecordsPath.empty() && !SaveRecords(saveRecordsPath, games))
+    {
+        std::cerr << "cannot write " << saveRecordsPath << std::endl;
+        return 1;
+    }
+
+    // 没下完的棋(中途放弃或者记录被截断)没有结果,不能当作和棋计分
+    std::map<std::pair<uint64_t, uint16_t>, int> weights;
+    int results[3] = {0, 0, 0};
+    int unfinished = 0;
+    for (const auto &game : games)
+    {
+        if (!game.finished)
+        {
+            unfinished++;
+            continue;
+        }
+        AddGame(game, plies, weights);
+        results[game.winner]++;
+    }
+
+    std::vector<BookRecord> records;
+    size_t positions = 0;
+    uint64_t lastKey = 0;
+    for (const auto &item : weights)
+    {
+        if (item.second < minWeight)
+            continue;
+        if (records.empty() || item.first.first != lastKey)
+            positions++;
+        lastKey = item.first.first;
+        records.push_back({item.first.first, item.first.second, (uint16_t)std::min(item.second, 65535), 0});
+    }
+    if (!WriteOpeningBook(outPath, records))
+    {
+        std::cerr << "cannot write " << outPath << std::endl;
+        return 1;
+    }
+    printf("games %zu (black %d, white %d, draw %d, unfinished %d)  positions %zu  moves %zu  size %zu bytes\n",
+           games.size(), results[PIECE_BLACK], results[PIECE_WHITE], results[PIECE_EMPTY], unfinished, positions,
+           records.size(),
+           sizeof(BookHeader) + records.size() * sizeof(BookRecord));
+    return 0;
+}
@@ -0,0 +1,233 @@
+// 棋盘的基础定义:棋子类型,Zobrist哈希和位棋盘
+// 位棋盘和之上的评估,威胁搜索,搜索引擎都以棋盘大小N为模板参数,每种大小各自编译一份,
+// 循环边界和线的条数都是编译期常量;支持的大小在SUPPORTED_BOARD_SIZES中列出,各源文件按它显式实例化
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include "patterns.h"
+
+const int BOARD_SIZE = 15;     // 标准的15x15棋盘,不指定大小的类型别名和工具程序都使用它
+const int MAX_BOARD_SIZE = 19; // 支持的最大棋盘,每条线的掩码都要放进32位
+const int SUPPORTED_BOARD_SIZES[] = {15, 19};
+
+inline bool IsSupportedBoardSize(int size)
+{
+    for (int supported : SUPPORTED_BOARD_SIZES)
+    {
+        if (supported == size)
+            return true;
+    }
+    return false;
+}
+
+// 棋子类型
+enum Piece
+{
+    PIECE_EMPTY = 0, // 空
+    PIECE_BLACK = 1, // 黑子
+    PIECE_WHITE = 2  // 白子
+};
+
+// Zobrist哈希的随机键,每种颜色每个格子一个,另有一个表示轮到白方走的键
+// 使用固定种子的splitmix64生成,保证每次运行的哈希值一致
+template <int N>
+struct ZobristKeysT
+{
+    uint64_t piece[2][N * N];
+    uint64_t whiteToMove;
+
+    ZobristKeysT()
+    {
+        uint64_t seed = 0x9E3779B97F4A7C15ull;
+        for (int c = 0; c < 2; c++)
+        {
+            for (int i = 0; i < N * N; i++)
+            {
+                piece[c][i] = Next(seed);
+            }
+        }
+        whiteToMove = Next(seed);
+    }
+
+    static uint64_t Next(uint64_t &state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+// 每种棋盘大小一份键,15x15的键与只支持这一种大小时完全相同,开局库不需要重新生成
+template <int N>
+inline const ZobristKeysT<N> ZOBRIST_KEYS{};
+
+// 位棋盘:每种颜色按行,列,主对角线,副对角线各保存一份位掩码
+// 行,主对角线,副对角线以x为位下标,列以y为位下标,这样每条线上相邻的格子在掩码里也相邻
+// 五连判断和邻域扩展都只需要几次移位和按位与
+template <int N>
+struct BitBoardT
+{
+    static_assert(N >= 5 && N <= MAX_BOARD_SIZE, "掩码左移4位取窗口之后仍要放进32位");
+    static const int SIZE = N;
+    static const int LINE_COUNT = 2 * N - 1;         // 每个方向上对角线的条数
+    static const uint32_t FULL_LINE = (1u << N) - 1; // 一整条线的掩码
+
+    uint32_t rows[2][N];                // 行掩码,下标 y
+    uint32_t cols[2][N];                // 列掩码,下标 x
+    uint32_t diags[2][LINE_COUNT];      // 主对角线(左上到右下)掩码,下标 x - y + N - 1
+    uint32_t antiDiags[2][LINE_COUNT];  // 副对角线(右上到左下)掩码,下标 x + y
+    int stoneCount;                     // 棋盘上的棋子总数
+    uint64_t hash;                      // 当前局面的Zobrist哈希,随落子和提子增量更新
+    uint8_t nearCount[N * N];           // 每个格子八邻域(含自身)内的棋子数
+    uint32_t nearRows[N];               // 按行记录nearCount不为0的格子,即候选走法的邻域掩码
+
+    // 清空所有掩码
+    void Clear()
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            for (int i = 0; i < N; i++)
+            {
+                rows[c][i] = 0;
+                cols[c][i] = 0;
+            }
+            for (int i = 0; i < LINE_COUNT; i++)
+            {
+                diags[c][i] = 0;
+                antiDiags[c][i] = 0;
+            }
+        }
+        for (int i = 0; i < N; i++)
+            nearRows[i] = 0;
+        for (int i = 0; i < N * N; i++)
+            nearCount[i] = 0;
+        stoneCount = 0;
+        hash = 0;
+    }
+
+    // 读取(x,y)上的棋子,供绘制和落子判断使用
+    Piece At(int x, int y) const
+    {
+        uint32_t bit = 1u << x;
+        if (rows[0][y] & bit)
+            return PIECE_BLACK;
+        if (rows[1][y] & bit)
+            return PIECE_WHITE;
+        return PIECE_EMPTY;
+    }
+
+    bool IsEmpty(int x, int y) const
+    {
+        return ((Occupied(y) >> x) & 1u) == 0;
+    }
+
+    // 第y行已占用的格子
+    uint32_t Occupied(int y) const
+    {
+        return rows[0][y] | rows[1][y];
+    }
+
+    // 在(x,y)放下一个棋子,调用前该位置必须为空
+    void Place(int x, int y, Piece piece)
+    {
+        int c = piece - 1;
+        rows[c][y] |= 1u << x;
+        cols[c][x] |= 1u << y;
+        diags[c][x - y + N - 1] |= 1u << x;
+        antiDiags[c][x + y] |= 1u << x;
+        stoneCount++;
+        hash ^= ZOBRIST_KEYS<N>.piece[c][y * N + x];
+        UpdateNear(x, y, 1);
+    }
+
+    // 拿走(x,y)上的棋子
+    void Remove(int x, int y)
+    {
+        Piece piece = At(x, y);
+        if (piece == PIECE_EMPTY)
+            return;
+        int c = piece - 1;
+        rows[c][y] &= ~(1u << x);
+        cols[c][x] &= ~(1u << y);
+        diags[c][x - y + N - 1] &= ~(1u << x);
+        antiDiags[c][x + y] &= ~(1u << x);
+        stoneCount--;
+        hash ^= ZOBRIST_KEYS<N>.piece[c][y * N + x];
+        UpdateNear(x, y, -1);
+    }
+
+    // 更新(x,y)周围3x3范围内的邻域计数,计数在0和非0之间变化时同步邻域掩码
+    void UpdateNear(int x, int y, int delta)
+    {
+        for (int ny = std::max(0, y - 1); ny <= std::min(N - 1, y + 1); ny++)
+        {
+            for (int nx = std::max(0, x - 1); nx <= std::min(N - 1, x + 1); nx++)
+            {
+                uint8_t &count = nearCount[ny * N + nx];
+                count += delta;
+                if (count == 0)
+                    nearRows[ny] &= ~(1u << nx);
+                else
+                    nearRows[ny] |= 1u << nx;
+            }
+        }
+    }
+
+    // 检查掩码m里第pos位是否处在一段五连之中
+    static bool FiveThrough(uint32_t m, int pos)
+    {
+        uint32_t starts = m & (m >> 1);
+        starts &= starts >> 2;
+        starts &= m >> 4; // starts的第s位为1表示从s开始有连续五子
+        return (((starts << 4) >> pos) & 0x1Fu) != 0;
+    }
+
+    // 检查(x,y)上的棋子在四个方向上是否构成五子连珠
+    bool HasFive(int x, int y) const
+    {
+        Piece piece = At(x, y);
+        if (piece == PIECE_EMPTY)
+            return false;
+        int c = piece - 1;
+        return FiveThrough(rows[c][y], x) ||
+               FiveThrough(cols[c][x], y) ||
+               FiveThrough(diags[c][x - y + N - 1], x) ||
+               FiveThrough(antiDiags[c][x + y], x);
+    }
+
+    // 第y行中与已有棋子相邻(八邻域)的空位
+    uint32_t NeighborMask(int y) const
+    {
+        return nearRows[y] & ~Occupied(y);
+    }
+
+    // 对角线index在掩码中占用的位,行和列占满整条线
+    static uint32_t DiagSpan(int index)
+    {
+        int lo = std::max(0, index - (N - 1));
+        int hi = std::min(N - 1, index);
+        return (FULL_LINE >> (N - 1 - hi)) & ~((1u << lo) - 1);
+    }
+
+    // 假设c方(0黑1白)在空位(x,y)落子,返回四个方向上形成的棋型分数之和,用于走法排序
+    // 棋型由查找表给出,X_XXX这样的跳冲四和跳活三也能识别
+    int ThreatScore(int x, int y, int c) const
+    {
+        static const int ORDER_SCORE[PATTERN_COUNT] = {
+            0, 1, 10, 100,      // 死棋,单子,眠二,活二
+            100, 10000, 10000,  // 眠三,跳活三,活三
+            12000, 1000000,     // 冲四,活四
+            10000000            // 五连
+        };
+        int o = 1 - c;
+        int d = x - y + N - 1, a = x + y;
+        return ORDER_SCORE[LookupPattern(rows[c][y], rows[o][y] | ~FULL_LINE, x).pattern] +
+               ORDER_SCORE[LookupPattern(cols[c][x], cols[o][x] | ~FULL_LINE, y).pattern] +
+               ORDER_SCORE[LookupPattern(diags[c][d], diags[o][d] | ~DiagSpan(d), x).pattern] +
+               ORDER_SCORE[LookupPattern(antiDiags[c][a], antiDiags[o][a] | ~DiagSpan(a), x).pattern];
+    }
+};
+
+using ZobristKeys = ZobristKeysT<BOARD_SIZE>;
+using BitBoard = BitBoardT<BOARD_SIZE>;
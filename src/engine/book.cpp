@@ -0,0 +1,191 @@
+#include "book.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <cstdlib>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+template <int N>
+uint64_t CanonicalBookKey(const BitBoardT<N> &board, Piece side, int &sym)
+{
+    uint64_t keys[8] = {};
+    for (int c = 0; c < 2; c++)
+    {
+        for (int y = 0; y < N; y++)
+        {
+            uint32_t mask = board.rows[c][y];
+            while (mask)
+            {
+                int x = __builtin_ctz(mask);
+                mask &= mask - 1;
+                for (int s = 0; s < 8; s++)
+                {
+                    int tx, ty;
+                    TransformPoint<N>(s, x, y, tx, ty);
+                    keys[s] ^= ZOBRIST_KEYS<N>.piece[c][ty * N + tx];
+                }
+            }
+        }
+    }
+    sym = 0;
+    for (int s = 1; s < 8; s++)
+    {
+        if (keys[s] < keys[sym])
+            sym = s;
+    }
+    return keys[sym] ^ (side == PIECE_WHITE ? ZOBRIST_KEYS<N>.whiteToMove : 0);
+}
+
+bool OpeningBook::Open(const std::string &path)
+{
+    Close();
+#ifdef _WIN32
+    // 没有mmap的平台上整个读入内存
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0)
+    {
+        fclose(file);
+        return false;
+    }
+    void *data = malloc((size_t)size);
+    bool ok = data && fread(data, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+    if (!ok)
+    {
+        free(data);
+        return false;
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+#endif
+    mapping = data;
+    mappingSize = (size_t)size;
+
+    const BookHeader *header = (const BookHeader *)mapping;
+    if (mappingSize < sizeof(BookHeader) || memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 ||
+        header->version != BOOK_VERSION || !IsSupportedBoardSize((int)header->boardSize) ||
+        header->count != (mappingSize - sizeof(BookHeader)) / sizeof(BookRecord) ||
+        (mappingSize - sizeof(BookHeader)) % sizeof(BookRecord) != 0)
+    {
+        Close();
+        return false;
+    }
+    records = (const BookRecord *)((const char *)mapping + sizeof(BookHeader));
+    count = (size_t)header->count;
+    boardSize = (int)header->boardSize;
+    return true;
+}
+
+void OpeningBook::Close()
+{
+    if (mapping)
+    {
+#ifdef _WIN32
+        free(mapping);
+#else
+        munmap(mapping, mappingSize);
+#endif
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    records = nullptr;
+    count = 0;
+    boardSize = 0;
+}
+
+template <int N>
+std::vector<BookMove> OpeningBook::Probe(const BitBoardT<N> &board, Piece side) const
+{
+    std::vector<BookMove> moves;
+    if (!records || boardSize != N)
+        return moves;
+    int sym;
+    uint64_t key = CanonicalBookKey<N>(board, side, sym);
+    const BookRecord *end = records + count;
+    const BookRecord *it = std::lower_bound(records, end, key, [](const BookRecord &record, uint64_t k)
+                                            { return record.key < k; });
+    for (; it != end && it->key == key; ++it)
+    {
+        if (it->move >= N * N)
+            continue;
+        int x, y;
+        InverseTransformPoint<N>(sym, it->move % N, it->move / N, x, y);
+        // 键冲突或者文件损坏时,库里的走法可能落在已有棋子上
+        if (board.IsEmpty(x, y))
+            moves.push_back({{x, y}, it->weight});
+    }
+    return moves;
+}
+
+template <int N>
+bool OpeningBook::BestMove(const BitBoardT<N> &board, Piece side, std::pair<int, int> &move) const
+{
+    std::vector<BookMove> moves = Probe<N>(board, side);
+    if (moves.empty())
+        return false;
+    const BookMove *best = &moves[0];
+    for (const BookMove &candidate : moves)
+    {
+        if (candidate.weight > best->weight)
+            best = &candidate;
+    }
+    move = best->move;
+    return true;
+}
+
+bool WriteOpeningBook(const std::string &path, std::vector<BookRecord> records, int boardSize)
+{
+    std::sort(records.begin(), records.end(), [](const BookRecord &a, const BookRecord &b)
+              { return a.key != b.key ? a.key < b.key : a.move < b.move; });
+    std::vector<BookRecord> merged;
+    for (const BookRecord &record : records)
+    {
+        if (!merged.empty() && merged.back().key == record.key && merged.back().move == record.move)
+            merged.back().weight = (uint16_t)std::min(merged.back().weight + record.weight, 65535);
+        else
+            merged.push_back({record.key, record.move, record.weight, 0});
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    BookHeader header;
+    memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    header.version = BOOK_VERSION;
+    header.boardSize = (uint32_t)boardSize;
+    header.count = merged.size();
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (merged.empty() || fwrite(merged.data(), sizeof(BookRecord), merged.size(), file) == merged.size());
+    return fclose(file) == 0 && ok;
+}
+
+template uint64_t CanonicalBookKey<15>(const BitBoardT<15> &, Piece, int &);
+template uint64_t CanonicalBookKey<19>(const BitBoardT<19> &, Piece, int &);
+template std::vector<BookMove> OpeningBook::Probe<15>(const BitBoardT<15> &, Piece) const;
+template std::vector<BookMove> OpeningBook::Probe<19>(const BitBoardT<19> &, Piece) const;
+template bool OpeningBook::BestMove<15>(const BitBoardT<15> &, Piece, std::pair<int, int> &) const;
+template bool OpeningBook::BestMove<19>(const BitBoardT<19> &, Piece, std::pair<int, int> &) const;
@@ -0,0 +1,109 @@
+// 开局库:把常见开局局面的推荐走法存成文件,开局阶段直接查表落子,不用搜索
+// 文件格式(小端):
+//   文件头 BookHeader,24字节
+//   count条 BookRecord,每条16字节,按key从小到大排序,同一局面的多个走法相邻
+// 局面先化成8种对称变换(旋转,翻转)中Zobrist键最小的一种再存,走法也换到这个方向,
+// 这样对称的开局只占一条记录.键依赖ZOBRIST的随机数,修改生成方式后要重新生成开局库
+// 读取时用mmap把文件映射进内存,查找就是一次二分查找,打开文件时不需要解析
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "board.h"
+
+const char BOOK_MAGIC[8] = {'G', 'M', 'K', 'B', 'O', 'O', 'K', '1'};
+const uint32_t BOOK_VERSION = 1;
+
+struct BookHeader
+{
+    char magic[8];      // BOOK_MAGIC
+    uint32_t version;   // BOOK_VERSION
+    uint32_t boardSize; // 棋盘大小,只有同样大小的棋盘会查这个开局库
+    uint64_t count;     // 记录条数
+};
+
+struct BookRecord
+{
+    uint64_t key;      // 规范化局面的键,含轮到哪一方走
+    uint16_t move;     // 规范化方向下的走法,y * boardSize + x
+    uint16_t weight;   // 权重,越大越好
+    uint32_t reserved; // 对齐,写0
+};
+
+static_assert(sizeof(BookHeader) == 24 && sizeof(BookRecord) == 16, "开局库的文件格式依赖这两个结构的大小");
+
+// 8种对称变换,sym的第0位表示交换x和y,第1位表示左右翻转,第2位表示上下翻转,按这个顺序作用
+template <int N>
+inline void TransformPoint(int sym, int x, int y, int &tx, int &ty)
+{
+    if (sym & 1)
+        std::swap(x, y);
+    if (sym & 2)
+        x = N - 1 - x;
+    if (sym & 4)
+        y = N - 1 - y;
+    tx = x;
+    ty = y;
+}
+
+// TransformPoint的逆变换
+template <int N>
+inline void InverseTransformPoint(int sym, int x, int y, int &tx, int &ty)
+{
+    if (sym & 4)
+        y = N - 1 - y;
+    if (sym & 2)
+        x = N - 1 - x;
+    if (sym & 1)
+        std::swap(x, y);
+    tx = x;
+    ty = y;
+}
+
+// 计算局面在8种对称变换下的键,返回最小的一个,sym为对应的变换
+template <int N>
+uint64_t CanonicalBookKey(const BitBoardT<N> &board, Piece side, int &sym);
+
+// 开局库中的一个走法,坐标已经换回查询局面的方向
+struct BookMove
+{
+    std::pair<int, int> move;
+    int weight;
+};
+
+// 只读的开局库
+class OpeningBook
+{
+public:
+    OpeningBook() = default;
+    OpeningBook(const OpeningBook &) = delete;
+    OpeningBook &operator=(const OpeningBook &) = delete;
+    ~OpeningBook() { Close(); }
+
+    // 映射开局库文件,文件不存在或格式不对时返回false,此时开局库为空
+    bool Open(const std::string &path);
+    void Close();
+
+    bool IsOpen() const { return records != nullptr; }
+    size_t Size() const { return count; }
+    int BoardSize() const { return boardSize; }
+
+    // 查找局面的所有走法,棋盘大小与开局库不同时返回空
+    template <int N>
+    std::vector<BookMove> Probe(const BitBoardT<N> &board, Piece side) const;
+
+    // 权重最大的走法,局面不在库中时返回false
+    template <int N>
+    bool BestMove(const BitBoardT<N> &board, Piece side, std::pair<int, int> &move) const;
+
+private:
+    const BookRecord *records = nullptr;
+    size_t count = 0;
+    int boardSize = 0;
+    void *mapping = nullptr; // 映射的起始地址
+    size_t mappingSize = 0;
+};
+
+// 把记录排序后写成开局库文件,同一局面同一走法的记录合并,权重相加(最大65535)
+bool WriteOpeningBook(const std::string &path, std::vector<BookRecord> records, int boardSize = BOARD_SIZE);
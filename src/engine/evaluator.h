@@ -0,0 +1,195 @@
+// 增量评估器
+#pragma once
+#include <cassert>
+#include <climits>
+#include "board.h"
+#include "line_kernel.h"
+
+// 线的种类,与BitBoard中四组掩码一一对应
+enum LineKind
+{
+    LINE_ROW,       // 横
+    LINE_COL,       // 竖
+    LINE_DIAG,      // 主对角线
+    LINE_ANTI_DIAG  // 副对角线
+};
+
+// 增量评估器
+// EvaluateBoard对每个棋子在四个方向上查棋型表计分,每一项只取决于棋子所在的那条线,
+// 所以总分等于所有线的分数之和.落子只会改变经过该点的四条线,只需重算这四条线的分数
+template <int N>
+struct IncrementalEvaluatorT
+{
+    using Board = BitBoardT<N>;
+    static const int MAX_LINES = Board::LINE_COUNT;
+
+    int lineScore[4][MAX_LINES];   // 每条线的分数,黑正白负
+    uint8_t lineFive[4][MAX_LINES]; // 每条线上的五连标记,第0位黑,第1位白
+    int totalScore;                // 所有线的分数之和
+    int fiveCount[2];              // 含有五连的线的条数,按颜色统计
+    const PatternEntry *table = PATTERNS.entries; // 计分用的查找表,换表之后要调用Reset
+
+    // 撤销记录,保存落子前四条线的旧值,悔棋时原样恢复
+    struct UndoRecord
+    {
+        int score[4];
+        uint8_t five[4];
+    };
+    UndoRecord undoStack[N * N];
+    int undoTop;
+
+    // 根据整个棋盘重新计算所有线,由向量化的整盘线评估一次算完
+    void Reset(const Board &board)
+    {
+        EvaluateAllLines(board, table, lineScore, lineFive);
+        totalScore = 0;
+        fiveCount[0] = fiveCount[1] = 0;
+        undoTop = 0;
+        for (int kind = 0; kind < 4; kind++)
+        {
+            for (int index = 0; index < LineCount(kind); index++)
+            {
+#ifndef NDEBUG
+                uint8_t five;
+                assert(lineScore[kind][index] == ComputeLine(table, board, kind, index, five) && lineFive[kind][index] == five);
+#endif
+                Add(kind, index, 1);
+            }
+        }
+    }
+
+    // 在(x,y)落子之后调用,重算经过该点的四条线
+    void OnPlace(const Board &board, int x, int y)
+    {
+        UndoRecord &record = undoStack[undoTop++];
+        for (int kind = 0; kind < 4; kind++)
+        {
+            int index = LineIndex(kind, x, y);
+            record.score[kind] = lineScore[kind][index];
+            record.five[kind] = lineFive[kind][index];
+            Add(kind, index, -1);
+            lineScore[kind][index] = ComputeLine(table, board, kind, index, lineFive[kind][index]);
+            Add(kind, index, 1);
+        }
+    }
+
+    // 拿走(x,y)的棋子之后调用,必须与OnPlace按后进先出的顺序配对
+    void OnRemove(int x, int y)
+    {
+        const UndoRecord &record = undoStack[--undoTop];
+        for (int kind = 0; kind < 4; kind++)
+        {
+            int index = LineIndex(kind, x, y);
+            Add(kind, index, -1);
+            lineScore[kind][index] = record.score[kind];
+            lineFive[kind][index] = record.five[kind];
+            Add(kind, index, 1);
+        }
+    }
+
+    // 黑白双方同时有五连时,原评估函数的结果取决于扫描顺序,交给全盘计算处理
+    bool NeedsFullScan() const
+    {
+        return fiveCount[0] > 0 && fiveCount[1] > 0;
+    }
+
+    bool HasFive() const
+    {
+        return fiveCount[0] > 0 || fiveCount[1] > 0;
+    }
+
+    int Score() const
+    {
+        if (fiveCount[0] > 0)
+            return INT_MAX;
+        if (fiveCount[1] > 0)
+            return INT_MIN;
+        return totalScore;
+    }
+
+    static int LineCount(int kind)
+    {
+        return (kind == LINE_ROW || kind == LINE_COL) ? N : Board::LINE_COUNT;
+    }
+
+    static int LineIndex(int kind, int x, int y)
+    {
+        switch (kind)
+        {
+        case LINE_ROW:
+            return y;
+        case LINE_COL:
+            return x;
+        case LINE_DIAG:
+            return x - y + N - 1;
+        default:
+            return x + y;
+        }
+    }
+
+    // 把一条线的分数计入(sign为1)或移出(sign为-1)总分
+    void Add(int kind, int index, int sign)
+    {
+        totalScore += sign * lineScore[kind][index];
+        if (lineFive[kind][index] & 1)
+            fiveCount[0] += sign;
+        if (lineFive[kind][index] & 2)
+            fiveCount[1] += sign;
+    }
+
+    // 计算一条线的分数,规则与EvaluateBoardFull完全一致:
+    // 每个棋子以自己为中心取前后各4格查棋型表,五连只做标记,其余按棋型计分
+    static int ComputeLine(const PatternEntry *table, const Board &board, int kind, int index, uint8_t &five)
+    {
+        uint32_t black, white, span;
+        switch (kind)
+        {
+        case LINE_ROW:
+            black = board.rows[0][index];
+            white = board.rows[1][index];
+            span = Board::FULL_LINE;
+            break;
+        case LINE_COL:
+            black = board.cols[0][index];
+            white = board.cols[1][index];
+            span = Board::FULL_LINE;
+            break;
+        case LINE_DIAG:
+            black = board.diags[0][index];
+            white = board.diags[1][index];
+            span = Board::DiagSpan(index);
+            break;
+        default:
+            black = board.antiDiags[0][index];
+            white = board.antiDiags[1][index];
+            span = Board::DiagSpan(index);
+            break;
+        }
+
+        int score = 0;
+        five = 0;
+        uint32_t stones = black;
+        while (stones)
+        {
+            int i = __builtin_ctz(stones);
+            stones &= stones - 1;
+            const PatternEntry &entry = LookupPattern(black, white | ~span, i, table);
+            if (entry.pattern == PATTERN_FIVE)
+                five |= 1;
+            score += entry.score;
+        }
+        stones = white;
+        while (stones)
+        {
+            int i = __builtin_ctz(stones);
+            stones &= stones - 1;
+            const PatternEntry &entry = LookupPattern(white, black | ~span, i, table);
+            if (entry.pattern == PATTERN_FIVE)
+                five |= 2;
+            score -= entry.score;
+        }
+        return score;
+    }
+};
+
+using IncrementalEvaluator = IncrementalEvaluatorT<BOARD_SIZE>;
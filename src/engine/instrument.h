@@ -0,0 +1,88 @@
+// 统计计数器和计时器,用来观察搜索和帧循环的开销
+// 编译期开关:调试构建(没有定义NDEBUG)或者定义了GOMOKU_STATS时统计,
+// 否则计数器和计时器都是空结构,所有的统计操作在编译后不留下任何代码
+#pragma once
+#include <algorithm>
+#include <chrono>
+
+#if !defined(NDEBUG) || defined(GOMOKU_STATS)
+const bool STATS_ENABLED = true;
+#else
+const bool STATS_ENABLED = false;
+#endif
+
+template <bool Enabled>
+struct StatCounterT
+{
+    long long value = 0;
+
+    void Add(long long n = 1) { value += n; }
+    long long Value() const { return value; }
+};
+
+template <>
+struct StatCounterT<false>
+{
+    void Add(long long = 1) {}
+    long long Value() const { return 0; }
+};
+
+using StatCounter = StatCounterT<STATS_ENABLED>;
+
+// 按走法在排序后的序号统计beta剪枝,前CUTOFF_SLOTS-1个序号各占一格,其余合并到最后一格
+// 第一个走法就剪枝的比例越高,说明走法排序越好
+const int CUTOFF_SLOTS = 8;
+
+// 一个搜索线程在一次搜索中的计数,节点数和置换表统计另有记录,不在这里
+struct SearchCounters
+{
+    StatCounter leafEvals;                // 叶节点评估次数
+    StatCounter betaCutoffs[CUTOFF_SLOTS]; // 按走法序号统计的beta剪枝次数
+    StatCounter reSearches;               // 零窗口或缩减深度的试探失败后重搜的次数
+
+    void RecordCutoff(int moveIndex)
+    {
+        betaCutoffs[std::min(moveIndex, CUTOFF_SLOTS - 1)].Add();
+    }
+
+    long long TotalCutoffs() const
+    {
+        long long total = 0;
+        for (const StatCounter &counter : betaCutoffs)
+            total += counter.Value();
+        return total;
+    }
+
+    void Add(const SearchCounters &other)
+    {
+        leafEvals.Add(other.leafEvals.Value());
+        reSearches.Add(other.reSearches.Value());
+        for (int i = 0; i < CUTOFF_SLOTS; i++)
+            betaCutoffs[i].Add(other.betaCutoffs[i].Value());
+    }
+};
+
+// 作用域计时器:析构时把经过的毫秒数加到target上
+template <bool Enabled>
+class ScopedTimerT
+{
+public:
+    explicit ScopedTimerT(double &target) : out(target), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimerT()
+    {
+        out += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    double &out;
+    std::chrono::steady_clock::time_point start;
+};
+
+template <>
+class ScopedTimerT<false>
+{
+public:
+    explicit ScopedTimerT(double &) {}
+};
+
+using ScopedTimer = ScopedTimerT<STATS_ENABLED>;
@@ -0,0 +1,213 @@
+#include "line_kernel.h"
+#include "evaluator.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LINE_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(PatternEntry) == 4, "SIMD实现按32位读取查找表的每一项");
+
+namespace
+{
+#ifdef LINE_KERNEL_X86
+    // 每条对角线在掩码中占用的位,补齐到8的倍数条,多出的线不含任何格子
+    template <int N>
+    struct DiagSpans
+    {
+        static const int PADDED = (BitBoardT<N>::LINE_COUNT + 7) / 8 * 8;
+        alignas(32) uint32_t span[PADDED];
+
+        DiagSpans()
+        {
+            for (int index = 0; index < PADDED; index++)
+                span[index] = (index < BitBoardT<N>::LINE_COUNT) ? BitBoardT<N>::DiagSpan(index) : 0;
+        }
+    };
+    template <int N>
+    const DiagSpans<N> DIAG_SPANS;
+
+    // 4位二进制数各位当作3进制数的值,用字节查表指令把窗口掩码换成3进制下标
+#define NIBBLE_TERNARY 0, 1, 3, 4, 9, 10, 12, 13, 27, 28, 30, 31, 36, 37, 39, 40
+
+    // 8位掩码(每个32位通道的低字节)转成3进制值:低4位和高4位分别查表,高位的值乘81
+    __attribute__((target("avx2"))) inline __m256i TernaryAvx2(__m256i bits, __m256i table)
+    {
+        __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(bits, _mm256_set1_epi32(0x0F)));
+        __m256i high = _mm256_shuffle_epi8(table, _mm256_srli_epi32(bits, 4));
+        __m256i high81 = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(high, 6), _mm256_slli_epi32(high, 4)), high);
+        return _mm256_add_epi32(low, high81);
+    }
+
+    // 取出以pos为中心的9格窗口并去掉中心位,得到8位掩码;shifted已经左移4位
+    __attribute__((target("avx2"))) inline __m256i WindowAvx2(__m256i shifted, __m256i pos)
+    {
+        __m256i window = _mm256_srlv_epi32(shifted, pos);
+        return _mm256_or_si256(_mm256_and_si256(window, _mm256_set1_epi32(0x0F)),
+                               _mm256_and_si256(_mm256_srli_epi32(window, 1), _mm256_set1_epi32(0xF0)));
+    }
+
+    // 8条线上一方棋子的查表进度,每个通道是一条线
+    struct LanePass
+    {
+        __m256i ownShifted;     // 己方棋子,左移4位
+        __m256i blockedShifted; // 对方棋子和线外的格子,左移4位后低4位置1
+        __m256i remaining;      // 还没有查表的己方棋子
+        __m256i score;          // 已查表棋子的分数之和
+    };
+
+    __attribute__((target("avx2"))) inline void StartPass(LanePass &pass, __m256i own, __m256i other, __m256i outside)
+    {
+        pass.ownShifted = _mm256_slli_epi32(own, 4);
+        pass.blockedShifted = _mm256_or_si256(_mm256_slli_epi32(_mm256_or_si256(other, outside), 4), _mm256_set1_epi32(0x0F));
+        pass.remaining = own;
+        pass.score = _mm256_setzero_si256();
+    }
+
+    // 取出每条线上位置最低的一个己方棋子查表,没有棋子的通道不计分
+    __attribute__((target("avx2"))) inline void StepPass(LanePass &pass, __m256i table, const PatternEntry *entries)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i lowest = _mm256_and_si256(pass.remaining, _mm256_sub_epi32(zero, pass.remaining));
+        pass.remaining = _mm256_xor_si256(pass.remaining, lowest);
+        // 2的幂转成浮点数后,指数部分就是位的下标
+        __m256i pos = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(lowest)), 23),
+                                       _mm256_set1_epi32(127));
+        __m256i o = WindowAvx2(pass.ownShifted, pos);
+        __m256i b = WindowAvx2(pass.blockedShifted, pos);
+        __m256i index = _mm256_add_epi32(TernaryAvx2(o, table), _mm256_slli_epi32(TernaryAvx2(b, table), 1));
+        __m256i entry = _mm256_i32gather_epi32((const int *)entries, index, 4);
+        __m256i value = _mm256_srai_epi32(_mm256_slli_epi32(entry, 16), 16);
+        pass.score = _mm256_add_epi32(pass.score, _mm256_andnot_si256(_mm256_cmpeq_epi32(lowest, zero), value));
+    }
+
+    // 含有五连(或长连)的通道,与查表得到五连棋型的条件相同
+    __attribute__((target("avx2"))) inline __m256i FiveLanes(__m256i m)
+    {
+        __m256i starts = _mm256_and_si256(m, _mm256_srli_epi32(m, 1));
+        starts = _mm256_and_si256(starts, _mm256_srli_epi32(starts, 2));
+        starts = _mm256_and_si256(starts, _mm256_srli_epi32(m, 4));
+        return _mm256_xor_si256(_mm256_cmpeq_epi32(starts, _mm256_setzero_si256()), _mm256_set1_epi32(-1));
+    }
+
+    // 一种方向的所有线,直接从位棋盘的掩码数组读取,span为空表示每条线都占满fullLine
+    // 每8条线一组,黑方和白方各用一个向量,两者交替推进,让两次gather的延迟互相重叠;
+    // 轮数等于这一组线上一方棋子数的最大值
+    __attribute__((target("avx2"))) void EvaluateKindAvx2(const uint32_t *black, const uint32_t *white, const uint32_t *span,
+                                                          uint32_t fullLine, int lineCount, const PatternEntry *entries,
+                                                          int *scores, uint8_t *fives)
+    {
+        const __m256i table = _mm256_setr_epi8(NIBBLE_TERNARY, NIBBLE_TERNARY);
+        for (int g = 0; g < lineCount; g += 8)
+        {
+            int count = std::min(lineCount - g, 8);
+            __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            __m256i blackLines = _mm256_maskload_epi32((const int *)(black + g), valid);
+            __m256i whiteLines = _mm256_maskload_epi32((const int *)(white + g), valid);
+            __m256i inside = span ? _mm256_load_si256((const __m256i *)(span + g)) : _mm256_set1_epi32(fullLine);
+            __m256i outside = _mm256_xor_si256(inside, _mm256_set1_epi32(-1));
+
+            LanePass blackPass, whitePass;
+            StartPass(blackPass, blackLines, whiteLines, outside);
+            StartPass(whitePass, whiteLines, blackLines, outside);
+            while (!_mm256_testz_si256(blackPass.remaining, blackPass.remaining) ||
+                   !_mm256_testz_si256(whitePass.remaining, whitePass.remaining))
+            {
+                StepPass(blackPass, table, entries);
+                StepPass(whitePass, table, entries);
+            }
+
+            _mm256_maskstore_epi32(scores + g, valid, _mm256_sub_epi32(blackPass.score, whitePass.score));
+            __m256i flags = _mm256_or_si256(_mm256_and_si256(FiveLanes(blackLines), _mm256_set1_epi32(1)),
+                                            _mm256_and_si256(FiveLanes(whiteLines), _mm256_set1_epi32(2)));
+            alignas(32) int packed[8];
+            _mm256_store_si256((__m256i *)packed, flags);
+            for (int i = 0; i < count; i++)
+                fives[g + i] = (uint8_t)packed[i];
+        }
+    }
+
+    template <int N>
+    __attribute__((target("avx2"))) void EvaluateLinesAvx2(const BitBoardT<N> &board, const PatternEntry *entries,
+                                                           int scores[4][BitBoardT<N>::LINE_COUNT],
+                                                           uint8_t fives[4][BitBoardT<N>::LINE_COUNT])
+    {
+        const uint32_t full = BitBoardT<N>::FULL_LINE;
+        const int diagCount = BitBoardT<N>::LINE_COUNT;
+        EvaluateKindAvx2(board.rows[0], board.rows[1], nullptr, full, N, entries, scores[LINE_ROW], fives[LINE_ROW]);
+        EvaluateKindAvx2(board.cols[0], board.cols[1], nullptr, full, N, entries, scores[LINE_COL], fives[LINE_COL]);
+        EvaluateKindAvx2(board.diags[0], board.diags[1], DIAG_SPANS<N>.span, full, diagCount, entries,
+                         scores[LINE_DIAG], fives[LINE_DIAG]);
+        EvaluateKindAvx2(board.antiDiags[0], board.antiDiags[1], DIAG_SPANS<N>.span, full, diagCount, entries,
+                         scores[LINE_ANTI_DIAG], fives[LINE_ANTI_DIAG]);
+    }
+#endif
+
+    LineKernelKind DetectLineKernel()
+    {
+#ifdef LINE_KERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return LINE_KERNEL_AVX2;
+#endif
+        return LINE_KERNEL_SCALAR;
+    }
+}
+
+bool LineKernelSupported(LineKernelKind kind)
+{
+    return kind <= BestLineKernel();
+}
+
+LineKernelKind BestLineKernel()
+{
+    static const LineKernelKind best = DetectLineKernel();
+    return best;
+}
+
+const char *LineKernelName(LineKernelKind kind)
+{
+    switch (kind)
+    {
+    case LINE_KERNEL_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+template <int N>
+void EvaluateAllLines(const BitBoardT<N> &board, LineKernelKind kind, const PatternEntry *table,
+                      int scores[4][BitBoardT<N>::LINE_COUNT], uint8_t fives[4][BitBoardT<N>::LINE_COUNT])
+{
+#ifdef LINE_KERNEL_X86
+    if (kind == LINE_KERNEL_AVX2 && LineKernelSupported(kind))
+    {
+        EvaluateLinesAvx2<N>(board, table, scores, fives);
+        return;
+    }
+#else
+    (void)kind;
+#endif
+    using Evaluator = IncrementalEvaluatorT<N>;
+    for (int line = 0; line < 4; line++)
+    {
+        for (int index = 0; index < Evaluator::LineCount(line); index++)
+            scores[line][index] = Evaluator::ComputeLine(table, board, line, index, fives[line][index]);
+    }
+}
+
+template <int N>
+void EvaluateAllLines(const BitBoardT<N> &board, const PatternEntry *table, int scores[4][BitBoardT<N>::LINE_COUNT],
+                      uint8_t fives[4][BitBoardT<N>::LINE_COUNT])
+{
+    EvaluateAllLines<N>(board, BestLineKernel(), table, scores, fives);
+}
+
+#define INSTANTIATE_LINE_KERNEL(N)                                                                                  \
+    template void EvaluateAllLines<N>(const BitBoardT<N> &, LineKernelKind, const PatternEntry *,                   \
+                                      int[4][BitBoardT<N>::LINE_COUNT], uint8_t[4][BitBoardT<N>::LINE_COUNT]);      \
+    template void EvaluateAllLines<N>(const BitBoardT<N> &, const PatternEntry *, int[4][BitBoardT<N>::LINE_COUNT], \
+                                      uint8_t[4][BitBoardT<N>::LINE_COUNT]);
+INSTANTIATE_LINE_KERNEL(15)
+INSTANTIATE_LINE_KERNEL(19)
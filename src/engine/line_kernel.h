@@ -0,0 +1,30 @@
+// 整盘线评估:一次算出所有行,列和对角线的分数和五连标记
+// x86上运行时检测CPU,支持AVX2时用向量实现,否则用标量实现,两者的结果完全相同
+#pragma once
+#include "board.h"
+
+// 线评估的实现
+enum LineKernelKind
+{
+    LINE_KERNEL_SCALAR, // 逐条线逐个棋子查表
+    LINE_KERNEL_AVX2    // 每次处理8条线,黑白双方一起查表,查表用gather指令
+};
+
+// 当前CPU是否支持该实现
+bool LineKernelSupported(LineKernelKind kind);
+
+// 当前CPU上最快的实现
+LineKernelKind BestLineKernel();
+
+const char *LineKernelName(LineKernelKind kind);
+
+// 计算所有线的分数(黑正白负)和五连标记(第0位黑,第1位白),下标与IncrementalEvaluator相同
+// 分数从table中读取(默认是PATTERNS.entries);为SUPPORTED_BOARD_SIZES中的每种大小实例化
+template <int N>
+void EvaluateAllLines(const BitBoardT<N> &board, LineKernelKind kind, const PatternEntry *table,
+                      int scores[4][BitBoardT<N>::LINE_COUNT], uint8_t fives[4][BitBoardT<N>::LINE_COUNT]);
+
+// 使用BestLineKernel()的实现
+template <int N>
+void EvaluateAllLines(const BitBoardT<N> &board, const PatternEntry *table, int scores[4][BitBoardT<N>::LINE_COUNT],
+                      uint8_t fives[4][BitBoardT<N>::LINE_COUNT]);
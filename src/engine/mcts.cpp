@@ -0,0 +1,437 @@
+#include "mcts.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+// 子节点的分数,走到它的一方的视角,与主变例搜索的分数同一量纲
+static int ChildScore(const MctsNode &child)
+{
+    if (child.state.load(std::memory_order_relaxed) == MCTS_TERMINAL)
+        return SCORE_WIN - 1;
+    double q = std::min(std::max(child.Q(), -0.99), 0.99);
+    return (int)std::lround(MCTS_EVAL_SCALE * std::atanh(q));
+}
+
+template <int N>
+MctsSearchT<N>::MctsSearchT(int megabytes)
+{
+    capacity = (uint32_t)((size_t)megabytes * 1024 * 1024 / (2 * sizeof(MctsNode)));
+    pools[0].reset(new MctsNode[capacity]);
+    pools[1].reset(new MctsNode[capacity]);
+}
+
+template <int N>
+void MctsSearchT<N>::Clear()
+{
+    root = NO_NODE;
+}
+
+template <int N>
+uint32_t MctsSearchT<N>::FindNode(const Position &pos, Piece side) const
+{
+    if (root == NO_NODE)
+        return NO_NODE;
+    int added = pos.board.stoneCount - rootBoard.stoneCount;
+    if (added < 0 || ((added % 2 == 0) != (side == rootSide)))
+        return NO_NODE;
+    // 根节点的棋子必须都还在,悔棋之后的局面不在这棵树里
+    for (int y = 0; y < N; y++)
+    {
+        for (int x = 0; x < N; x++)
+        {
+            if (!rootBoard.IsEmpty(x, y) && pos.board.At(x, y) != rootBoard.At(x, y))
+                return NO_NODE;
+        }
+    }
+    // 多出的棋子按颜色交替,同色棋子的先后顺序不影响局面,找到任何一条路径都可以
+    const MctsNode *pool = Pool();
+    uint32_t index = root;
+    Piece mover = rootSide;
+    for (int step = 0; step < added; step++)
+    {
+        const MctsNode &node = pool[index];
+        if (node.state.load(std::memory_order_relaxed) != MCTS_EXPANDED)
+            return NO_NODE;
+        uint32_t found = NO_NODE;
+        for (int k = 0; k < node.childCount && found == NO_NODE; k++)
+        {
+            uint16_t move = pool[node.firstChild + k].move;
+            int x = move % N, y = move / N;
+            if (rootBoard.IsEmpty(x, y) && pos.board.At(x, y) == mover)
+                found = node.firstChild + k;
+        }
+        if (found == NO_NODE)
+            return NO_NODE;
+        index = found;
+        mover = (mover == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    }
+    return index;
+}
+
+template <int N>
+void MctsSearchT<N>::Compact(uint32_t index)
+{
+    const MctsNode *src = Pool();
+    MctsNode *dst = pools[1 - active].get();
+    auto copy = [](MctsNode &to, const MctsNode &from)
+    {
+        to.Init(from.move, from.prior, (MctsNodeState)from.state.load(std::memory_order_relaxed));
+        to.valueSum.store(from.valueSum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        to.visits.store(from.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        to.firstChild = from.firstChild;
+        to.childCount = from.childCount;
+    };
+    // 按层复制:复制过去的节点的firstChild暂时还是旧节点池中的位置,轮到它时再改成新位置
+    copy(dst[0], src[index]);
+    uint32_t count = 1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        MctsNode &node = dst[i];
+        if (node.state.load(std::memory_order_relaxed) != MCTS_EXPANDED)
+            continue;
+        uint32_t from = node.firstChild;
+        node.firstChild = count;
+        for (int k = 0; k < node.childCount; k++)
+            copy(dst[count + k], src[from + k]);
+        count += node.childCount;
+    }
+    active = 1 - active;
+    root = 0;
+    next.store(count, std::memory_order_relaxed);
+}
+
+template <int N>
+MctsNode *MctsSearchT<N>::SelectChild(MctsNode &node) const
+{
+    MctsNode *children = Pool() + node.firstChild;
+    double sqrtVisits = std::sqrt((double)std::max(node.visits.load(std::memory_order_relaxed), 1));
+    // node的价值是对方的视角,子节点是轮到的一方的视角
+    double fpu = -node.Q() - MCTS_FPU_REDUCTION;
+    MctsNode *best = children;
+    double bestValue = -1e9;
+    for (int k = 0; k < node.childCount; k++)
+    {
+        MctsNode &child = children[k];
+        // 能直接成五就不用再比较
+        if (child.state.load(std::memory_order_relaxed) == MCTS_TERMINAL)
+            return &child;
+        int visits = child.visits.load(std::memory_order_relaxed);
+        double q = visits > 0 ? (double)child.valueSum.load(std::memory_order_relaxed) / ((double)visits * MCTS_VALUE_ONE)
+                              : fpu;
+        double value = q + MCTS_CPUCT * child.prior * sqrtVisits / (1 + visits);
+        if (value > bestValue)
+        {
+            bestValue = value;
+            best = &child;
+        }
+    }
+    return best;
+}
+
+template <int N>
+double MctsSearchT<N>::ExpandAndEvaluate(Worker &worker, MctsNode &node, Piece side, bool expand)
+{
+    BitBoardT<N> &board = worker.pos.board;
+    int c = side - 1;
+    ThreatMapT<N> own, other;
+    FindThreats(board, c, PATTERN_FIVE, own);
+    FindThreats(board, 1 - c, PATTERN_FIVE, other);
+
+    MoveListT<N> list;
+    double value = 0;
+    bool terminalChildren = false;
+    int otherFives = 0;
+    for (int y = 0; y < N; y++)
+    {
+        if (own.five[y] && list.size == 0)
+        {
+            list.Add((uint16_t)(y * N + __builtin_ctz(own.five[y])), 1);
+            terminalChildren = true;
+        }
+        otherFives += __builtin_popcount(other.five[y]);
+    }
+    if (terminalChildren)
+    {
+        // 轮到的一方直接成五,只保留这一步
+        value = 1.0;
+    }
+    else if (otherFives > 0)
+    {
+        // 只能去堵对方成五的点,有两个以上时堵不住
+        for (int y = 0; y < N; y++)
+        {
+            uint32_t mask = other.five[y];
+            while (mask)
+            {
+                int x = __builtin_ctz(mask);
+                mask &= mask - 1;
+                list.Add((uint16_t)(y * N + x), 1);
+            }
+        }
+        value = (otherFives > 1) ? -1.0 : std::tanh(worker.pos.Evaluate(side) / MCTS_EVAL_SCALE);
+    }
+    else
+    {
+        ThreatResult vcf;
+        bool win = false;
+        if (leafVcfBudget > 0)
+        {
+            ThreatLimits limits;
+            limits.nodes = leafVcfBudget;
+            win = worker.threats.Solve(board, side, THREAT_VCF, limits, vcf);
+            worker.leafVcfNodes += vcf.nodes;
+        }
+        if (win)
+        {
+            // 有必胜的连续冲四时只保留它的第一步,这条线很快就会一直走到成五
+            list.Add((uint16_t)(vcf.move.second * N + vcf.move.first), 1);
+            value = 1.0;
+        }
+        else
+        {
+            for (int y = 0; expand && y < N; y++)
+            {
+                uint32_t mask = board.NeighborMask(y);
+                while (mask)
+                {
+                    int x = __builtin_ctz(mask);
+                    mask &= mask - 1;
+                    // 与主变例搜索的走法排序相同:进攻分数加上一半的防守分数
+                    list.Add((uint16_t)(y * N + x), board.ThreatScore(x, y, c) + board.ThreatScore(x, y, 1 - c) / 2 + 1);
+                }
+            }
+            if (expand && list.size == 0 && board.stoneCount == 0)
+                list.Add((uint16_t)(N / 2 * N + N / 2), 1);
+            value = std::tanh(worker.pos.Evaluate(side) / MCTS_EVAL_SCALE);
+        }
+    }
+    if (!expand)
+        return value;
+
+    int count = std::min(list.size, MCTS_MAX_CHILDREN);
+    if (count == 0)
+    {
+        // 棋盘已满,和棋
+        node.state.store(MCTS_LEAF, std::memory_order_release);
+        return 0;
+    }
+    uint32_t first = next.fetch_add((uint32_t)count, std::memory_order_relaxed);
+    if (first + count > capacity)
+    {
+        full.store(true, std::memory_order_relaxed);
+        node.state.store(MCTS_LEAF, std::memory_order_release);
+        return value;
+    }
+    // 先验概率与排序分数的平方根成正比:活三,冲四远高于普通走法,又不至于完全压住其余走法
+    double weights[MCTS_MAX_CHILDREN];
+    double total = 0;
+    for (int k = 0; k < count; k++)
+    {
+        list.PickNext(k);
+        weights[k] = std::sqrt((double)list.scores[k]);
+        total += weights[k];
+    }
+    MctsNode *pool = Pool();
+    for (int k = 0; k < count; k++)
+        pool[first + k].Init(list.moves[k], (float)(weights[k] / total), terminalChildren ? MCTS_TERMINAL : MCTS_LEAF);
+    node.firstChild = first;
+    node.childCount = (uint8_t)count;
+    node.state.store(MCTS_EXPANDED, std::memory_order_release);
+    return value;
+}
+
+template <int N>
+void MctsSearchT<N>::Playout(Worker &worker)
+{
+    Position &pos = worker.pos;
+    std::vector<MctsNode *> &path = worker.path;
+    path.clear();
+    MctsNode *node = &Pool()[root];
+    node->visits.fetch_add(1, std::memory_order_relaxed);
+    path.push_back(node);
+    Piece side = rootSide;
+    double value; // 走到node的一方的视角
+    while (true)
+    {
+        uint8_t state = node->state.load(std::memory_order_acquire);
+        if (state == MCTS_TERMINAL)
+        {
+            value = 1.0;
+            break;
+        }
+        if (state != MCTS_EXPANDED)
+        {
+            // 抢到展开权的线程负责展开,其余线程只评估
+            uint8_t expected = MCTS_LEAF;
+            bool expand = state == MCTS_LEAF &&
+                          node->state.compare_exchange_strong(expected, MCTS_EXPANDING, std::memory_order_acq_rel);
+            value = -ExpandAndEvaluate(worker, *node, side, expand);
+            break;
+        }
+        MctsNode *child = SelectChild(*node);
+        // 虚拟失败:回传时换成真实的价值
+        child->visits.fetch_add(1, std::memory_order_relaxed);
+        child->valueSum.fetch_sub(MCTS_VALUE_ONE, std::memory_order_relaxed);
+        pos.MakeMove(child->move % N, child->move / N, side);
+        path.push_back(child);
+        node = child;
+        side = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    }
+    for (size_t i = path.size(); i-- > 0;)
+    {
+        int64_t delta = (int64_t)std::lround(value * MCTS_VALUE_ONE) + (i > 0 ? MCTS_VALUE_ONE : 0);
+        path[i]->valueSum.fetch_add(delta, std::memory_order_relaxed);
+        value = -value;
+    }
+    for (size_t i = path.size() - 1; i > 0; i--)
+        pos.UnmakeMove(path[i]->move % N, path[i]->move / N);
+}
+
+template <int N>
+const MctsNode *MctsSearchT<N>::BestChild(const MctsNode &node) const
+{
+    if (node.state.load(std::memory_order_acquire) != MCTS_EXPANDED)
+        return nullptr;
+    const MctsNode *children = Pool() + node.firstChild;
+    const MctsNode *best = nullptr;
+    for (int k = 0; k < node.childCount; k++)
+    {
+        const MctsNode &child = children[k];
+        if (child.state.load(std::memory_order_relaxed) == MCTS_TERMINAL)
+            return &child;
+        if (!best || child.visits.load(std::memory_order_relaxed) > best->visits.load(std::memory_order_relaxed))
+            best = &child;
+    }
+    return best;
+}
+
+template <int N>
+int MctsSearchT<N>::PrincipalDepth() const
+{
+    int depth = 0;
+    const MctsNode *node = BestChild(Pool()[root]);
+    while (node && node->visits.load(std::memory_order_relaxed) > 0)
+    {
+        depth++;
+        node = BestChild(*node);
+    }
+    return depth;
+}
+
+template <int N>
+void MctsSearchT<N>::Run(Worker &worker, int id, SearchResult &result)
+{
+    const MctsNode &rootNode = Pool()[root];
+    int recordedDepth = 0;
+    while (!shared->stop.load(std::memory_order_relaxed))
+    {
+        Playout(worker);
+        long long done = playouts.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (id != 0)
+            continue;
+
+        bool stop = full.load(std::memory_order_relaxed);
+        if (shared->cancel && shared->cancel->load(std::memory_order_relaxed))
+            stop = true;
+        else if (!shared->Pondering())
+        {
+            long long budget = shared->nodeBudget;
+            if (budget == 0 && shared->moveTimeMs == 0)
+                budget = MCTS_DEFAULT_PLAYOUTS;
+            if (budget > 0 && done >= budget)
+                stop = true;
+            // 每64次模拟读一次时钟
+            else if (shared->moveTimeMs > 0 && (done & 63) == 0 && std::chrono::steady_clock::now() >= shared->deadline)
+                stop = true;
+        }
+        const MctsNode *best = BestChild(rootNode);
+        // 只有一步可走,或者可以直接成五
+        if (best && (rootNode.childCount == 1 || best->state.load(std::memory_order_relaxed) == MCTS_TERMINAL))
+            stop = true;
+        if (best && ((done & 255) == 0 || stop))
+        {
+            int depth = PrincipalDepth();
+            shared->searchingDepth.store(depth, std::memory_order_relaxed);
+            shared->bestMoveSoFar.store(best->move, std::memory_order_relaxed);
+            if (depth > recordedDepth)
+            {
+                recordedDepth = depth;
+                int score = ChildScore(*best);
+                result.iterations.push_back({depth, (rootSide == PIECE_BLACK) ? score : -score,
+                                             {best->move % N, best->move / N}, done, shared->ElapsedMs()});
+            }
+        }
+        if (stop)
+            shared->stop.store(true, std::memory_order_relaxed);
+    }
+}
+
+template <int N>
+void MctsSearchT<N>::Search(const Position &pos, Piece side, SearchShared &control, int threads,
+                            long long leafVcfNodes, SearchResult &result)
+{
+    shared = &control;
+    leafVcfBudget = leafVcfNodes;
+    uint32_t found = FindNode(pos, side);
+    if (found != NO_NODE && found != root)
+        Compact(found);
+    // 留下的子树占了节点池的一半以上时,剩下的空间不够这一步用,重新开始
+    if (found == NO_NODE || next.load(std::memory_order_relaxed) > capacity / 2)
+    {
+        Pool()[0].Init(NO_MOVE, 1.0f, MCTS_LEAF);
+        root = 0;
+        next.store(1, std::memory_order_relaxed);
+    }
+    rootBoard = pos.board;
+    rootSide = side;
+    full.store(false);
+    playouts.store(0);
+
+    while ((int)workers.size() < threads)
+        workers.emplace_back(new Worker());
+    for (int i = 0; i < threads; i++)
+    {
+        workers[i]->pos = pos;
+        workers[i]->pos.SetNetwork(control.network);
+        workers[i]->pos.SetPatternTable(control.patternTable);
+        workers[i]->leafVcfNodes = 0;
+    }
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < threads; i++)
+    {
+        Worker *helper = workers[i].get();
+        helpers.emplace_back([this, helper, i, &result]()
+                             { Run(*helper, i, result); });
+    }
+    Run(*workers[0], 0, result);
+    for (auto &helper : helpers)
+        helper.join();
+
+    const MctsNode *best = BestChild(Pool()[root]);
+    if (best)
+    {
+        int score = ChildScore(*best);
+        result.bestMove = {best->move % N, best->move / N};
+        result.score = (side == PIECE_BLACK) ? score : -score;
+    }
+    result.depth = PrincipalDepth();
+    result.nodes = playouts.load();
+    for (int i = 0; i < threads; i++)
+        result.leafVcfNodes += workers[i]->leafVcfNodes;
+}
+
+template <int N>
+bool MctsSearchT<N>::PredictMove(const Position &pos, Piece side, std::pair<int, int> &move) const
+{
+    uint32_t index = FindNode(pos, side);
+    if (index == NO_NODE)
+        return false;
+    const MctsNode *best = BestChild(Pool()[index]);
+    if (!best || best->visits.load(std::memory_order_relaxed) == 0)
+        return false;
+    move = {best->move % N, best->move / N};
+    return pos.board.IsEmpty(move.first, move.second);
+}
+
+template class MctsSearchT<15>;
+template class MctsSearchT<19>;
@@ -0,0 +1,141 @@
+// 蒙特卡洛树搜索(MCTS):按PUCT公式选择走法,叶节点不做随机模拟,价值由一次小预算的VCF和局面评估给出
+// 多个线程共同扩展同一棵树(树并行):下降时给经过的节点记上一次虚拟的失败,其他线程暂时避开这条路径;
+// 展开节点时用原子操作占位,不加锁;节点从预先分配的节点池中成块取用,搜索过程中不分配内存
+// 一步搜索完后保留整棵树,下一步从实际走到的局面对应的子树继续
+#pragma once
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "search.h"
+
+// 每个节点最多保留的子节点数:按走法排序分数取前面的,离战斗很远的空位几乎不会是好棋
+const int MCTS_MAX_CHILDREN = 24;
+// PUCT的探索常数
+const double MCTS_CPUCT = 1.5;
+// 没有访问过的子节点按父节点的价值减去这个值估计
+const double MCTS_FPU_REDUCTION = 0.2;
+// 评估分数换算成价值:tanh(分数 / MCTS_EVAL_SCALE)
+const double MCTS_EVAL_SCALE = 800.0;
+// 没有时间和节点预算时每步的模拟次数
+const long long MCTS_DEFAULT_PLAYOUTS = 100000;
+// 价值的定点表示,1.0对应的整数
+const int64_t MCTS_VALUE_ONE = 1 << 16;
+
+// 节点的状态
+enum MctsNodeState : uint8_t
+{
+    MCTS_LEAF,      // 还没有展开
+    MCTS_EXPANDING, // 有线程正在展开,其他线程把它当作叶节点
+    MCTS_EXPANDED,  // 子节点已经就绪
+    MCTS_TERMINAL   // 走到这里的一方成五
+};
+
+// 树的节点,价值是走到这个节点的一方的视角
+// visits和valueSum包含正在进行的模拟记上的虚拟失败,模拟结束时换成真实的价值
+struct MctsNode
+{
+    std::atomic<int64_t> valueSum; // 价值之和,定点数
+    std::atomic<int32_t> visits;   // 访问次数
+    uint32_t firstChild;           // 子节点在节点池中连续存放,展开完成之前不可读
+    float prior;                   // 走法的先验概率
+    uint16_t move;                 // 走到这个节点的走法,y * N + x
+    uint8_t childCount;
+    std::atomic<uint8_t> state;    // MctsNodeState
+
+    void Init(uint16_t m, float p, MctsNodeState s)
+    {
+        valueSum.store(0, std::memory_order_relaxed);
+        visits.store(0, std::memory_order_relaxed);
+        firstChild = 0;
+        prior = p;
+        move = m;
+        childCount = 0;
+        state.store(s, std::memory_order_relaxed);
+    }
+
+    // 访问过时的平均价值
+    double Q() const
+    {
+        int n = visits.load(std::memory_order_relaxed);
+        return n > 0 ? (double)valueSum.load(std::memory_order_relaxed) / ((double)n * MCTS_VALUE_ONE) : 0.0;
+    }
+};
+
+// 蒙特卡洛树搜索:持有节点池和上一步留下的树,由SearchEngineT在配置为MCTS时使用
+template <int N>
+class MctsSearchT
+{
+public:
+    using Position = PositionT<N>;
+
+    // 按megabytes分配节点池,分成两块,复用子树时复制到另一块,丢掉其余部分
+    explicit MctsSearchT(int megabytes);
+
+    // 丢弃整棵树,新的一局时调用
+    void Clear();
+
+    size_t SizeInBytes() const { return 2 * (size_t)capacity * sizeof(MctsNode); }
+
+    // 用threads个线程(调用线程和threads-1个辅助线程)搜索side一方的最佳走法
+    // 时间,节点(模拟次数)预算,取消和后台思考标记由shared给出,用法与主变例搜索相同
+    // 结果中depth是访问最多的路径的长度,nodes是这一步的模拟次数,iterations在这条路径变长时记录一次
+    void Search(const Position &pos, Piece side, SearchShared &shared, int threads, long long leafVcfNodes,
+                SearchResult &result);
+
+    // 在上一次搜索留下的树中找到pos,返回轮到的side一方访问最多的走法,找不到时返回false
+    bool PredictMove(const Position &pos, Piece side, std::pair<int, int> &move) const;
+
+private:
+    static const uint32_t NO_NODE = 0xFFFFFFFFu;
+
+    // 每个线程的局面副本和最后一层VCF
+    struct Worker
+    {
+        Position pos;
+        ThreatSolverT<N> threats;
+        std::vector<MctsNode *> path;
+        long long leafVcfNodes = 0;
+    };
+
+    std::unique_ptr<MctsNode[]> pools[2];
+    uint32_t capacity;
+    int active = 0;                    // 正在使用的一块
+    std::atomic<uint32_t> next{0};     // 下一个空闲节点
+    std::atomic<bool> full{false};     // 节点池已满,本次搜索随即停止
+    uint32_t root = NO_NODE;
+    BitBoardT<N> rootBoard;            // 根节点的局面
+    Piece rootSide = PIECE_BLACK;      // 根节点轮到的一方
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<long long> playouts{0};
+    SearchShared *shared = nullptr;
+    long long leafVcfBudget = 0;
+
+    MctsNode *Pool() const { return pools[active].get(); }
+
+    // 从根节点沿着pos比根节点多出的棋子往下走,返回pos对应的节点
+    uint32_t FindNode(const Position &pos, Piece side) const;
+
+    // 把以index为根的子树按层复制到另一块节点池,之后改用那一块
+    void Compact(uint32_t index);
+
+    // 一次模拟:从根节点按PUCT下降到叶节点,展开并评估,沿路径回传价值
+    void Playout(Worker &worker);
+
+    // 轮到side一方,按PUCT选出node的子节点
+    MctsNode *SelectChild(MctsNode &node) const;
+
+    // 评估轮到side一方的局面,返回side一方视角的价值;expand为true时同时展开node
+    double ExpandAndEvaluate(Worker &worker, MctsNode &node, Piece side, bool expand);
+
+    // 线程主循环,id为0的线程负责检查预算和更新进度
+    void Run(Worker &worker, int id, SearchResult &result);
+
+    // 根节点访问最多的子节点
+    const MctsNode *BestChild(const MctsNode &node) const;
+
+    // 沿访问最多的子节点往下走的路径长度
+    int PrincipalDepth() const;
+};
+
+using MctsSearch = MctsSearchT<BOARD_SIZE>;
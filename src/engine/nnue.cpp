@@ -0,0 +1,178 @@
+#include "nnue.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NNUE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    const int NNUE_INPUTS = 2 * NNUE_HIDDEN;
+
+    inline uint8_t ClippedActivation(int value)
+    {
+        return (uint8_t)std::min(std::max(value, 0), NNUE_ACTIVATION_MAX);
+    }
+
+    // 两层全连接的标量实现,与AVX2实现逐位一致
+    int EvaluateScalar(const NnueNetwork &net, const int16_t *own, const int16_t *other)
+    {
+        uint8_t input[NNUE_INPUTS];
+        for (int h = 0; h < NNUE_HIDDEN; h++)
+        {
+            input[h] = ClippedActivation(own[h]);
+            input[NNUE_HIDDEN + h] = ClippedActivation(other[h]);
+        }
+        int output = net.outputBias;
+        for (int o = 0; o < NNUE_DENSE; o++)
+        {
+            const int8_t *weights = &net.denseWeights[(size_t)o * NNUE_INPUTS];
+            int sum = net.denseBias[o];
+            for (int k = 0; k < NNUE_INPUTS; k++)
+                sum += input[k] * weights[k];
+            output += ClippedActivation(sum / NNUE_WEIGHT_SCALE) * net.outputWeights[o];
+        }
+        return output;
+    }
+
+#ifdef NNUE_X86
+    // 16个int16截断成uint8:饱和压缩到int8之后与0取大,压缩指令按128位分组交错,再用置换恢复顺序
+    __attribute__((target("avx2"))) inline __m256i ClipPack(const int16_t *values)
+    {
+        __m256i low = _mm256_loadu_si256((const __m256i *)values);
+        __m256i high = _mm256_loadu_si256((const __m256i *)(values + 16));
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xD8);
+        return _mm256_max_epi8(packed, _mm256_setzero_si256());
+    }
+
+    // uint8乘int8两两相加不会饱和:输入不超过127,两项之和的绝对值不超过2*127*128
+    __attribute__((target("avx2"))) int EvaluateAvx2(const NnueNetwork &net, const int16_t *own, const int16_t *other)
+    {
+        alignas(32) uint8_t input[NNUE_INPUTS];
+        for (int h = 0; h < NNUE_HIDDEN; h += 32)
+        {
+            _mm256_store_si256((__m256i *)(input + h), ClipPack(own + h));
+            _mm256_store_si256((__m256i *)(input + NNUE_HIDDEN + h), ClipPack(other + h));
+        }
+        const __m256i ones = _mm256_set1_epi16(1);
+        int output = net.outputBias;
+        for (int o = 0; o < NNUE_DENSE; o++)
+        {
+            const int8_t *weights = &net.denseWeights[(size_t)o * NNUE_INPUTS];
+            __m256i acc = _mm256_setzero_si256();
+            for (int k = 0; k < NNUE_INPUTS; k += 32)
+            {
+                __m256i in = _mm256_load_si256((const __m256i *)(input + k));
+                __m256i w = _mm256_loadu_si256((const __m256i *)(weights + k));
+                acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+            }
+            __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+            int value = net.denseBias[o] + _mm_cvtsi128_si32(sum);
+            output += ClippedActivation(value / NNUE_WEIGHT_SCALE) * net.outputWeights[o];
+        }
+        return output;
+    }
+#endif
+
+    template <typename T>
+    bool ReadArray(FILE *file, std::vector<T> &data, size_t count)
+    {
+        data.resize(count);
+        return fread(data.data(), sizeof(T), count, file) == count;
+    }
+
+    template <typename T>
+    bool WriteArray(FILE *file, const std::vector<T> &data)
+    {
+        return fwrite(data.data(), sizeof(T), data.size(), file) == data.size();
+    }
+}
+
+void NnueNetwork::Allocate(int size, int scale)
+{
+    boardSize = size;
+    scoreScale = scale;
+    featureBias.assign(NNUE_HIDDEN, 0);
+    featureWeights.assign((size_t)2 * size * size * NNUE_HIDDEN, 0);
+    denseBias.assign(NNUE_DENSE, 0);
+    denseWeights.assign((size_t)NNUE_DENSE * NNUE_INPUTS, 0);
+    outputBias = 0;
+    outputWeights.assign(NNUE_DENSE, 0);
+}
+
+bool NnueNetwork::Load(const std::string &path)
+{
+    boardSize = 0;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    NnueHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, NNUE_MAGIC, sizeof(NNUE_MAGIC)) == 0 && header.version == NNUE_VERSION &&
+              IsSupportedBoardSize((int)header.boardSize) && header.hidden == (uint32_t)NNUE_HIDDEN &&
+              header.dense == (uint32_t)NNUE_DENSE && header.scoreScale > 0;
+    if (ok)
+    {
+        int size = (int)header.boardSize;
+        ok = ReadArray(file, featureBias, NNUE_HIDDEN) &&
+             ReadArray(file, featureWeights, (size_t)2 * size * size * NNUE_HIDDEN) &&
+             ReadArray(file, denseBias, NNUE_DENSE) &&
+             ReadArray(file, denseWeights, (size_t)NNUE_DENSE * NNUE_INPUTS) &&
+             fread(&outputBias, sizeof(outputBias), 1, file) == 1 &&
+             ReadArray(file, outputWeights, NNUE_DENSE) && fgetc(file) == EOF;
+        // 超出范围的权重可能让累加器溢出,当作损坏的文件
+        for (size_t i = 0; ok && i < featureWeights.size(); i++)
+            ok = std::abs(featureWeights[i]) <= NNUE_FEATURE_WEIGHT_LIMIT;
+        for (int h = 0; ok && h < NNUE_HIDDEN; h++)
+            ok = std::abs(featureBias[h]) <= NNUE_FEATURE_WEIGHT_LIMIT;
+        if (ok)
+        {
+            boardSize = size;
+            scoreScale = header.scoreScale;
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+bool NnueNetwork::Save(const std::string &path) const
+{
+    if (!Loaded())
+        return false;
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    NnueHeader header;
+    memcpy(header.magic, NNUE_MAGIC, sizeof(NNUE_MAGIC));
+    header.version = NNUE_VERSION;
+    header.boardSize = (uint32_t)boardSize;
+    header.hidden = NNUE_HIDDEN;
+    header.dense = NNUE_DENSE;
+    header.scoreScale = scoreScale;
+    header.reserved = 0;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && WriteArray(file, featureBias) &&
+              WriteArray(file, featureWeights) && WriteArray(file, denseBias) && WriteArray(file, denseWeights) &&
+              fwrite(&outputBias, sizeof(outputBias), 1, file) == 1 && WriteArray(file, outputWeights);
+    return fclose(file) == 0 && ok;
+}
+
+int NnueNetwork::Evaluate(const int16_t *own, const int16_t *other, LineKernelKind kind) const
+{
+    int output;
+#ifdef NNUE_X86
+    if (kind == LINE_KERNEL_AVX2 && LineKernelSupported(kind))
+        output = EvaluateAvx2(*this, own, other);
+    else
+        output = EvaluateScalar(*this, own, other);
+#else
+    (void)kind;
+    output = EvaluateScalar(*this, own, other);
+#endif
+    // 网络输出的127*64表示1.0
+    return (int)((int64_t)output * scoreScale / (NNUE_ACTIVATION_MAX * NNUE_WEIGHT_SCALE));
+}
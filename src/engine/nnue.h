@@ -0,0 +1,145 @@
+// 神经网络评估(NNUE风格):第一层的输入是棋子的位置,落子和悔棋时增量更新累加器,后面两层是很小的整数全连接层
+// 网络结构:
+//   输入   每个视角2*N*N个0/1特征(己方棋子在某格,对方棋子在某格)
+//   累加器 每个视角NNUE_HIDDEN个int16,等于偏置加上所有有效特征对应的权重行
+//   第一层 轮到的一方的累加器在前,另一方在后,截断到[0,127]后作为2*NNUE_HIDDEN个uint8输入,输出NNUE_DENSE个
+//   第二层 NNUE_DENSE个截断到[0,127]的uint8输入,输出一个分数
+// 两个视角共用同一份第一层权重,黑白交换后同一个局面的分数只差一个符号
+// 量化:累加器的127表示1.0,两层全连接的权重乘以64取整为int8,偏置乘以127*64取整为int32
+// 文件格式(小端):
+//   文件头 NnueHeader,32字节
+//   int16 featureBias[NNUE_HIDDEN]
+//   int16 featureWeights[2*N*N][NNUE_HIDDEN]  前N*N行是己方棋子,后N*N行是对方棋子,行内按 y*N+x
+//   int32 denseBias[NNUE_DENSE]
+//   int8  denseWeights[NNUE_DENSE][2*NNUE_HIDDEN]
+//   int32 outputBias
+//   int8  outputWeights[NNUE_DENSE]
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "line_kernel.h"
+
+const char NNUE_MAGIC[8] = {'G', 'M', 'K', 'N', 'N', 'U', 'E', '1'};
+const uint32_t NNUE_VERSION = 1;
+const int NNUE_HIDDEN = 128;      // 每个视角的累加器宽度
+const int NNUE_DENSE = 32;        // 第一层全连接的输出个数
+const int NNUE_ACTIVATION_MAX = 127; // 截断激活的上限,表示1.0
+const int NNUE_WEIGHT_SCALE = 64;    // 全连接层权重的量化倍数
+// 累加器是int16,每一格的权重限制在这个范围内,19路棋盘下满盘棋子加上偏置也不会溢出
+const int NNUE_FEATURE_WEIGHT_LIMIT = 80;
+
+struct NnueHeader
+{
+    char magic[8];       // NNUE_MAGIC
+    uint32_t version;    // NNUE_VERSION
+    uint32_t boardSize;  // 棋盘大小
+    uint32_t hidden;     // NNUE_HIDDEN
+    uint32_t dense;      // NNUE_DENSE
+    int32_t scoreScale;  // 网络输出1.0对应的评估分数
+    uint32_t reserved;
+};
+
+static_assert(sizeof(NnueHeader) == 32, "网络文件的格式依赖文件头的大小");
+
+// 训练好的网络,加载后只读,所有搜索线程共用
+class NnueNetwork
+{
+public:
+    // 读取网络文件,文件不完整或者结构与NNUE_HIDDEN,NNUE_DENSE不一致时返回false
+    bool Load(const std::string &path);
+    bool Save(const std::string &path) const;
+
+    bool Loaded() const { return boardSize != 0; }
+    int BoardSize() const { return boardSize; }
+
+    // 按棋盘大小分配全为0的权重,训练工具量化之前调用
+    void Allocate(int size, int scale);
+
+    const int16_t *FeatureRow(int feature) const { return &featureWeights[(size_t)feature * NNUE_HIDDEN]; }
+
+    // 由轮到的一方和另一方的累加器算出分数(轮到的一方视角),kind选择标量或AVX2实现,两者结果完全相同
+    int Evaluate(const int16_t *own, const int16_t *other, LineKernelKind kind) const;
+    int Evaluate(const int16_t *own, const int16_t *other) const { return Evaluate(own, other, BestLineKernel()); }
+
+    int boardSize = 0;
+    int scoreScale = 0;
+    std::vector<int16_t> featureBias;    // [NNUE_HIDDEN]
+    std::vector<int16_t> featureWeights; // [2*N*N][NNUE_HIDDEN]
+    std::vector<int32_t> denseBias;      // [NNUE_DENSE]
+    std::vector<int8_t> denseWeights;    // [NNUE_DENSE][2*NNUE_HIDDEN]
+    int32_t outputBias = 0;
+    std::vector<int8_t> outputWeights;   // [NNUE_DENSE]
+};
+
+// 累加器:黑方视角和白方视角各一份,随局面增量更新;没有网络时什么也不做
+// 加减是精确的整数运算,悔棋时减去同一行权重就回到落子之前,不需要撤销记录
+template <int N>
+struct NnueAccumulatorT
+{
+    const NnueNetwork *network = nullptr;
+    alignas(32) int16_t values[2][NNUE_HIDDEN];
+
+    // 换网络或者换局面时从整个棋盘重算,network为空表示不用网络评估
+    void Reset(const BitBoardT<N> &board, const NnueNetwork *net)
+    {
+        network = net;
+        if (!network)
+            return;
+        for (int perspective = 0; perspective < 2; perspective++)
+        {
+            for (int h = 0; h < NNUE_HIDDEN; h++)
+                values[perspective][h] = network->featureBias[h];
+        }
+        for (int y = 0; y < N; y++)
+        {
+            for (int x = 0; x < N; x++)
+            {
+                if (!board.IsEmpty(x, y))
+                    OnPlace(x, y, board.At(x, y));
+            }
+        }
+    }
+
+    void OnPlace(int x, int y, Piece piece)
+    {
+        if (!network)
+            return;
+        for (int perspective = 0; perspective < 2; perspective++)
+        {
+            const int16_t *row = network->FeatureRow(Feature(perspective, piece, x, y));
+            int16_t *value = values[perspective];
+            for (int h = 0; h < NNUE_HIDDEN; h++)
+                value[h] += row[h];
+        }
+    }
+
+    void OnRemove(int x, int y, Piece piece)
+    {
+        if (!network)
+            return;
+        for (int perspective = 0; perspective < 2; perspective++)
+        {
+            const int16_t *row = network->FeatureRow(Feature(perspective, piece, x, y));
+            int16_t *value = values[perspective];
+            for (int h = 0; h < NNUE_HIDDEN; h++)
+                value[h] -= row[h];
+        }
+    }
+
+    // 轮到side一方时的分数,side一方的视角
+    int Evaluate(Piece side) const
+    {
+        int own = side - 1;
+        return network->Evaluate(values[own], values[1 - own]);
+    }
+
+    // perspective一方看到的特征编号:0黑1白,与棋子颜色相同的是己方
+    static int Feature(int perspective, Piece piece, int x, int y)
+    {
+        return (piece - 1 == perspective ? 0 : N * N) + y * N + x;
+    }
+};
+
+using NnueAccumulator = NnueAccumulatorT<BOARD_SIZE>;
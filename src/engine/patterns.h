@@ -0,0 +1,152 @@
+// 棋型查找表:以一个棋子为中心,取它所在的线上前后各4格组成窗口,
+// 窗口编码成下标后一次查表就得到棋型和分数,表在编译期生成
+#pragma once
+#include <cstdint>
+
+// 棋型,按威胁从小到大排列,都是指经过中心棋子的形状
+enum PatternClass : uint8_t
+{
+    PATTERN_NONE,          // 两侧被堵,已经成不了五
+    PATTERN_ONE,           // 单子
+    PATTERN_BLOCKED_TWO,   // 眠二:再下一子最多成眠三
+    PATTERN_TWO,           // 活二:再下一子可以成活三
+    PATTERN_BLOCKED_THREE, // 眠三:再下一子最多成冲四
+    PATTERN_SPLIT_THREE,   // 跳活三,例如 _X_XX_
+    PATTERN_THREE,         // 连活三,例如 _XXX_
+    PATTERN_FOUR,          // 冲四:只有一个点能成五,包括 XXXX_, X_XXX 和 XX_XX
+    PATTERN_OPEN_FOUR,     // 活四:有两个以上的点能成五
+    PATTERN_FIVE,          // 五连(含长连)
+    PATTERN_COUNT
+};
+
+const int PATTERN_RADIUS = 4;         // 窗口向两侧各取4格,共9格,足以覆盖所有经过中心的五格
+const int PATTERN_TABLE_SIZE = 6561;  // 中心以外的8格,每格空,己方,被堵三种状态: 3^8
+
+// 评估时每个棋子按所在的棋型计分,一个棋型里的每个子各计一次,
+// 例如活二2*25=50,眠三3*35=105,活三3*170=510,冲四4*160=640,活四4*650=2600
+constexpr int16_t PATTERN_STONE_SCORE[PATTERN_COUNT] = {0, 1, 5, 25, 35, 150, 170, 160, 650, 0};
+
+// 查找表的一项,棋型和分数放在一起,一次读取
+struct PatternEntry
+{
+    int16_t score;   // 中心棋子的评估分数
+    uint8_t pattern; // 中心棋子所在的棋型
+};
+
+// 编译期生成的查找表
+// 窗口的8格按 -4..-1,+1..+4 的顺序作为3进制的各位:0空,1己方,2对方或棋盘外
+// 多一个己方棋子的窗口下标更大,所以从大到小生成,每一项都可以引用已经算好的"再下一子"的结果
+struct PatternTable
+{
+    PatternEntry entries[PATTERN_TABLE_SIZE];
+    uint16_t ternary[256]; // 8位二进制掩码各位当作3进制数的值,用来把两个位掩码拼成下标
+
+    constexpr PatternTable() : entries(), ternary()
+    {
+        for (int bits = 0; bits < 256; bits++)
+        {
+            int value = 0, weight = 1;
+            for (int k = 0; k < 8; k++)
+            {
+                if ((bits >> k) & 1)
+                    value += weight;
+                weight *= 3;
+            }
+            ternary[bits] = (uint16_t)value;
+        }
+        for (int index = PATTERN_TABLE_SIZE - 1; index >= 0; index--)
+        {
+            uint8_t pattern = Classify(index);
+            entries[index].pattern = pattern;
+            entries[index].score = PATTERN_STONE_SCORE[pattern];
+        }
+    }
+
+    constexpr uint8_t Classify(int index) const
+    {
+        int cells[2 * PATTERN_RADIUS + 1] = {};
+        int weights[8] = {};
+        int rest = index, weight = 1;
+        for (int k = 0; k < 8; k++)
+        {
+            cells[k < 4 ? k : k + 1] = rest % 3;
+            rest /= 3;
+            weights[k] = weight;
+            weight *= 3;
+        }
+        cells[PATTERN_RADIUS] = 1;
+
+        // 检查每个经过中心的五格:全是己方为五连,差一子时记下能成五的空位
+        bool open = false;
+        int winPoints = 0; // 能成五的空位,按格子位置记录
+        for (int start = 0; start <= PATTERN_RADIUS; start++)
+        {
+            int own = 0, empty = -1;
+            bool blocked = false;
+            for (int i = start; i < start + 5; i++)
+            {
+                if (cells[i] == 1)
+                    own++;
+                else if (cells[i] == 2)
+                    blocked = true;
+                else
+                    empty = i;
+            }
+            if (blocked)
+                continue;
+            open = true;
+            if (own == 5)
+                return PATTERN_FIVE;
+            if (own == 4)
+                winPoints |= 1 << empty;
+        }
+        if (winPoints)
+            return (winPoints & (winPoints - 1)) ? PATTERN_OPEN_FOUR : PATTERN_FOUR;
+        if (!open)
+            return PATTERN_NONE;
+
+        // 再下一子能形成的最好棋型决定当前棋型
+        uint8_t best = PATTERN_NONE;
+        for (int k = 0; k < 8; k++)
+        {
+            if (cells[k < 4 ? k : k + 1] == 0 && entries[index + weights[k]].pattern > best)
+                best = entries[index + weights[k]].pattern;
+        }
+        if (best == PATTERN_OPEN_FOUR)
+        {
+            int run = 1;
+            for (int i = PATTERN_RADIUS + 1; i < 2 * PATTERN_RADIUS + 1 && cells[i] == 1; i++)
+                run++;
+            for (int i = PATTERN_RADIUS - 1; i >= 0 && cells[i] == 1; i--)
+                run++;
+            return (run >= 3) ? PATTERN_THREE : PATTERN_SPLIT_THREE;
+        }
+        if (best == PATTERN_FOUR)
+            return PATTERN_BLOCKED_THREE;
+        if (best == PATTERN_THREE || best == PATTERN_SPLIT_THREE)
+            return PATTERN_TWO;
+        if (best == PATTERN_BLOCKED_THREE)
+            return PATTERN_BLOCKED_TWO;
+        return PATTERN_ONE;
+    }
+};
+
+inline constexpr PatternTable PATTERNS{};
+
+// 由一条线的掩码得到以pos为中心的窗口下标
+// own为己方棋子,blocked为对方棋子和线外的格子(高于线长的位必须置1),中心格本身不参与编码
+inline int PatternIndex(uint32_t own, uint32_t blocked, int pos)
+{
+    uint32_t o = (uint32_t)(((uint64_t)own << PATTERN_RADIUS) >> pos);
+    uint32_t b = (uint32_t)((((uint64_t)blocked << PATTERN_RADIUS) | 0xFu) >> pos); // 低于0的格子也是线外
+    o = (o & 0xFu) | ((o >> 1) & 0xF0u);
+    b = (b & 0xFu) | ((b >> 1) & 0xF0u);
+    return PATTERNS.ternary[o] + 2 * PATTERNS.ternary[b];
+}
+
+// 一次查表得到棋型和分数;table是换了分数的查找表(见weights.h),棋型与PATTERNS相同
+inline const PatternEntry &LookupPattern(uint32_t own, uint32_t blocked, int pos,
+                                         const PatternEntry *table = PATTERNS.entries)
+{
+    return table[PatternIndex(own, blocked, pos)];
+}
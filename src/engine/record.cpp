@@ -0,0 +1,147 @@
+#include "record.h"
+#include <algorithm>
+#include <cstring>
+
+bool GameRecordWriter::Open(const std::string &path, bool append)
+{
+    Close();
+    if (append)
+    {
+        // 已有内容时先检查文件头,不往别的文件后面追加
+        FILE *existing = fopen(path.c_str(), "rb");
+        if (existing)
+        {
+            char magic[sizeof(RECORD_MAGIC)];
+            size_t read = fread(magic, 1, sizeof(magic), existing);
+            fclose(existing);
+            if (read > 0)
+            {
+                if (read != sizeof(magic) || memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0)
+                    return false;
+                file = fopen(path.c_str(), "ab");
+                return file != nullptr;
+            }
+        }
+    }
+    file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    if (fwrite(RECORD_MAGIC, sizeof(RECORD_MAGIC), 1, file) != 1)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool GameRecordWriter::Write(const GameRecord &game)
+{
+    if (!file || !IsSupportedBoardSize(game.boardSize) || game.moves.size() > (size_t)(game.boardSize * game.boardSize))
+        return false;
+    GameRecordHeader header;
+    header.boardSize = (uint8_t)game.boardSize;
+    header.rule = (uint8_t)game.rule;
+    header.winner = (uint8_t)game.winner;
+    header.finished = game.finished ? 1 : 0;
+    header.moveCount = (uint16_t)game.moves.size();
+    header.moveTimeMs = (uint16_t)std::min(std::max(game.moveTimeMs, 0), 65535);
+    header.startTime = game.startTime;
+    header.durationMs = game.durationMs;
+
+    int bytes = RecordMoveBytes(game.boardSize);
+    buffer.resize(sizeof(header) + game.moves.size() * bytes);
+    memcpy(buffer.data(), &header, sizeof(header));
+    uint8_t *out = buffer.data() + sizeof(header);
+    for (const auto &move : game.moves)
+    {
+        if (move.first < 0 || move.first >= game.boardSize || move.second < 0 || move.second >= game.boardSize)
+            return false;
+        int index = move.second * game.boardSize + move.first;
+        *out++ = (uint8_t)index;
+        if (bytes == 2)
+            *out++ = (uint8_t)(index >> 8);
+    }
+    return fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+}
+
+bool GameRecordWriter::Flush()
+{
+    return file && fflush(file) == 0;
+}
+
+void GameRecordWriter::Close()
+{
+    if (file)
+        fclose(file);
+    file = nullptr;
+}
+
+bool GameRecordReader::Open(const std::string &path)
+{
+    Close();
+    corrupted = false;
+    file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    char magic[sizeof(RECORD_MAGIC)];
+    if (fread(magic, sizeof(magic), 1, file) != 1 || memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool GameRecordReader::Next(GameRecord &game)
+{
+    if (!file)
+        return false;
+    GameRecordHeader header;
+    size_t read = fread(&header, 1, sizeof(header), file);
+    if (read != sizeof(header))
+    {
+        // 正好在两盘之间结束是正常的文件尾
+        corrupted = read != 0;
+        return false;
+    }
+    if (!IsSupportedBoardSize(header.boardSize) || header.moveCount > header.boardSize * header.boardSize ||
+        header.winner > PIECE_WHITE)
+    {
+        corrupted = true;
+        return false;
+    }
+    int bytes = RecordMoveBytes(header.boardSize);
+    buffer.resize((size_t)header.moveCount * bytes);
+    if (!buffer.empty() && fread(buffer.data(), 1, buffer.size(), file) != buffer.size())
+    {
+        corrupted = true;
+        return false;
+    }
+
+    game.boardSize = header.boardSize;
+    game.rule = header.rule;
+    game.winner = (Piece)header.winner;
+    game.finished = header.finished != 0;
+    game.moveTimeMs = header.moveTimeMs;
+    game.startTime = header.startTime;
+    game.durationMs = header.durationMs;
+    game.moves.clear();
+    for (int i = 0; i < header.moveCount; i++)
+    {
+        int index = (bytes == 2) ? buffer[2 * i] | (buffer[2 * i + 1] << 8) : buffer[i];
+        if (index >= header.boardSize * header.boardSize)
+        {
+            corrupted = true;
+            return false;
+        }
+        game.moves.emplace_back(index % header.boardSize, index / header.boardSize);
+    }
+    return true;
+}
+
+void GameRecordReader::Close()
+{
+    if (file)
+        fclose(file);
+    file = nullptr;
+}
@@ -0,0 +1,97 @@
+// 对局记录:把一盘棋的走法和结果存成紧凑的二进制格式,可以一直追加,读取时逐盘读出
+// 文件格式(小端):
+//   文件头,8字节 RECORD_MAGIC
+//   之后一盘接一盘,每盘是 GameRecordHeader(16字节)加上moveCount个走法,
+//   走法是格子序号 y * boardSize + x,格子数不超过256的棋盘(15路)每步1字节,更大的棋盘(19路)每步2字节
+// 读取时只缓存当前一盘,多大的文件都可以流式处理
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "board.h"
+
+const char RECORD_MAGIC[8] = {'G', 'M', 'K', 'R', 'E', 'C', '0', '1'};
+
+// 胜负规则
+enum GameRule
+{
+    RULE_FREESTYLE = 0 // 无禁手,五连或长连都算胜
+};
+
+struct GameRecordHeader
+{
+    uint8_t boardSize;   // 棋盘大小
+    uint8_t rule;        // GameRule
+    uint8_t winner;      // 胜方(Piece),PIECE_EMPTY表示和棋或没有下完
+    uint8_t finished;    // 1表示已经分出胜负或者下满棋盘,0表示中途结束
+    uint16_t moveCount;  // 走法个数,从黑方开始黑白交替
+    uint16_t moveTimeMs; // AI每步的时间预算(毫秒),没有AI参与或者不限时为0
+    uint32_t startTime;  // 开始时间,Unix时间(秒)
+    uint32_t durationMs; // 从第一步到最后一步的用时(毫秒)
+};
+
+static_assert(sizeof(GameRecordHeader) == 16, "对局记录的文件格式依赖这个结构的大小");
+
+// 一盘棋,内存中的形式
+struct GameRecord
+{
+    int boardSize = BOARD_SIZE;
+    int rule = RULE_FREESTYLE;
+    Piece winner = PIECE_EMPTY;
+    bool finished = false;
+    std::vector<std::pair<int, int>> moves;
+    int moveTimeMs = 0;
+    uint32_t startTime = 0;
+    uint32_t durationMs = 0;
+};
+
+// 每步占用的字节数
+inline int RecordMoveBytes(int boardSize)
+{
+    return boardSize * boardSize <= 256 ? 1 : 2;
+}
+
+// 顺序写入对局记录
+class GameRecordWriter
+{
+public:
+    ~GameRecordWriter() { Close(); }
+
+    // append为true时追加到已有文件的末尾,文件不存在或为空时新建;已有文件不是对局记录时返回false
+    bool Open(const std::string &path, bool append = false);
+    bool IsOpen() const { return file != nullptr; }
+
+    // 写入一盘,棋盘大小不支持或者走法越界时返回false,不写入任何内容
+    bool Write(const GameRecord &game);
+
+    // 把缓冲区写入文件
+    bool Flush();
+    void Close();
+
+private:
+    FILE *file = nullptr;
+    std::vector<uint8_t> buffer; // 一盘棋的编码,复用以免每盘分配
+};
+
+// 顺序读取对局记录
+class GameRecordReader
+{
+public:
+    ~GameRecordReader() { Close(); }
+
+    // 打开文件并检查文件头
+    bool Open(const std::string &path);
+    bool IsOpen() const { return file != nullptr; }
+
+    // 读下一盘,读完或者遇到损坏的记录时返回false,可以用Corrupted区分两种情况
+    bool Next(GameRecord &game);
+    bool Corrupted() const { return corrupted; }
+    void Close();
+
+private:
+    FILE *file = nullptr;
+    bool corrupted = false;
+    std::vector<uint8_t> buffer;
+};
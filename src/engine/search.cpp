@@ -0,0 +1,726 @@
+#include "search.h"
+#include "mcts.h"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+bool ParseAIConfigArg(int argc, char *argv[], int &i, AIConfig &config)
+{
+    if (i + 1 >= argc)
+        return false;
+    if (strcmp(argv[i], "--hash") == 0)
+    {
+        config.hashMegabytes = std::min(std::max(atoi(argv[++i]), TT_MIN_MB), TT_MAX_MB);
+    }
+    else if (strcmp(argv[i], "--movetime") == 0)
+    {
+        config.moveTimeMs = std::max(atoi(argv[++i]), 0);
+    }
+    else if (strcmp(argv[i], "--nodes") == 0)
+    {
+        config.moveNodes = std::max(atoll(argv[++i]), 0LL);
+    }
+    else if (strcmp(argv[i], "--threads") == 0)
+    {
+        config.threads = std::max(atoi(argv[++i]), 1);
+    }
+    else if (strcmp(argv[i], "--threat-nodes") == 0)
+    {
+        config.threatNodes = std::max(atoll(argv[++i]), 0LL);
+    }
+    else if (strcmp(argv[i], "--threat-ms") == 0)
+    {
+        config.threatTimeMs = std::max(atoi(argv[++i]), 0);
+    }
+    else if (strcmp(argv[i], "--leaf-vcf") == 0)
+    {
+        config.leafVcfNodes = std::max(atoll(argv[++i]), 0LL);
+    }
+    else if (strcmp(argv[i], "--book") == 0)
+    {
+        config.bookPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--nnue") == 0)
+    {
+        config.nnuePath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--weights") == 0)
+    {
+        config.weightsPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--engine") == 0)
+    {
+        config.engine = (strcmp(argv[++i], "mcts") == 0) ? AI_ENGINE_MCTS : AI_ENGINE_PVS;
+    }
+    else if (strcmp(argv[i], "--mcts-mb") == 0)
+    {
+        config.mctsMegabytes = std::min(std::max(atoi(argv[++i]), MCTS_MIN_MB), MCTS_MAX_MB);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+template <int N>
+int PositionT<N>::EvaluateBoardFull() const
+{
+    int score = 0;
+    for (int y = 0; y < N; y++)
+    {
+        for (int x = 0; x < N; x++)
+        {
+            Piece piece = board.At(x, y);
+            if (piece != PIECE_EMPTY)
+            {
+                const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+
+                for (const auto &dir : dirs)
+                {
+                    int dx = dir[0], dy = dir[1];
+                    // 逐格读出以(x,y)为中心的窗口,中心格不编码,与位掩码的做法互为参照
+                    int own = 0, blocked = 0;
+                    for (int k = 0; k < 8; k++)
+                    {
+                        int i = (k < 4) ? k - PATTERN_RADIUS : k - PATTERN_RADIUS + 1;
+                        int nx = x + dx * i, ny = y + dy * i;
+                        if (nx < 0 || nx >= N || ny < 0 || ny >= N)
+                            blocked |= 1 << k;
+                        else if (board.At(nx, ny) == piece)
+                            own |= 1 << k;
+                        else if (board.At(nx, ny) != PIECE_EMPTY)
+                            blocked |= 1 << k;
+                    }
+                    const PatternEntry &entry = evaluator.table[PATTERNS.ternary[own] + 2 * PATTERNS.ternary[blocked]];
+
+                    if (entry.pattern == PATTERN_FIVE)
+                        return (piece == PIECE_BLACK) ? INT_MAX : INT_MIN;
+
+                    if (piece == PIECE_BLACK)
+                        score += entry.score;
+                    else
+                        score -= entry.score;
+                }
+            }
+        }
+    }
+    return score;
+}
+
+template <int N>
+std::vector<std::pair<int, int>> PositionT<N>::GetPossibleMoves() const
+{
+    std::vector<std::pair<int, int>> moves;
+    for (int y = 0; y < N; y++)
+    {
+        uint32_t mask = board.NeighborMask(y);
+        while (mask)
+        {
+            int x = __builtin_ctz(mask);
+            mask &= mask - 1;
+            moves.emplace_back(x, y);
+        }
+    }
+    if (moves.empty())
+        moves.emplace_back(N / 2, N / 2);
+    return moves;
+}
+
+template <int N>
+void SearcherT<N>::Search(const Position &root, Piece side, std::vector<std::pair<int, int>> moves)
+{
+    pos = root;
+    pos.SetNetwork(shared.network);
+    pos.SetPatternTable(shared.patternTable);
+    nodes = 0;
+    leafVcfNodes = 0;
+    counters = SearchCounters();
+    aborted = false;
+    ttStats = TTStats();
+    completedDepth = 0;
+    iterations.clear();
+    rootStoneCount = pos.board.stoneCount;
+    // 杀手走法只在本次搜索内有效,历史分数减半保留
+    for (auto &slot : killers)
+        slot[0] = slot[1] = NO_MOVE;
+    for (auto &row : history)
+    {
+        for (int &value : row)
+            value /= 2;
+    }
+    if (id > 0)
+        std::rotate(moves.begin(), moves.begin() + id % moves.size(), moves.end());
+
+    bestMove = moves[0];
+    bestScore = 0;
+    std::vector<int> scores(moves.size());
+    int emptyCells = N * N - pos.board.stoneCount;
+    int maxDepth = std::min(shared.depthLimit, emptyCells);
+    // 每一层的分数,side一方的视角,没有完成的层记为SCORE_INFINITE
+    // 五子棋的评估分数随深度的奇偶明显摆动,期望窗口以隔一层的分数为中心
+    int depthScores[AI_MAX_DEPTH + 1];
+    std::fill(depthScores, depthScores + AI_MAX_DEPTH + 1, SCORE_INFINITE);
+
+    for (int depth = 1 + (id & 1); depth <= maxDepth; depth++)
+    {
+        if (id == 0)
+            shared.searchingDepth.store(depth, std::memory_order_relaxed);
+        // 前两层太浅,分数不稳定,用完整窗口
+        int window = AI_ASPIRATION_WINDOW;
+        int alpha = -SCORE_INFINITE, beta = SCORE_INFINITE;
+        if (depth >= 3 && !IsWinScore(depthScores[depth - 2]))
+        {
+            alpha = depthScores[depth - 2] - window;
+            beta = depthScores[depth - 2] + window;
+        }
+        int iterBest;
+        size_t iterBestIndex = 0;
+        while (true)
+        {
+            iterBest = SearchRoot(moves, scores, side, depth, alpha, beta, iterBestIndex);
+            if (aborted)
+                break;
+            // 落在窗口外时只知道真实分数的一侧边界,放宽这一侧重搜
+            window *= 4;
+            if (iterBest <= alpha && alpha > -SCORE_INFINITE)
+                alpha = (window > SCORE_WIN) ? -SCORE_INFINITE : std::max(iterBest - window, -SCORE_INFINITE);
+            else if (iterBest >= beta && beta < SCORE_INFINITE)
+                beta = (window > SCORE_WIN) ? SCORE_INFINITE : std::min(iterBest + window, SCORE_INFINITE);
+            else
+                break;
+        }
+        if (aborted)
+            break;
+
+        depthScores[depth] = iterBest;
+        completedDepth = depth;
+        bestMove = moves[iterBestIndex];
+        bestScore = (side == PIECE_BLACK) ? iterBest : -iterBest;
+        if (id == 0)
+        {
+            shared.bestMoveSoFar.store(bestMove.second * N + bestMove.first, std::memory_order_relaxed);
+            iterations.push_back({depth, bestScore, bestMove, nodes, shared.ElapsedMs()});
+
+            // 必胜或必败都已确定,再加深也不会改变结果
+            if (IsWinScore(iterBest))
+                break;
+            // 下一层通常比这一层耗时多得多,已用掉一半时间时不再开始新的一层
+            if (shared.moveTimeMs > 0 && !shared.Pondering() && shared.ElapsedMs() * 2 > shared.moveTimeMs)
+                break;
+        }
+
+        // 最佳走法放在最前,其余按本层分数排序
+        std::vector<size_t> order(moves.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                         {
+                             if (a == iterBestIndex || b == iterBestIndex)
+                                 return a == iterBestIndex && b != iterBestIndex;
+                             return scores[a] > scores[b];
+                         });
+        std::vector<std::pair<int, int>> sortedMoves(moves.size());
+        std::vector<int> sortedScores(moves.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            sortedMoves[i] = moves[order[i]];
+            sortedScores[i] = scores[order[i]];
+        }
+        moves.swap(sortedMoves);
+        scores.swap(sortedScores);
+    }
+
+    // 主线程结束后通知辅助线程停止
+    if (id == 0)
+        shared.stop.store(true, std::memory_order_relaxed);
+}
+
+template <int N>
+bool SearcherT<N>::CheckSearchLimits()
+{
+    nodes++;
+    if (id == 0)
+    {
+        if (shared.cancel && shared.cancel->load(std::memory_order_relaxed))
+            shared.stop.store(true, std::memory_order_relaxed);
+        else if (!shared.Pondering())
+        {
+            if (shared.nodeBudget > 0 && nodes >= shared.nodeBudget)
+                shared.stop.store(true, std::memory_order_relaxed);
+            // 每256个节点读一次时钟
+            else if (shared.moveTimeMs > 0 && (nodes & 255) == 0 &&
+                     std::chrono::steady_clock::now() >= shared.deadline)
+                shared.stop.store(true, std::memory_order_relaxed);
+        }
+    }
+    if (shared.stop.load(std::memory_order_relaxed))
+        aborted = true;
+    return !aborted;
+}
+
+template <int N>
+void SearcherT<N>::GenerateMoves(MoveList &list, Piece side, uint16_t ttMove, int ply)
+{
+    int c = side - 1;
+    for (int y = 0; y < N; y++)
+    {
+        uint32_t mask = pos.board.NeighborMask(y);
+        while (mask)
+        {
+            int x = __builtin_ctz(mask);
+            mask &= mask - 1;
+            uint16_t move = (uint16_t)(y * N + x);
+            if (move == ttMove)
+                continue;
+            // 进攻分数加上一半的防守分数
+            int score = pos.board.ThreatScore(x, y, c) + pos.board.ThreatScore(x, y, 1 - c) / 2;
+            if (move == killers[ply][0])
+                score += 8000;
+            else if (move == killers[ply][1])
+                score += 7000;
+            score += std::min(history[c][move], 6000);
+            list.Add(move, score);
+        }
+    }
+    if (list.size == 0 && pos.board.stoneCount == 0)
+        list.Add((uint16_t)(N / 2 * N + N / 2), 0);
+}
+
+template <int N>
+void SearcherT<N>::RecordCutoffMove(uint16_t move, Piece side, int depth, int ply)
+{
+    if (killers[ply][0] != move)
+    {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+    history[side - 1][move] += depth * depth;
+}
+
+// 置换表中的胜负分数按到当前节点的距离保存,同一局面在不同层读出时再换算成到根节点的距离
+static int ScoreToTT(int score, int ply)
+{
+    if (score >= SCORE_WIN_MIN)
+        return score + ply;
+    if (score <= -SCORE_WIN_MIN)
+        return score - ply;
+    return score;
+}
+
+static int ScoreFromTT(int score, int ply)
+{
+    if (score >= SCORE_WIN_MIN)
+        return score - ply;
+    if (score <= -SCORE_WIN_MIN)
+        return score + ply;
+    return score;
+}
+
+template <int N>
+int SearcherT<N>::SearchRoot(const std::vector<std::pair<int, int>> &moves, std::vector<int> &scores, Piece side,
+                             int depth, int alpha, int beta, size_t &bestIndex)
+{
+    Piece opponent = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    int best = -SCORE_INFINITE;
+    bestIndex = 0;
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        int x = moves[i].first, y = moves[i].second;
+        pos.MakeMove(x, y, side);
+        int score;
+        if (pos.CheckWin(x, y))
+            score = SCORE_WIN - 1;
+        else if (i == 0)
+            score = -Negamax(depth - 1, -beta, -alpha, opponent);
+        else
+        {
+            score = -Negamax(depth - 1, -alpha - 1, -alpha, opponent);
+            if (score > alpha && score < beta && !aborted)
+            {
+                counters.reSearches.Add();
+                score = -Negamax(depth - 1, -beta, -alpha, opponent);
+            }
+        }
+        pos.UnmakeMove(x, y);
+        if (aborted)
+            break;
+
+        scores[i] = score;
+        if (score > best)
+        {
+            best = score;
+            bestIndex = i;
+        }
+        alpha = std::max(alpha, score);
+        if (alpha >= beta)
+            break;
+    }
+    return best;
+}
+
+template <int N>
+int SearcherT<N>::Negamax(int depth, int alpha, int beta, Piece side)
+{
+    if (aborted || !CheckSearchLimits())
+        return 0;
+    int ply = pos.board.stoneCount - rootStoneCount;
+    if (depth == 0)
+    {
+        counters.leafEvals.Add();
+        return pos.Evaluate(side);
+    }
+
+    // 轮到哪一方走也是局面的一部分
+    uint64_t key = pos.board.hash ^ (side == PIECE_BLACK ? 0 : ZOBRIST_KEYS<N>.whiteToMove);
+    uint16_t ttMove = NO_MOVE;
+    TTEntry entry;
+    if (transTable.Probe(key, entry, ttStats))
+    {
+        ttMove = entry.move;
+        if (entry.depth >= depth)
+        {
+            int ttScore = ScoreFromTT(entry.score, ply);
+            if (entry.Bound() == BOUND_EXACT ||
+                (entry.Bound() == BOUND_LOWER && ttScore >= beta) ||
+                (entry.Bound() == BOUND_UPPER && ttScore <= alpha))
+            {
+                ttStats.cutoffs++;
+                return ttScore;
+            }
+        }
+    }
+
+    // 最后一层:轮到的一方有VCF就不再展开;放在叶节点上每个局面都要做一次,实测得不偿失
+    // 放在置换表之后,能直接剪枝的局面不用再做
+    if (depth == 1 && shared.leafVcfNodes > 0)
+    {
+        ThreatLimits limits;
+        limits.nodes = shared.leafVcfNodes;
+        ThreatResult vcf;
+        bool win = threats.Solve(pos.board, side, THREAT_VCF, limits, vcf);
+        leafVcfNodes += vcf.nodes;
+        // 进攻方走depth步威胁之后再走一步成五
+        if (win)
+        {
+            int score = SCORE_WIN - (ply + 2 * vcf.depth + 1);
+            transTable.Store(key, depth, BOUND_EXACT, ScoreToTT(score, ply), (uint16_t)(vcf.move.second * N + vcf.move.first), ttStats);
+            return score;
+        }
+    }
+
+    // 置换表走法先单独搜索,零窗口节点常常在它上面就剪枝,不用再生成其余走法
+    MoveList moves;
+    if (ttMove < N * N && pos.board.IsEmpty(ttMove % N, ttMove / N))
+        moves.Add(ttMove, 1 << 30);
+    else
+        ttMove = NO_MOVE;
+    bool generated = false;
+    if (moves.size == 0)
+    {
+        GenerateMoves(moves, side, ttMove, ply);
+        generated = true;
+        if (moves.size == 0)
+            return pos.Evaluate(side);
+    }
+
+    int c = side - 1;
+    Piece opponent = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    bool pvNode = beta - alpha > 1;
+    int alphaOrig = alpha;
+    uint16_t bestMove = NO_MOVE;
+    int bestEval = -SCORE_INFINITE;
+    for (int i = 0;; i++)
+    {
+        if (i == moves.size)
+        {
+            if (generated)
+                break;
+            GenerateMoves(moves, side, ttMove, ply);
+            generated = true;
+            if (i == moves.size)
+                break;
+        }
+        uint16_t move = moves.PickNext(i);
+        int x = move % N, y = move / N;
+        // 只缩减安静走法:不是置换表和杀手走法,双方在这里落子都成不了活三及以上的棋型
+        bool reduce = depth >= AI_LMR_MIN_DEPTH && i >= AI_LMR_MIN_MOVES && move != ttMove &&
+                      move != killers[ply][0] && move != killers[ply][1] &&
+                      pos.board.ThreatScore(x, y, c) < 10000 && pos.board.ThreatScore(x, y, 1 - c) < 10000;
+        pos.MakeMove(x, y, side);
+        if (pos.CheckWin(x, y))
+        {
+            pos.UnmakeMove(x, y);
+            bestEval = SCORE_WIN - (ply + 1);
+            bestMove = move;
+            break;
+        }
+        int eval;
+        if (i == 0)
+        {
+            eval = -Negamax(depth - 1, -beta, -alpha, opponent);
+        }
+        else
+        {
+            int reduction = reduce ? AI_LMR_REDUCTION : 0;
+            eval = -Negamax(depth - 1 - reduction, -alpha - 1, -alpha, opponent);
+            // 缩减深度的试探超过alpha时先按完整深度用零窗口复查,仍然超过且在PV节点上再用完整窗口
+            if (reduction > 0 && eval > alpha && !aborted)
+            {
+                counters.reSearches.Add();
+                eval = -Negamax(depth - 1, -alpha - 1, -alpha, opponent);
+            }
+            if (pvNode && eval > alpha && eval < beta && !aborted)
+            {
+                counters.reSearches.Add();
+                eval = -Negamax(depth - 1, -beta, -alpha, opponent);
+            }
+        }
+        pos.UnmakeMove(x, y);
+        if (aborted)
+            return 0;
+        if (eval > bestEval)
+        {
+            bestEval = eval;
+            bestMove = move;
+        }
+        alpha = std::max(alpha, eval);
+        if (alpha >= beta)
+        {
+            RecordCutoffMove(move, side, depth, ply);
+            counters.RecordCutoff(i);
+            break;
+        }
+    }
+
+    BoundType bound = BOUND_EXACT;
+    if (bestEval <= alphaOrig)
+        bound = BOUND_UPPER;
+    else if (bestEval >= beta)
+        bound = BOUND_LOWER;
+    transTable.Store(key, depth, bound, ScoreToTT(bestEval, ply), bestMove, ttStats);
+    return bestEval;
+}
+
+bool CheckAIConfigFiles(const AIConfig &config, int boardSize, std::string &error)
+{
+    if (!config.nnuePath.empty())
+    {
+        NnueNetwork network;
+        if (!network.Load(config.nnuePath))
+        {
+            error = "cannot load network " + config.nnuePath;
+            return false;
+        }
+        if (boardSize != 0 && network.BoardSize() != boardSize)
+        {
+            error = "network " + config.nnuePath + " is for board size " + std::to_string(network.BoardSize());
+            return false;
+        }
+    }
+    if (!config.weightsPath.empty() && !PatternWeights().Load(config.weightsPath))
+    {
+        error = "cannot load weights " + config.weightsPath;
+        return false;
+    }
+    return true;
+}
+
+template <int N>
+SearchEngineT<N>::SearchEngineT() = default;
+
+template <int N>
+SearchEngineT<N>::~SearchEngineT() = default;
+
+template <int N>
+bool SearchEngineT<N>::Configure(const AIConfig &config)
+{
+    aiConfig = config;
+    configError.clear();
+    transTable.Resize(aiConfig.hashMegabytes);
+    searchers.clear();
+    int threadCount = std::max(aiConfig.threads, 1);
+    for (int i = 0; i < threadCount; i++)
+        searchers.emplace_back(new SearcherT<N>(transTable, shared, i));
+    book.Close();
+    if (!aiConfig.bookPath.empty())
+        book.Open(aiConfig.bookPath);
+    network = NnueNetwork();
+    if (!aiConfig.nnuePath.empty())
+    {
+        if (!network.Load(aiConfig.nnuePath))
+            configError = "cannot load network " + aiConfig.nnuePath;
+        else if (!UsesNetwork())
+            configError = "network " + aiConfig.nnuePath + " is for board size " + std::to_string(network.BoardSize());
+    }
+    weights = PatternWeights();
+    if (!aiConfig.weightsPath.empty() && !weights.Load(aiConfig.weightsPath) && configError.empty())
+        configError = "cannot load weights " + aiConfig.weightsPath;
+    mcts.reset();
+    return configError.empty();
+}
+
+template <int N>
+void SearchEngineT<N>::NewGame()
+{
+    transTable.Clear();
+    for (auto &searcher : searchers)
+        searcher->ClearHistory();
+    if (mcts)
+        mcts->Clear();
+}
+
+template <int N>
+bool SearchEngineT<N>::PredictMove(const Position &pos, Piece side, std::pair<int, int> &move)
+{
+    if (aiConfig.engine == AI_ENGINE_MCTS)
+        return mcts && mcts->PredictMove(pos, side, move);
+    uint64_t key = pos.board.hash ^ (side == PIECE_BLACK ? 0 : ZOBRIST_KEYS<N>.whiteToMove);
+    TTEntry entry;
+    TTStats stats;
+    if (!transTable.Probe(key, entry, stats) || entry.move == NO_MOVE)
+        return false;
+    move = {entry.move % N, entry.move / N};
+    return pos.board.IsEmpty(move.first, move.second);
+}
+
+template <int N>
+void SearchEngineT<N>::GetProgress(int &depth, std::pair<int, int> &bestMove) const
+{
+    depth = shared.searchingDepth.load(std::memory_order_relaxed);
+    int move = shared.bestMoveSoFar.load(std::memory_order_relaxed);
+    bestMove = (move < 0) ? std::make_pair(-1, -1) : std::make_pair(move % N, move / N);
+}
+
+template <int N>
+SearchResult SearchEngineT<N>::Think(const Position &pos, Piece side, int depthLimit,
+                   const std::atomic<bool> *cancel, const std::atomic<bool> *ponder)
+{
+    SearchResult result;
+    std::vector<std::pair<int, int>> moves = pos.GetPossibleMoves();
+    result.bestMove = moves[0];
+    result.threads = (int)searchers.size();
+    if (moves.size() == 1)
+        return result;
+
+    if (book.BestMove<N>(pos.board, side, result.bestMove))
+    {
+        result.bookMove = true;
+        return result;
+    }
+
+    shared.start = std::chrono::steady_clock::now();
+    shared.deadline = shared.start + std::chrono::milliseconds(aiConfig.moveTimeMs);
+    shared.searchingDepth.store(0);
+    shared.bestMoveSoFar.store(-1);
+    if (aiConfig.threatNodes > 0)
+    {
+        // 威胁空间搜索的用时计入这一步的时间预算,最多用掉十分之一
+        ThreatLimits limits;
+        limits.nodes = aiConfig.threatNodes;
+        limits.timeMs = aiConfig.threatTimeMs;
+        if (aiConfig.moveTimeMs > 0)
+        {
+            int cap = std::max(aiConfig.moveTimeMs / 10, 1);
+            limits.timeMs = (limits.timeMs > 0) ? std::min(limits.timeMs, cap) : cap;
+        }
+        limits.cancel = cancel;
+        BitBoardT<N> board = pos.board;
+        ThreatResult vcf, vct;
+        bool win = rootThreats.Solve(board, side, THREAT_VCF, limits, vcf);
+        if (!win)
+        {
+            limits.nodes = std::max(aiConfig.threatNodes - vcf.nodes, 1LL);
+            if (limits.timeMs > 0)
+                limits.timeMs = std::max(limits.timeMs - (int)vcf.timeMs, 1);
+            win = rootThreats.Solve(board, side, THREAT_VCT, limits, vct);
+        }
+        result.threat = win && !vcf.found ? vct : vcf;
+        result.threat.nodes = vcf.nodes + vct.nodes;
+        result.threat.timeMs = shared.ElapsedMs();
+        if (win)
+        {
+            result.bestMove = result.threat.move;
+            // 进攻方走depth步威胁之后再走一步成五
+            int score = SCORE_WIN - (2 * result.threat.depth + 1);
+            result.score = (side == PIECE_BLACK) ? score : -score;
+            result.timeMs = result.threat.timeMs;
+            return result;
+        }
+    }
+
+    transTable.NewSearch();
+    shared.stop.store(false);
+    shared.moveTimeMs = aiConfig.moveTimeMs;
+    shared.nodeBudget = aiConfig.moveNodes;
+    shared.depthLimit = depthLimit;
+    shared.leafVcfNodes = aiConfig.leafVcfNodes;
+    shared.cancel = cancel;
+    shared.ponder = ponder;
+    shared.network = UsesNetwork() ? &network : nullptr;
+    shared.patternTable = weights.Table();
+
+    if (aiConfig.engine == AI_ENGINE_MCTS)
+    {
+        if (!mcts)
+            mcts.reset(new MctsSearchT<N>(aiConfig.mctsMegabytes));
+        mcts->Search(pos, side, shared, (int)searchers.size(), aiConfig.leafVcfNodes, result);
+        result.timeMs = shared.ElapsedMs();
+        return result;
+    }
+
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < searchers.size(); i++)
+    {
+        SearcherT<N> *helper = searchers[i].get();
+        helpers.emplace_back([helper, &pos, side, &moves]()
+                             { helper->Search(pos, side, moves); });
+    }
+    searchers[0]->Search(pos, side, moves);
+    for (auto &helper : helpers)
+        helper.join();
+
+    const SearcherT<N> &main = *searchers[0];
+    result.bestMove = main.bestMove;
+    result.score = main.bestScore;
+    result.depth = main.completedDepth;
+    result.iterations = main.iterations;
+    for (const auto &searcher : searchers)
+    {
+        result.nodes += searcher->nodes;
+        result.leafVcfNodes += searcher->leafVcfNodes;
+        result.counters.Add(searcher->counters);
+        result.ttStats.Add(searcher->ttStats);
+    }
+    result.timeMs = shared.ElapsedMs();
+    return result;
+}
+
+template struct PositionT<15>;
+template struct PositionT<19>;
+template class SearcherT<15>;
+template class SearcherT<19>;
+template class SearchEngineT<15>;
+template class SearchEngineT<19>;
+
+std::string SearchResultJson(const SearchResult &result)
+{
+    const TTStats &tt = result.ttStats;
+    char buffer[1024];
+    int length = snprintf(buffer, sizeof(buffer),
+                          "{\"move\": [%d, %d], \"score\": %d, \"depth\": %d, \"nodes\": %lld, \"time_ms\": %.3f, "
+                          "\"threads\": %d, \"book\": %s, \"threat\": %s, \"threat_nodes\": %lld, \"leaf_vcf_nodes\": %lld, "
+                          "\"tt_probes\": %lld, \"tt_hits\": %lld, \"tt_cutoffs\": %lld, \"leaf_evals\": %lld, \"re_searches\": %lld, "
+                          "\"beta_cutoffs\": [",
+                          result.bestMove.first, result.bestMove.second, result.score, result.depth, result.nodes,
+                          result.timeMs, result.threads, result.bookMove ? "true" : "false",
+                          result.threat.found ? "true" : "false", result.threat.nodes, result.leafVcfNodes,
+                          (long long)tt.probes, (long long)tt.hits, (long long)tt.cutoffs,
+                          result.counters.leafEvals.Value(), result.counters.reSearches.Value());
+    std::string json(buffer, length);
+    for (int i = 0; i < CUTOFF_SLOTS; i++)
+        json += (i ? ", " : "") + std::to_string(result.counters.betaCutoffs[i].Value());
+    json += "]}";
+    return json;
+}
@@ -0,0 +1,415 @@
+// AI搜索引擎:局面,走法生成,主变例(PVS)搜索和多线程调度
+// 不依赖图形库,图形界面和无界面的程序共用
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "board.h"
+#include "book.h"
+#include "evaluator.h"
+#include "instrument.h"
+#include "nnue.h"
+#include "threat.h"
+#include "transposition.h"
+#include "weights.h"
+
+// 困难模式AI每步的默认思考时间(毫秒)和迭代加深的最大深度
+const int AI_DEFAULT_MOVE_TIME_MS = 500;
+const int AI_MAX_DEPTH = 64;
+
+// 胜负分数:轮到的一方在距根节点ply步时成五,记为 SCORE_WIN - ply,被对方成五则是它的相反数
+// 快的胜比慢的胜分数高,慢的负比快的负分数高;绝对值不小于SCORE_WIN_MIN的分数都表示胜负已定
+const int SCORE_WIN = 10000000;
+const int SCORE_WIN_MIN = SCORE_WIN - 1000;
+const int SCORE_INFINITE = SCORE_WIN + 1;
+
+inline bool IsWinScore(int score)
+{
+    return score >= SCORE_WIN_MIN || score <= -SCORE_WIN_MIN;
+}
+
+// 根节点的期望窗口:前两层的分数加减这个值,落在窗口外时放宽到原来的4倍重新搜索
+const int AI_ASPIRATION_WINDOW = 200;
+// 后期走法缩减:剩余深度至少为AI_LMR_MIN_DEPTH,且排在前AI_LMR_MIN_MOVES个走法之后的安静走法少搜几层
+// 评估分数随深度奇偶摆动,只少搜一层会让缩减的子树停在另一方落子之后,分数系统性偏移,所以一次少搜两层
+const int AI_LMR_MIN_DEPTH = 4;
+const int AI_LMR_MIN_MOVES = 3;
+const int AI_LMR_REDUCTION = 2;
+
+// 威胁空间搜索的默认预算:搜索前在根节点最多用的节点数和时间(毫秒),搜索树最后一层每次VCF的节点数
+const long long AI_DEFAULT_THREAT_NODES = 20000;
+const int AI_DEFAULT_THREAT_TIME_MS = 50;
+const long long AI_DEFAULT_LEAF_VCF_NODES = 16;
+
+// 蒙特卡洛树搜索的节点池大小(MB)
+const int MCTS_DEFAULT_MB = 64;
+const int MCTS_MIN_MB = 4;
+const int MCTS_MAX_MB = 4096;
+
+// 图形界面和无界面AI程序默认使用的开局库,文件不存在时不用开局库
+const char *const AI_DEFAULT_BOOK_PATH = "book/opening.book";
+
+// 定长走法列表,分配在栈上,搜索过程中不产生堆分配
+template <int N>
+struct MoveListT
+{
+    static const int CAPACITY = N * N;
+
+    uint16_t moves[CAPACITY]; // y * N + x
+    int scores[CAPACITY];     // 排序分数
+    int size = 0;
+
+    void Add(uint16_t move, int score)
+    {
+        moves[size] = move;
+        scores[size] = score;
+        size++;
+    }
+
+    // 把第i位及之后分数最高的走法换到第i位再返回
+    // 逐个挑选而不是整体排序,发生剪枝时剩下的走法就不用排了
+    uint16_t PickNext(int i)
+    {
+        int best = i;
+        for (int j = i + 1; j < size; j++)
+        {
+            if (scores[j] > scores[best])
+                best = j;
+        }
+        std::swap(moves[i], moves[best]);
+        std::swap(scores[i], scores[best]);
+        return moves[i];
+    }
+};
+
+// 搜索算法:默认的主变例搜索,或者蒙特卡洛树搜索(见mcts.h)
+enum AIEngineKind
+{
+    AI_ENGINE_PVS,
+    AI_ENGINE_MCTS
+};
+
+// AI配置,由命令行参数给出
+struct AIConfig
+{
+    int hashMegabytes = TT_DEFAULT_MB;             // 置换表大小(MB)
+    int moveTimeMs = AI_DEFAULT_MOVE_TIME_MS;      // 每步的时间预算,0表示不限时
+    long long moveNodes = 0;                       // 每步的节点预算,0表示不限
+    int threads = 1;                               // 搜索线程数
+    long long threatNodes = AI_DEFAULT_THREAT_NODES; // 根节点威胁空间搜索的节点预算,0表示不做
+    int threatTimeMs = AI_DEFAULT_THREAT_TIME_MS;  // 根节点威胁空间搜索的时间上限,0表示不限
+    long long leafVcfNodes = AI_DEFAULT_LEAF_VCF_NODES; // 最后一层VCF的节点预算,0表示不做
+    std::string bookPath;                          // 开局库文件,空表示不用开局库
+    std::string nnuePath;                          // 神经网络评估的权重文件,空表示用棋型评估
+    std::string weightsPath;                       // 棋型权重文件(见weights.h),空表示用默认权重
+    AIEngineKind engine = AI_ENGINE_PVS;           // 搜索算法
+    int mctsMegabytes = MCTS_DEFAULT_MB;           // 蒙特卡洛树搜索的节点池大小(MB)
+};
+
+// 解析argv[i]处的AI相关命令行参数,识别时消耗参数值并返回true
+// 支持 --hash <MB>, --movetime <ms>, --nodes <n>, --threads <n>,
+// --threat-nodes <n>, --threat-ms <ms>, --leaf-vcf <n>, --book <file>, --nnue <file>,
+// --weights <file>, --engine pvs|mcts, --mcts-mb <MB>
+bool ParseAIConfigArg(int argc, char *argv[], int &i, AIConfig &config);
+
+// 检查配置中给出的文件能否使用,不能时返回false并在error中给出原因;开局库不检查,没有开局库是正常情况
+// boardSize不为0时还要求神经网络的棋盘大小与它相同;工具程序启动时调用,配置有误就不启动
+bool CheckAIConfigFiles(const AIConfig &config, int boardSize, std::string &error);
+
+// 局面:位棋盘加上增量评估器,游戏本身和每个搜索线程各持有一份
+template <int N>
+struct PositionT
+{
+    static const int SIZE = N;
+
+    BitBoardT<N> board;
+    IncrementalEvaluatorT<N> evaluator;
+    NnueAccumulatorT<N> nnue; // 只有搜索线程通过SetNetwork打开
+
+    void Clear()
+    {
+        board.Clear();
+        evaluator.Reset(board);
+        nnue.Reset(board, nnue.network);
+    }
+
+    // 换用神经网络评估,network为空时回到棋型评估
+    void SetNetwork(const NnueNetwork *network)
+    {
+        nnue.Reset(board, network);
+    }
+
+    // 换用另一组棋型分数(PatternWeights::Table()),全部线按新的分数重算
+    void SetPatternTable(const PatternEntry *table)
+    {
+        if (evaluator.table == table)
+            return;
+        evaluator.table = table;
+        evaluator.Reset(board);
+    }
+
+    // 落子,同时更新增量评估
+    void MakeMove(int x, int y, Piece piece)
+    {
+        board.Place(x, y, piece);
+        evaluator.OnPlace(board, x, y);
+        nnue.OnPlace(x, y, piece);
+    }
+
+    // 撤销落子,必须与MakeMove按后进先出的顺序配对
+    void UnmakeMove(int x, int y)
+    {
+        nnue.OnRemove(x, y, board.At(x, y));
+        board.Remove(x, y);
+        evaluator.OnRemove(x, y);
+    }
+
+    // 轮到side一方时的评估分数,side一方的视角,搜索的叶节点用它
+    // 打开了神经网络评估时由网络给出;棋盘上已有五连时仍由棋型评估判定胜负
+    int Evaluate(Piece side) const
+    {
+        if (nnue.network && !evaluator.HasFive())
+            return nnue.Evaluate(side);
+        int score = EvaluateBoard();
+        return (side == PIECE_BLACK) ? score : -score;
+    }
+
+    // 检查是否有五子连珠,检查黑子和白子在四个方向(横,竖,左斜,右斜)
+    bool CheckWin(int x, int y) const
+    {
+        return board.HasFive(x, y);
+    }
+
+    // 评估函数,评估棋盘的得分,从而选择下一步棋的最佳位置
+    // 分数由增量评估器维护,落子后只重算经过该点的四条线,这里直接读取
+    int EvaluateBoard() const
+    {
+        if (evaluator.NeedsFullScan())
+            return EvaluateBoardFull();
+        int score = evaluator.Score();
+#ifndef NDEBUG
+        // 调试构建下与全盘扫描的结果逐一比对
+        assert(score == EvaluateBoardFull());
+#endif
+        return score;
+    }
+
+    // 全盘扫描的评估函数,作为增量评估的参照
+    int EvaluateBoardFull() const;
+
+    // 获取当前棋盘上所有可下的位置,即与已有棋子相邻的空位
+    std::vector<std::pair<int, int>> GetPossibleMoves() const;
+};
+
+// 一次搜索中所有线程共享的控制信息
+struct SearchShared
+{
+    std::atomic<bool> stop{false};                   // 主线程结束或预算用尽时置位,所有线程随即退出
+    std::chrono::steady_clock::time_point start;     // 开始时间
+    std::chrono::steady_clock::time_point deadline;  // 截止时间
+    int moveTimeMs = 0;                              // 时间预算,0表示不限时
+    long long nodeBudget = 0;                        // 主线程的节点预算,0表示不限
+    int depthLimit = AI_MAX_DEPTH;                   // 最大深度
+    long long leafVcfNodes = 0;                      // 最后一层VCF的节点预算,0表示不做
+    const std::atomic<bool> *cancel = nullptr;       // 外部的取消标记,例如玩家悔棋或返回菜单
+    const std::atomic<bool> *ponder = nullptr;       // 外部的后台思考标记,置位期间不检查时间和节点预算
+    const NnueNetwork *network = nullptr;            // 叶节点用的神经网络,为空时用棋型评估
+    const PatternEntry *patternTable = PATTERNS.entries; // 棋型评估的分数表
+    std::atomic<int> searchingDepth{0};              // 主线程正在搜索的深度,供界面显示
+    std::atomic<int> bestMoveSoFar{-1};              // 主线程最后一个完整层的最佳走法,y * 棋盘大小 + x
+
+    double ElapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool Pondering() const
+    {
+        return ponder && ponder->load(std::memory_order_relaxed);
+    }
+};
+
+// 迭代加深中完整完成的一层,nodes和timeMs是到这一层完成为止的累计值
+struct IterationInfo
+{
+    int depth;                    // 深度
+    int score;                    // 这一层的分数,黑方视角,胜负分数见SCORE_WIN
+    std::pair<int, int> bestMove; // 这一层的最佳走法
+    long long nodes;              // 主线程累计的节点数
+    double timeMs;                // 从搜索开始的用时
+};
+
+// 一次搜索的结果
+struct SearchResult
+{
+    std::pair<int, int> bestMove; // 最佳走法
+    int score = 0;                // 最后一个完整层的分数,黑方视角,胜负分数见SCORE_WIN
+    int depth = 0;                // 完整完成的深度
+    long long nodes = 0;          // 所有线程的节点数之和
+    double timeMs = 0;            // 用时
+    int threads = 1;              // 参与搜索的线程数
+    TTStats ttStats = TTStats();  // 所有线程的置换表统计之和
+    std::vector<IterationInfo> iterations; // 主线程每一层完成时的记录,用于基准测试
+    bool bookMove = false;        // 走法来自开局库,没有搜索
+    ThreatResult threat;          // 搜索前的威胁空间搜索,找到必胜时直接采用,不再搜索
+    long long leafVcfNodes = 0;   // 所有线程在最后一层做VCF的节点数之和
+    SearchCounters counters;      // 所有线程的统计计数之和,没有打开统计时全为0
+};
+
+// 把一次搜索的结果和统计写成一行JSON,用于日志
+std::string SearchResultJson(const SearchResult &result);
+
+// 搜索线程:持有自己的局面副本,杀手走法和历史表,与其他线程共享置换表
+// 编号为0的是主线程,只有它的结果会被采用,也只有它负责检查时间和节点预算
+template <int N>
+class SearcherT
+{
+public:
+    using Position = PositionT<N>;
+    using MoveList = MoveListT<N>;
+
+    SearcherT(TranspositionTable &table, SearchShared &control, int threadId)
+        : transTable(table), shared(control), id(threadId)
+    {
+        ClearHistory();
+    }
+
+    void ClearHistory()
+    {
+        std::fill(&history[0][0], &history[0][0] + 2 * N * N, 0);
+    }
+
+    // 迭代加深搜索:从深度1开始逐层加深,直到用完时间或节点预算
+    // 每一层按上一层的结果排序根节点走法,最佳走法最先搜索;从第3层起以前两层的分数为中心开期望窗口,
+    // 分数落在窗口外时放宽窗口重搜这一层;
+    // 预算用尽时丢弃未完成的那一层,返回最后一个完整层的最佳走法
+    // 辅助线程把根节点走法错开顺序,并从不同的深度开始,以便和主线程搜索不同的子树
+    void Search(const Position &root, Piece side, std::vector<std::pair<int, int>> moves);
+
+    std::pair<int, int> bestMove; // 最后一个完整层的最佳走法
+    int bestScore;                // 最后一个完整层的分数,黑方视角
+    int completedDepth;           // 最后一次完整完成的深度
+    long long nodes;              // 本线程搜索的节点数
+    TTStats ttStats;              // 本线程的置换表统计
+    std::vector<IterationInfo> iterations; // 每一层完成时的记录,只有主线程填写
+    long long leafVcfNodes;       // 本线程在最后一层做VCF的节点数
+    SearchCounters counters;      // 本线程的统计计数
+
+private:
+    TranspositionTable &transTable;
+    SearchShared &shared;
+    int id;
+    Position pos;
+    bool aborted;                                 // 本线程的搜索已中止
+    int rootStoneCount;                           // 搜索开始时的棋子数,用来计算当前层数
+    uint16_t killers[AI_MAX_DEPTH + 1][2];        // 每层最近引起剪枝的两个走法
+    int history[2][N * N];                        // 历史启发分数,按颜色和位置累计
+    ThreatSolverT<N> threats;                     // 最后一层的VCF
+
+    // 统计节点数并检查是否需要停止,需要停止时返回false
+    // 主线程检查时间和节点预算,辅助线程只看停止标记
+    bool CheckSearchLimits();
+
+    // 搜索用的走法生成:从增量维护的邻域掩码中取出候选走法写入栈上的列表,并给出排序分数
+    // 排序依次为:成五,堵对方成五,活四,堵对方活四,活三,杀手走法,历史启发
+    // 置换表走法由调用者先行搜索,这里跳过它
+    void GenerateMoves(MoveList &list, Piece side, uint16_t ttMove, int ply);
+
+    // 记录引起beta剪枝的走法,供杀手启发和历史启发使用
+    void RecordCutoffMove(uint16_t move, Piece side, int depth, int ply);
+
+    // 在窗口(alpha, beta)内搜索根节点的所有走法,返回最佳分数(side一方的视角),scores记下每个走法的分数
+    // 第一个走法用完整窗口,其余先用零窗口试探,超过alpha时再用完整窗口重搜
+    int SearchRoot(const std::vector<std::pair<int, int>> &moves, std::vector<int> &scores, Piece side,
+                   int depth, int alpha, int beta, size_t &bestIndex);
+
+    // 负极大值形式的主变例搜索(PVS),返回轮到的一方(side)视角的分数
+    // 每个节点的第一个走法用完整窗口,其余走法用零窗口证明它们不比第一个好,证明失败时才用完整窗口重搜;
+    // 排序靠后的安静走法先少搜两层,分数超过alpha时再按完整深度重搜
+    // 经过置换表:不同走子顺序到达的同一局面只搜索一次
+    // 剩余深度为1时先给轮到的一方做一次小预算的VCF,超出搜索深度的连续冲四胜由它补上
+    int Negamax(int depth, int alpha, int beta, Piece side);
+};
+
+template <int N>
+class MctsSearchT;
+
+// 搜索引擎:管理置换表和搜索线程,对外提供"给定局面,返回最佳走法"的接口
+// 线程数为1时只在调用线程上搜索,结果完全确定
+// 配置为蒙特卡洛树搜索时,开局库和威胁空间搜索照旧,之后改用蒙特卡洛树搜索
+template <int N>
+class SearchEngineT
+{
+public:
+    using Position = PositionT<N>;
+
+    SearchEngineT();
+    ~SearchEngineT();
+
+    // 按配置分配置换表并创建搜索线程,配置了开局库时打开开局库,配置了神经网络时加载网络
+    // 网络文件读取失败或者棋盘大小与N不同时不用它,仍用棋型评估;棋型权重文件读取失败时用默认权重
+    // 网络或者权重文件不能用时返回false,原因由ConfigError给出
+    bool Configure(const AIConfig &config);
+    const std::string &ConfigError() const { return configError; }
+
+    const OpeningBook &Book() const { return book; }
+
+    bool UsesNetwork() const { return network.BoardSize() == N; }
+
+    // 搜索用的棋型权重,读取了权重文件时与默认权重不同
+    const PatternWeights &Weights() const { return weights; }
+
+    // 新的一局:清空置换表和历史表
+    void NewGame();
+
+    size_t HashSizeInBytes() const { return transTable.SizeInBytes(); }
+
+    // 修改每步的时间和节点预算,不重新分配置换表
+    void SetLimits(int moveTimeMs, long long moveNodes)
+    {
+        aiConfig.moveTimeMs = moveTimeMs;
+        aiConfig.moveNodes = moveNodes;
+    }
+
+    // 切换搜索算法,蒙特卡洛树搜索的节点池在第一次用到时分配
+    void SetEngine(AIEngineKind kind) { aiConfig.engine = kind; }
+
+    // 从置换表(蒙特卡洛树搜索时从上一步留下的树)中取出side一方在这个局面下的最佳走法,用来猜测对手的下一步;
+    // 没有记录时返回false
+    // 只能在没有搜索进行时调用
+    bool PredictMove(const Position &pos, Piece side, std::pair<int, int> &move);
+
+    // 读取正在进行的搜索的进度,可以在其他线程调用;还没有完整完成任何一层时bestMove为(-1,-1)
+    void GetProgress(int &depth, std::pair<int, int> &bestMove) const;
+
+    // 搜索side一方的最佳走法,depthLimit用于固定深度的测试
+    // 局面在开局库中时直接返回库里权重最大的走法;
+    // 否则先做威胁空间搜索(先VCF再VCT),找到必胜的连续进攻就直接返回它的第一步
+    // cancel不为空时,它被置位后搜索会尽快返回,此时结果不可用
+    // ponder不为空且置位时是后台思考:不受时间和节点预算限制,一直加深到被取消或者ponder被清除;
+    // 清除之后(对手走了预测的那一步)从搜索开始计时,已经超出时间预算时立即返回最后一个完整层的结果
+    SearchResult Think(const Position &pos, Piece side, int depthLimit = AI_MAX_DEPTH,
+                       const std::atomic<bool> *cancel = nullptr, const std::atomic<bool> *ponder = nullptr);
+
+private:
+    AIConfig aiConfig;
+    std::string configError;
+    TranspositionTable transTable;
+    SearchShared shared;
+    std::vector<std::unique_ptr<SearcherT<N>>> searchers;
+    ThreatSolverT<N> rootThreats; // 根节点的威胁空间搜索
+    OpeningBook book;
+    NnueNetwork network;
+    PatternWeights weights;
+    std::unique_ptr<MctsSearchT<N>> mcts;
+};
+
+using MoveList = MoveListT<BOARD_SIZE>;
+using Position = PositionT<BOARD_SIZE>;
+using Searcher = SearcherT<BOARD_SIZE>;
+using SearchEngine = SearchEngineT<BOARD_SIZE>;
@@ -0,0 +1,75 @@
+#include "session.h"
+
+template <int N>
+class GameSessionT : public GameSession
+{
+public:
+    int Size() const override { return N; }
+
+    // 局面也改用引擎的棋型权重,简单模式逐点评估时与搜索一致
+    bool Configure(const AIConfig &config, std::string &error) override
+    {
+        bool ok = engine.Configure(config);
+        error = engine.ConfigError();
+        position.SetPatternTable(engine.Weights().Table());
+        return ok;
+    }
+
+    void NewGame() override
+    {
+        position.Clear();
+        engine.NewGame();
+    }
+
+    void SetEngine(AIEngineKind kind) override { engine.SetEngine(kind); }
+
+    Piece At(int x, int y) const override { return position.board.At(x, y); }
+    bool IsEmpty(int x, int y) const override { return position.board.IsEmpty(x, y); }
+    void MakeMove(int x, int y, Piece piece) override { position.MakeMove(x, y, piece); }
+    void UnmakeMove(int x, int y) override { position.UnmakeMove(x, y); }
+    bool CheckWin(int x, int y) const override { return position.CheckWin(x, y); }
+    std::vector<std::pair<int, int>> GetPossibleMoves() const override { return position.GetPossibleMoves(); }
+    int EvaluateBoard() const override { return position.EvaluateBoard(); }
+
+    bool PredictMove(Piece side, std::pair<int, int> &move) override
+    {
+        return engine.PredictMove(position, side, move);
+    }
+
+    void GetProgress(int &depth, std::pair<int, int> &bestMove) const override
+    {
+        engine.GetProgress(depth, bestMove);
+    }
+
+    size_t HashSizeInBytes() const override { return engine.HashSizeInBytes(); }
+
+    std::function<SearchResult()> SearchTask(Piece side, const std::atomic<bool> *cancel,
+                                             const std::atomic<bool> *ponder, std::pair<int, int> assumedMove) override
+    {
+        PositionT<N> snapshot = position;
+        if (assumedMove.first >= 0)
+            snapshot.MakeMove(assumedMove.first, assumedMove.second, (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK);
+        SearchEngineT<N> *searchEngine = &engine;
+        return [searchEngine, snapshot, side, cancel, ponder]()
+        {
+            return searchEngine->Think(snapshot, side, AI_MAX_DEPTH, cancel, ponder);
+        };
+    }
+
+private:
+    PositionT<N> position;
+    SearchEngineT<N> engine;
+};
+
+std::unique_ptr<GameSession> CreateGameSession(int size)
+{
+    switch (size)
+    {
+    case 15:
+        return std::unique_ptr<GameSession>(new GameSessionT<15>());
+    case 19:
+        return std::unique_ptr<GameSession>(new GameSessionT<19>());
+    default:
+        return nullptr;
+    }
+}
@@ -0,0 +1,49 @@
+// 对局会话:把某一种棋盘大小的局面和搜索引擎包在一个不带模板参数的接口后面,
+// 图形界面在运行时选择棋盘大小,通过这个接口使用对应大小实例化的引擎
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "search.h"
+
+class GameSession
+{
+public:
+    virtual ~GameSession() = default;
+
+    virtual int Size() const = 0;
+
+    // 按配置分配置换表并打开开局库,开局库的棋盘大小不同时不会用到它
+    // 配置的文件不能用时返回false并在error中给出原因,此时仍可以下棋(用默认的评估)
+    virtual bool Configure(const AIConfig &config, std::string &error) = 0;
+
+    // 新的一局:清空棋盘,置换表和历史表
+    virtual void NewGame() = 0;
+
+    // 困难模式使用主变例搜索,MCTS模式使用蒙特卡洛树搜索
+    virtual void SetEngine(AIEngineKind kind) = 0;
+
+    virtual Piece At(int x, int y) const = 0;
+    virtual bool IsEmpty(int x, int y) const = 0;
+    virtual void MakeMove(int x, int y, Piece piece) = 0;
+    virtual void UnmakeMove(int x, int y) = 0;
+    virtual bool CheckWin(int x, int y) const = 0;
+    virtual std::vector<std::pair<int, int>> GetPossibleMoves() const = 0;
+    virtual int EvaluateBoard() const = 0;
+
+    // 见SearchEngineT的同名函数
+    virtual bool PredictMove(Piece side, std::pair<int, int> &move) = 0;
+    virtual void GetProgress(int &depth, std::pair<int, int> &bestMove) const = 0;
+    virtual size_t HashSizeInBytes() const = 0;
+
+    // 返回一次搜索:调用时复制当前局面,assumedMove不为(-1,-1)时先在副本上替side的对手走这一步,
+    // 返回的函数在后台线程调用,搜索side一方的最佳走法;cancel和ponder的含义与SearchEngineT::Think相同
+    virtual std::function<SearchResult()> SearchTask(Piece side, const std::atomic<bool> *cancel,
+                                                     const std::atomic<bool> *ponder,
+                                                     std::pair<int, int> assumedMove = {-1, -1}) = 0;
+};
+
+// 创建指定棋盘大小的会话,不支持的大小返回空指针
+std::unique_ptr<GameSession> CreateGameSession(int size);
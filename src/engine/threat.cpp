@@ -0,0 +1,327 @@
+#include "threat.h"
+#include <algorithm>
+#include "transposition.h"
+
+namespace
+{
+    // VCT和VCF的结果分开缓存
+    const uint64_t VCT_KEY = 0x5BD1E9955BD1E995ull;
+
+    // 检查一条线上的空位,把能成五,成四,成活三的点记入map
+    // 成五,成四,成活三分别至少需要线上已有4,3,2个己方棋子
+    template <int N>
+    void ScanLine(uint32_t own, uint32_t other, uint32_t span, PatternClass lowest, int kind, int index, ThreatMapT<N> &map)
+    {
+        int minStones = (lowest == PATTERN_FIVE) ? 4 : (lowest >= PATTERN_FOUR) ? 3 : 2;
+        if (__builtin_popcount(own) < minStones)
+            return;
+        // 先按五格窗口筛选:只有窗口里没有对方棋子,且己方棋子够数时,窗口里的空位才可能成为威胁点
+        uint32_t blocked = other | ~span;
+        uint32_t empty = span & ~(own | other);
+        uint32_t cells = 0;
+        for (int start = 0; start + 5 <= N; start++)
+        {
+            if (((blocked >> start) & 0x1Fu) == 0 && __builtin_popcount((own >> start) & 0x1Fu) >= minStones)
+                cells |= 0x1Fu << start;
+        }
+        cells &= empty;
+        while (cells)
+        {
+            int pos = __builtin_ctz(cells);
+            cells &= cells - 1;
+            // 线上的位下标换成格子坐标
+            int x, y;
+            switch (kind)
+            {
+            case 0: // 行
+                x = pos, y = index;
+                break;
+            case 1: // 列
+                x = index, y = pos;
+                break;
+            case 2: // 主对角线
+                x = pos, y = pos - index + N - 1;
+                break;
+            default: // 副对角线
+                x = pos, y = index - pos;
+                break;
+            }
+            uint32_t *target;
+            switch (LookupPattern(own, blocked, pos).pattern)
+            {
+            case PATTERN_FIVE:
+                target = map.five;
+                break;
+            case PATTERN_OPEN_FOUR:
+                if (lowest > PATTERN_FOUR)
+                    continue;
+                target = map.four;
+                map.openFour[y] |= 1u << x;
+                break;
+            case PATTERN_FOUR:
+                if (lowest > PATTERN_FOUR)
+                    continue;
+                target = map.four;
+                break;
+            case PATTERN_THREE:
+            case PATTERN_SPLIT_THREE:
+                if (lowest > PATTERN_SPLIT_THREE)
+                    continue;
+                target = map.three;
+                break;
+            default:
+                continue;
+            }
+            target[y] |= 1u << x;
+        }
+    }
+
+    template <int N>
+    int CountBits(const uint32_t (&rows)[N])
+    {
+        int count = 0;
+        for (uint32_t row : rows)
+            count += __builtin_popcount(row);
+        return count;
+    }
+}
+
+template <int N>
+void FindThreats(const BitBoardT<N> &board, int c, PatternClass lowest, ThreatMapT<N> &map)
+{
+    int o = 1 - c;
+    for (int i = 0; i < N; i++)
+        map.five[i] = map.four[i] = map.openFour[i] = map.three[i] = 0;
+    for (int i = 0; i < N; i++)
+    {
+        ScanLine(board.rows[c][i], board.rows[o][i], BitBoardT<N>::FULL_LINE, lowest, 0, i, map);
+        ScanLine(board.cols[c][i], board.cols[o][i], BitBoardT<N>::FULL_LINE, lowest, 1, i, map);
+    }
+    for (int i = 0; i < BitBoardT<N>::LINE_COUNT; i++)
+    {
+        uint32_t span = BitBoardT<N>::DiagSpan(i);
+        ScanLine(board.diags[c][i], board.diags[o][i], span, lowest, 2, i, map);
+        ScanLine(board.antiDiags[c][i], board.antiDiags[o][i], span, lowest, 3, i, map);
+    }
+}
+
+template <int N>
+ThreatSolverT<N>::ThreatSolverT() : cache(new CacheEntry[CACHE_SIZE]())
+{
+}
+
+template <int N>
+bool ThreatSolverT<N>::Solve(Board &target, Piece attacker, ThreatKind threatKind, const ThreatLimits &budget,
+                         ThreatResult &result)
+{
+    auto start = std::chrono::steady_clock::now();
+    board = &target;
+    attackerColor = attacker - 1;
+    kind = threatKind;
+    limits = budget;
+    deadline = start + std::chrono::milliseconds(limits.timeMs);
+    nodes = 0;
+    aborted = false;
+
+    result = ThreatResult();
+    int maxDepth = (limits.maxDepth > 0) ? limits.maxDepth : N * N;
+    for (int depth = 0; depth <= maxDepth; depth++)
+    {
+        depthCut = false;
+        rootMove = NO_MOVE;
+        if (Attack(depth, true))
+        {
+            result.found = true;
+            result.move = {rootMove % N, rootMove / N};
+            result.depth = depth;
+            break;
+        }
+        // 没有任何分支受步数限制时,再加深也是同样的结果
+        if (aborted || !depthCut)
+            break;
+    }
+    result.nodes = nodes;
+    result.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result.found;
+}
+
+template <int N>
+bool ThreatSolverT<N>::CheckLimits()
+{
+    nodes++;
+    if (limits.nodes > 0 && nodes >= limits.nodes)
+        aborted = true;
+    else if (limits.cancel && limits.cancel->load(std::memory_order_relaxed))
+        aborted = true;
+    else if (limits.timeMs > 0 && (nodes & 255) == 0 && std::chrono::steady_clock::now() >= deadline)
+        aborted = true;
+    return !aborted;
+}
+
+template <int N>
+uint64_t ThreatSolverT<N>::CacheKey() const
+{
+    return board->hash ^ (attackerColor ? ZOBRIST_KEYS<N>.whiteToMove : 0) ^ (kind == THREAT_VCT ? VCT_KEY : 0);
+}
+
+template <int N>
+bool ThreatSolverT<N>::Attack(int depth, bool root)
+{
+    if (aborted || !CheckLimits())
+        return false;
+
+    uint64_t key = CacheKey();
+    CacheEntry &entry = cache[key & (CACHE_SIZE - 1)];
+    if (!root && entry.key == key)
+    {
+        if (entry.win && entry.depth <= depth)
+            return true;
+        if (!entry.win && entry.depth >= depth)
+            return false;
+    }
+
+    int a = attackerColor, d = 1 - a;
+    Piece attacker = (Piece)(a + 1);
+    ThreatMapT<N> mine, theirs;
+    FindThreats(*board, a, (kind == THREAT_VCT) ? PATTERN_SPLIT_THREE : PATTERN_FOUR, mine);
+    uint32_t candidates[N];
+    bool any = false;
+    for (int y = 0; y < N; y++)
+    {
+        if (mine.five[y])
+        {
+            rootMove = (uint16_t)(y * N + __builtin_ctz(mine.five[y]));
+            return true;
+        }
+        candidates[y] = mine.four[y] | mine.three[y];
+        any |= (candidates[y] != 0);
+    }
+    if (!any)
+        return false;
+
+    // 对方冲四反击时必须先堵.VCF里堵的这一步也要成四才能继续进攻;
+    // VCT里只要堵完之后己方还有活三,对方就还得防守,堵的这一步本身不必是威胁
+    FindThreats(*board, d, PATTERN_FIVE, theirs);
+    int defenderFives = CountBits(theirs.five);
+    if (defenderFives >= 2)
+        return false;
+    bool plainBlock = false;
+    if (defenderFives == 1)
+    {
+        any = false;
+        for (int y = 0; y < N; y++)
+        {
+            any |= (candidates[y] & theirs.five[y]) != 0;
+            candidates[y] = theirs.five[y];
+        }
+        if (!any)
+        {
+            if (kind != THREAT_VCT)
+                return false;
+            plainBlock = true;
+        }
+    }
+    if (depth == 0)
+    {
+        depthCut = true;
+        return false;
+    }
+
+    // 成四的点排在成活三的点前面,同类的按棋型分数排序
+    std::pair<int, uint16_t> order[N * N];
+    int count = 0;
+    for (int y = 0; y < N; y++)
+    {
+        uint32_t mask = candidates[y];
+        while (mask)
+        {
+            int x = __builtin_ctz(mask);
+            mask &= mask - 1;
+            order[count++] = {board->ThreatScore(x, y, a), (uint16_t)(y * N + x)};
+        }
+    }
+    std::sort(order, order + count, [](const std::pair<int, uint16_t> &l, const std::pair<int, uint16_t> &r)
+              { return l.first > r.first; });
+
+    for (int i = 0; i < count; i++)
+    {
+        uint16_t move = order[i].second;
+        int x = move % N, y = move / N;
+        board->Place(x, y, attacker);
+        bool win;
+        if (plainBlock)
+        {
+            ThreatMapT<N> after;
+            FindThreats(*board, a, PATTERN_FOUR, after);
+            win = CountBits(after.openFour) > 0 && Defend(depth - 1);
+        }
+        else
+        {
+            win = Defend(depth - 1);
+        }
+        board->Remove(x, y);
+        if (aborted)
+            return false;
+        if (win)
+        {
+            if (root)
+                rootMove = move;
+            entry = {key, move, (int8_t)depth, 1};
+            return true;
+        }
+    }
+    entry = {key, NO_MOVE, (int8_t)depth, 0};
+    return false;
+}
+
+template <int N>
+bool ThreatSolverT<N>::Defend(int depth)
+{
+    if (aborted || !CheckLimits())
+        return false;
+
+    int a = attackerColor, d = 1 - a;
+    Piece defender = (Piece)(d + 1);
+    ThreatMapT<N> mine, theirs;
+    FindThreats(*board, d, PATTERN_FIVE, theirs);
+    if (CountBits(theirs.five) > 0)
+        return false;
+    FindThreats(*board, a, PATTERN_FOUR, mine);
+    int attackerFives = CountBits(mine.five);
+    if (attackerFives >= 2)
+        return true;
+
+    // 对冲四只能堵成五的点;对活三可以堵任何一个让进攻方成四的点,也可以用自己的冲四反击
+    if (attackerFives == 0)
+        FindThreats(*board, d, PATTERN_FOUR, theirs);
+    uint32_t replies[N];
+    bool any = false;
+    for (int y = 0; y < N; y++)
+    {
+        replies[y] = (attackerFives == 1) ? mine.five[y] : (mine.four[y] | theirs.four[y]);
+        any |= (replies[y] != 0);
+    }
+    if (!any)
+        return false;
+
+    for (int y = 0; y < N; y++)
+    {
+        uint32_t mask = replies[y];
+        while (mask)
+        {
+            int x = __builtin_ctz(mask);
+            mask &= mask - 1;
+            board->Place(x, y, defender);
+            bool win = Attack(depth, false);
+            board->Remove(x, y);
+            if (aborted || !win)
+                return false;
+        }
+    }
+    return true;
+}
+
+template void FindThreats<15>(const BitBoardT<15> &, int, PatternClass, ThreatMapT<15> &);
+template void FindThreats<19>(const BitBoardT<19> &, int, PatternClass, ThreatMapT<19> &);
+template class ThreatSolverT<15>;
+template class ThreatSolverT<19>;
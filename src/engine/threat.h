@@ -0,0 +1,97 @@
+// 威胁空间搜索:只走冲四(VCF)或冲四加活三(VCT)的连续进攻,寻找对方无法化解的必胜走法
+// 防守方只考虑堵住威胁的点和自己的冲四,所以搜索树很窄,深达十几步的连续进攻也能很快算清
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include "board.h"
+
+// 进攻方允许使用的威胁
+enum ThreatKind
+{
+    THREAT_VCF, // 只用冲四,对方每次都只有一个防点
+    THREAT_VCT  // 冲四和活三,活三的防点是进攻方所有能成四的点
+};
+
+// 一次威胁空间搜索的预算,为0的项表示不限
+struct ThreatLimits
+{
+    int maxDepth = 0;                          // 进攻方最多走几步
+    long long nodes = 0;                       // 节点预算
+    int timeMs = 0;                            // 时间预算(毫秒)
+    const std::atomic<bool> *cancel = nullptr; // 外部的取消标记
+};
+
+// 威胁空间搜索的结果
+struct ThreatResult
+{
+    bool found = false;                     // 找到了必胜的连续进攻
+    std::pair<int, int> move = {-1, -1};    // 第一步
+    int depth = 0;                          // 成五之前进攻方要走的威胁步数,已经可以直接成五时为0
+    long long nodes = 0;                    // 搜索的节点数
+    double timeMs = 0;                      // 用时
+};
+
+// 一方的威胁点,按行保存位掩码,第y个掩码的第x位表示空位(x,y)
+template <int N>
+struct ThreatMapT
+{
+    uint32_t five[N];     // 落子后成五
+    uint32_t four[N];     // 落子后成冲四或活四
+    uint32_t openFour[N]; // 落子后成活四,是four的子集
+    uint32_t three[N];    // 落子后成活三(含跳活三)
+};
+
+// 找出c方(0黑1白)棋型不低于lowest的威胁点,lowest为PATTERN_FIVE,PATTERN_FOUR或PATTERN_SPLIT_THREE,
+// 低于lowest的那几类掩码为0
+// 只检查有足够己方棋子的线,每条线先按五格窗口筛出可能的空位再查棋型表,所以比逐格检查四个方向快得多
+template <int N>
+void FindThreats(const BitBoardT<N> &board, int c, PatternClass lowest, ThreatMapT<N> &map);
+
+// 威胁空间搜索器,持有一个小的结果缓存,每个搜索线程各用一个
+template <int N>
+class ThreatSolverT
+{
+public:
+    using Board = BitBoardT<N>;
+
+    ThreatSolverT();
+
+    // 搜索attacker一方在board上的必胜连续进攻,按进攻步数逐步加深,找到的是最短的一种
+    // 搜索过程中在board上落子和提子,返回时board恢复原样
+    bool Solve(Board &board, Piece attacker, ThreatKind kind, const ThreatLimits &limits, ThreatResult &result);
+
+private:
+    // 缓存进攻方走棋的局面:取胜所需的最少步数不超过depth,或者depth步以内不能取胜
+    struct CacheEntry
+    {
+        uint64_t key;
+        uint16_t move;
+        int8_t depth;
+        uint8_t win;
+    };
+    static const int CACHE_SIZE = 1 << 14;
+
+    std::unique_ptr<CacheEntry[]> cache;
+    Board *board;
+    int attackerColor;
+    ThreatKind kind;
+    ThreatLimits limits;
+    std::chrono::steady_clock::time_point deadline;
+    long long nodes;
+    bool aborted;
+    bool depthCut;      // 有分支因为步数用完而停止,加深后可能找到结果
+    uint16_t rootMove;  // 根节点找到的第一步
+
+    bool CheckLimits();
+    uint64_t CacheKey() const;
+
+    // 进攻方走棋,depth步以内能取胜时返回true
+    bool Attack(int depth, bool root);
+
+    // 防守方走棋,进攻方刚走出威胁,所有防守都失败时返回true
+    bool Defend(int depth);
+};
+
+using ThreatMap = ThreatMapT<BOARD_SIZE>;
+using ThreatSolver = ThreatSolverT<BOARD_SIZE>;
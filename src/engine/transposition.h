@@ -0,0 +1,207 @@
+// 置换表
+#pragma once
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "board.h"
+
+// 置换表默认大小及允许的范围(MB)
+const int TT_DEFAULT_MB = 64;
+const int TT_MIN_MB = 16;
+const int TT_MAX_MB = 1024;
+
+// 置换表中分数的性质
+enum BoundType
+{
+    BOUND_NONE = 0,  // 空表项
+    BOUND_EXACT = 1, // 精确值
+    BOUND_LOWER = 2, // 下界(发生了beta剪枝)
+    BOUND_UPPER = 3  // 上界(所有走法都没有超过alpha)
+};
+
+const uint16_t NO_MOVE = 0xFFFF; // 表项中没有最佳走法
+
+// 解包后的表项内容
+struct TTEntry
+{
+    int32_t score;     // 搜索得到的分数
+    uint16_t move;     // 最佳走法,y * BOARD_SIZE + x
+    int8_t depth;      // 剩余搜索深度
+    uint8_t boundGen;  // 低2位为BoundType,高6位为写入时的代数
+
+    BoundType Bound() const { return (BoundType)(boundGen & 3); }
+    int Generation() const { return boundGen >> 2; }
+
+    uint64_t Pack() const
+    {
+        return (uint64_t)(uint32_t)score | ((uint64_t)move << 32) |
+               ((uint64_t)(uint8_t)depth << 48) | ((uint64_t)boundGen << 56);
+    }
+
+    static TTEntry Unpack(uint64_t data)
+    {
+        TTEntry entry;
+        entry.score = (int32_t)(uint32_t)data;
+        entry.move = (uint16_t)(data >> 32);
+        entry.depth = (int8_t)(uint8_t)(data >> 48);
+        entry.boundGen = (uint8_t)(data >> 56);
+        return entry;
+    }
+};
+
+// 表中的一个槽位,16字节,一个桶正好容纳4个
+// 多个搜索线程同时读写且不加锁:keyXorData存的是Zobrist键与data的异或,
+// 读出后再异或一次校验,两个字段来自不同的写入时校验失败,当作未命中
+struct TTSlot
+{
+    std::atomic<uint64_t> keyXorData;
+    std::atomic<uint64_t> data;
+};
+
+// 每个桶对齐到一条64字节的缓存行,一次探测只访问一条缓存行
+struct alignas(64) TTBucket
+{
+    TTSlot slots[4];
+};
+
+// 置换表命中统计,每个搜索线程各自累计,搜索结束后汇总
+struct TTStats
+{
+    uint64_t probes = 0;     // 探测次数
+    uint64_t hits = 0;       // 找到同一局面
+    uint64_t misses = 0;     // 没有找到
+    uint64_t cutoffs = 0;    // 命中后直接返回,省去了整棵子树的搜索
+    uint64_t stores = 0;     // 写入次数
+    uint64_t overwrites = 0; // 覆盖了另一个局面的有效表项
+
+    void Add(const TTStats &other)
+    {
+        probes += other.probes;
+        hits += other.hits;
+        misses += other.misses;
+        cutoffs += other.cutoffs;
+        stores += other.stores;
+        overwrites += other.overwrites;
+    }
+};
+
+// 固定大小的置换表,按桶组织,桶数为2的幂,所有搜索线程共享
+class TranspositionTable
+{
+public:
+    TranspositionTable() : bucketCount(0), bucketMask(0), generation(0) {}
+
+    // 按MB设置大小,取不超过该大小的最大2的幂个桶,并清空表
+    // 先释放旧表再分配,内存的峰值不会是新旧两张表之和
+    void Resize(int megabytes)
+    {
+        size_t bytes = (size_t)megabytes * 1024 * 1024;
+        size_t count = 1;
+        while (count * 2 * sizeof(TTBucket) <= bytes)
+            count *= 2;
+        if (count != bucketCount)
+        {
+            buckets.reset();
+            bucketCount = 0;
+            buckets.reset(new TTBucket[count]);
+        }
+        bucketCount = count;
+        bucketMask = count - 1;
+        Clear();
+    }
+
+    // 只能在没有搜索线程运行时调用
+    void Clear()
+    {
+        for (size_t i = 0; i < bucketCount; i++)
+        {
+            for (TTSlot &slot : buckets[i].slots)
+            {
+                slot.keyXorData.store(0, std::memory_order_relaxed);
+                slot.data.store(0, std::memory_order_relaxed);
+            }
+        }
+        generation = 0;
+    }
+
+    // 每次开始新的搜索时调用,旧搜索留下的表项会被优先替换
+    void NewSearch()
+    {
+        generation = (generation + 1) & 63;
+    }
+
+    size_t SizeInBytes() const { return bucketCount * sizeof(TTBucket); }
+
+    bool Probe(uint64_t key, TTEntry &out, TTStats &stats) const
+    {
+        stats.probes++;
+        const TTBucket &bucket = buckets[key & bucketMask];
+        for (const TTSlot &slot : bucket.slots)
+        {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            uint64_t keyXorData = slot.keyXorData.load(std::memory_order_relaxed);
+            if ((keyXorData ^ data) == key && data != 0)
+            {
+                stats.hits++;
+                out = TTEntry::Unpack(data);
+                return true;
+            }
+        }
+        stats.misses++;
+        return false;
+    }
+
+    // 写入表项:同一局面直接更新;否则优先用空位,再替换代数最旧,深度最浅的一项
+    void Store(uint64_t key, int depth, BoundType bound, int score, uint16_t move, TTStats &stats)
+    {
+        stats.stores++;
+        TTBucket &bucket = buckets[key & bucketMask];
+        TTSlot *replace = &bucket.slots[0];
+        TTEntry old = TTEntry::Unpack(0);
+        bool sameKey = false;
+        int worstValue = INT_MAX;
+        for (TTSlot &slot : bucket.slots)
+        {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            uint64_t slotKey = slot.keyXorData.load(std::memory_order_relaxed) ^ data;
+            TTEntry entry = TTEntry::Unpack(data);
+            if (data == 0 || slotKey == key)
+            {
+                replace = &slot;
+                old = entry;
+                sameKey = (data != 0);
+                break;
+            }
+            int age = (generation - entry.Generation()) & 63;
+            int value = entry.depth - 8 * age;
+            if (value < worstValue)
+            {
+                worstValue = value;
+                replace = &slot;
+                old = entry;
+            }
+        }
+        if (old.Bound() != BOUND_NONE && !sameKey)
+            stats.overwrites++;
+        // 同一局面的更浅的结果不覆盖更深的最佳走法
+        if (move == NO_MOVE && sameKey)
+            move = old.move;
+
+        TTEntry entry;
+        entry.score = score;
+        entry.move = move;
+        entry.depth = (int8_t)depth;
+        entry.boundGen = (uint8_t)(bound | (generation << 2));
+        uint64_t data = entry.Pack();
+        replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+        replace->data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<TTBucket[]> buckets;
+    size_t bucketCount;
+    size_t bucketMask;
+    int generation;
+};
@@ -0,0 +1,110 @@
+#include "weights.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+PatternWeights::PatternWeights()
+{
+    int values[PATTERN_COUNT];
+    for (int p = 0; p < PATTERN_COUNT; p++)
+        values[p] = PATTERN_STONE_SCORE[p];
+    Set(values);
+}
+
+void PatternWeights::Set(const int (&values)[PATTERN_COUNT])
+{
+    for (int p = 0; p < PATTERN_COUNT; p++)
+        scores[p] = (int16_t)(PatternName(p) ? std::min(std::max(values[p], 0), PATTERN_WEIGHT_LIMIT) : 0);
+    for (int i = 0; i < PATTERN_TABLE_SIZE; i++)
+    {
+        table[i].pattern = PATTERNS.entries[i].pattern;
+        table[i].score = scores[table[i].pattern];
+    }
+}
+
+bool PatternWeights::IsDefault() const
+{
+    for (int p = 0; p < PATTERN_COUNT; p++)
+    {
+        if (scores[p] != PATTERN_STONE_SCORE[p])
+            return false;
+    }
+    return true;
+}
+
+const char *PatternWeights::PatternName(int pattern)
+{
+    switch (pattern)
+    {
+    case PATTERN_ONE:
+        return "one";
+    case PATTERN_BLOCKED_TWO:
+        return "blocked-two";
+    case PATTERN_TWO:
+        return "two";
+    case PATTERN_BLOCKED_THREE:
+        return "blocked-three";
+    case PATTERN_SPLIT_THREE:
+        return "split-three";
+    case PATTERN_THREE:
+        return "three";
+    case PATTERN_FOUR:
+        return "four";
+    case PATTERN_OPEN_FOUR:
+        return "open-four";
+    default:
+        return nullptr;
+    }
+}
+
+bool PatternWeights::Load(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    int values[PATTERN_COUNT] = {};
+    bool seen[PATTERN_COUNT] = {};
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream words(line);
+        std::string name, rest;
+        int value;
+        if (!(words >> name) || name[0] == '#')
+            continue;
+        if (!(words >> value) || words >> rest || value < 0 || value > PATTERN_WEIGHT_LIMIT)
+            return false;
+        int pattern = 0;
+        while (pattern < PATTERN_COUNT && !(PatternName(pattern) && name == PatternName(pattern)))
+            pattern++;
+        if (pattern == PATTERN_COUNT || seen[pattern])
+            return false;
+        seen[pattern] = true;
+        values[pattern] = value;
+    }
+    for (int p = 0; p < PATTERN_COUNT; p++)
+    {
+        if (PatternName(p) && !seen[p])
+            return false;
+    }
+    Set(values);
+    return true;
+}
+
+bool PatternWeights::Save(const std::string &path, const std::string &comment) const
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+    std::istringstream lines(comment);
+    std::string line;
+    while (std::getline(lines, line))
+        fprintf(file, "# %s\n", line.c_str());
+    for (int p = 0; p < PATTERN_COUNT; p++)
+    {
+        if (PatternName(p))
+            fprintf(file, "%s %d\n", PatternName(p), scores[p]);
+    }
+    return fclose(file) == 0;
+}
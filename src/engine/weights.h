@@ -0,0 +1,41 @@
+// 棋型权重:评估时每个棋型一个子的分数,默认值是PATTERN_STONE_SCORE,可以从权重文件读取调好的值
+// 文件是文本格式,每行"棋型名 分数",#开头的行是注释,八个棋型都要给出,例如
+//   # 由gomoku-tune生成
+//   one 1
+//   blocked-two 5
+//   ...
+//   open-four 650
+// 无棋型和五连不计分(五连直接判定胜负),不出现在文件中
+#pragma once
+#include <string>
+#include "patterns.h"
+
+// 每个分数的上限:19路满盘每个子四个方向都按上限计分,总分也远小于胜负分数
+const int PATTERN_WEIGHT_LIMIT = 4000;
+
+class PatternWeights
+{
+public:
+    // 默认权重
+    PatternWeights();
+
+    // 读取权重文件,缺少棋型,重复,名字不认识或者分数越界时返回false,已有的权重不变
+    bool Load(const std::string &path);
+    bool Save(const std::string &path, const std::string &comment = std::string()) const;
+
+    // 换成给定的分数,无棋型和五连的分数忽略,其余截断到[0,PATTERN_WEIGHT_LIMIT]
+    void Set(const int (&values)[PATTERN_COUNT]);
+
+    int Score(int pattern) const { return scores[pattern]; }
+    bool IsDefault() const;
+
+    // 按当前权重生成的查找表,棋型与PATTERNS相同,交给IncrementalEvaluatorT使用
+    const PatternEntry *Table() const { return table; }
+
+    // 权重文件中棋型的名字,无棋型和五连返回nullptr
+    static const char *PatternName(int pattern);
+
+private:
+    int16_t scores[PATTERN_COUNT];
+    PatternEntry table[PATTERN_TABLE_SIZE];
+};
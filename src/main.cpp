@@ -4,16 +4,46 @@
 #include <vector>
 #include <algorithm>
 #include <climits> //// 提供 INT_MAX 和 INT_MIN 等常量
-#include <stack>   //栈的数据结构,后续用于实现悔棋的功能.
+#include <ctime>   // 对局记录的开始时间
+#include <atomic>  // 后台搜索的完成和取消标记
+#include <thread>  // 后台搜索线程
+#include <chrono>  // 统计AI的应答用时
+#include <fstream> // 统计日志
+#include <string>
+#include <cstring>
+#include "engine/session.h" // 棋盘,评估和搜索,与图形界面无关
+#include "engine/record.h"  // 对局记录
+#include "asset_pack.h"        // 音频资源包
 
 //****************第二部分 游戏常量定义,基础枚举类型,结构体定义****************
 // 游戏常量
-const int BOARD_SIZE = 15; // 15x15棋盘
-const int CELL_SIZE = 40;  // 每个格子的大小
-const int PADDING = 50;    // 边缘距离
+const int GRID_PIXELS = 560; // 网格的边长,每个格子的大小为GRID_PIXELS / (棋盘大小 - 1),15路棋盘是40
+const int PADDING = 50;      // 边缘距离
 // 窗口宽高
 const int WINDOW_WIDTH = 1000;
 const int WINDOW_HEIGHT = 660;
+// 棋盘层(背景,网格,星位和棋子)的边长,棋子会超出木色背景,所以包括四周的边缘
+const int BOARD_PIXELS = 2 * PADDING + GRID_PIXELS;
+
+// 音频资源:先从资源包读取,资源包里没有时读取音频目录下的文件;
+// 两者都先在程序所在目录下找,再在当前目录下找,所以从其他目录启动程序也能找到
+const char *const AUDIO_PACK_PATH = "assets/audio.pak";
+const char *const AUDIO_DIR = "Sound/";
+const char *const MUSIC_FILE = "bg_music.MP3";
+const char *const PLACE_SOUND_FILE = "place.MP3";
+const char *const WIN_SOUND_FILE = "win.wav";
+const char *const AI_WIN_SOUND_FILE = "ai_win.MP3";
+
+// 默认的对局记录文件,每盘棋结束(分出胜负,清空棋盘,换棋盘大小或者退出)时追加一盘
+const char *const GAME_RECORD_PATH = "games.gmr";
+
+// 程序开始运行的时刻,用于统计启动到第一帧和音频就绪的用时
+const std::chrono::steady_clock::time_point PROGRAM_START = std::chrono::steady_clock::now();
+
+// 帧率:有事情进行时用ACTIVE_FPS,只有后台思考时用PONDER_FPS刷新进度,空闲时等待输入事件
+const int ACTIVE_FPS = 60;
+const int PONDER_FPS = 10;
+const double INPUT_ACTIVE_SECONDS = 0.5; // 最后一次输入之后保持ACTIVE_FPS的时间
 
 // 颜色定义
 const Color BOARD_COLOR = {210, 180, 140, 255}; // 棋盘背景色,木色
@@ -21,14 +51,6 @@ const Color LINE_COLOR = BLACK;                 // 线的颜色
 const Color TEXT_COLOR = BLACK;                 // 文字的颜色
 const Color UI_BG_COLOR = {136, 136, 136, 255}; // 右侧UI的颜色
 
-// 棋子类型
-enum Piece
-{
-    PIECE_EMPTY = 0, // 空
-    PIECE_BLACK = 1, // 黑子
-    PIECE_WHITE = 2  // 白子
-};
-
 // 游戏状态
 enum GameState
 {
@@ -38,14 +60,35 @@ enum GameState
     STATE_WHITE_WIN  // 白子获胜
 };
 
-// 三种游戏模式
+// 四种游戏模式
 enum GameMode
 {
     MODE_PVP,      // 玩家对战
     MODE_PVE_EASY, // easy AI
-    MODE_PVE_HARD  // hard AI
+    MODE_PVE_HARD, // hard AI
+    MODE_PVE_MCTS  // 蒙特卡洛树搜索AI,用法与困难模式相同
+};
+
+// 统计相关的选项,只在打开统计的构建中起作用(见engine/instrument.h)
+struct InstrumentConfig
+{
+    bool overlay = false;    // 启动时显示统计面板,游戏中按F3切换
+    std::string searchLog;   // 每步搜索的统计,每行一个JSON对象
+    std::string frameLog;    // 每帧的用时,CSV格式
+};
+
+// 一帧中各部分的用时(毫秒),AIPlay在Draw中调用,它的用时也计入Draw
+struct FrameTiming
+{
+    double frameMs = 0;  // 整帧用时,包括等待下一帧的时间
+    double updateMs = 0;
+    double drawMs = 0;   // BeginDrawing和EndDrawing之间的绘制和输入处理
+    double aiPlayMs = 0;
 };
 
+// 统计面板显示最近多少帧的平均和最大用时
+const int FRAME_HISTORY = 120;
+
 // 按钮结构体
 struct Button
 {
@@ -59,27 +102,40 @@ struct Button
 class GomokuGame
 {
 public:
-    GomokuGame() : gameMode(MODE_PVP), gameState(STATE_MENU), currentPlayer(PIECE_BLACK),
-                   musicPlaying(false)
+    GomokuGame(const AIConfig &config = AIConfig(), const InstrumentConfig &instrument = InstrumentConfig(),
+               int size = BOARD_SIZE, const std::string &recordFile = GAME_RECORD_PATH)
+        : gameMode(MODE_PVP), gameState(STATE_MENU), currentPlayer(PIECE_BLACK), aiConfig(config), cellSize(0),
+          aiDone(false), aiCancel(false), aiPonder(false), ponderMove(-1, -1),
+          recordPath(recordFile), gameStartUnix(0), gameRecorded(false),
+          bgMusic(), placeSound(), winSound(), aiWinSound(), audioLoaded(false), audioReady(false), musicPlaying(false),
+          showStats(instrument.overlay), frameCount(0), hasLastSearch(false),
+          boardLayer(), boardDirty(true), targetFps(0), lastInputTime(0)
     {
-        InitAudioDevice();                               // 初始化音频设备
-        bgMusic = LoadMusicStream("sound/bg_music.MP3"); // 加载背景音乐
-        placeSound = LoadSound("sound/place.mp3");       // 加载落子音效
-        winSound = LoadSound("sound/win.wav");           // 黑子获胜音效
-        aiWinSound = LoadSound("sound/ai_win.MP3");      // AI获胜音效
-
-        // 音量
-        SetMusicVolume(bgMusic, 0.5f);
-        SetSoundVolume(placeSound, 0.7f);
-        SetSoundVolume(winSound, 0.8f);
-        SetSoundVolume(aiWinSound, 0.8f);
+        SetBoardSize(size);
+        if (STATS_ENABLED)
+        {
+            if (!instrument.searchLog.empty())
+                searchLog.open(instrument.searchLog);
+            if (!instrument.frameLog.empty())
+            {
+                frameLog.open(instrument.frameLog);
+                frameLog << "frame,frame_ms,update_ms,draw_ms,aiplay_ms\n";
+            }
+        }
 
-        bgMusic.looping = true; // 循环播放
+        // 音频设备的初始化和音频的解码放到后台线程,不耽误窗口出现
+        audioThread = std::thread([this]()
+                                  { LoadAudio(); });
     }
 
     // 析构函数,释放资源
     ~GomokuGame()
     {
+        CancelAIThinking();
+        SaveGameRecord();
+        WaitForEngine();
+        if (audioThread.joinable())
+            audioThread.join();
         UnloadMusicStream(bgMusic);
         UnloadSound(placeSound);
         UnloadSound(winSound);
@@ -91,17 +147,33 @@ public:
     void Run()
     {
         InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Gomoku Game"); // 创建窗口
-        SetTargetFPS(60);                                       // 设置帧率60
+        SetTargetFPS(ACTIVE_FPS);                               // 设置帧率60,空闲时由UpdateFrameRate降低
+        targetFps = ACTIVE_FPS;
+        boardLayer = LoadRenderTexture(BOARD_PIXELS, BOARD_PIXELS);
+        boardDirty = true;
 
         // 游戏主循环
+        bool firstFrame = true;
         while (!WindowShouldClose())
         {
+            frame = FrameTiming();
             // 更新游戏状态
-            Update();
+            {
+                ScopedTimer timer(frame.updateMs);
+                Update();
+            }
             Draw();
+            if (firstFrame)
+            {
+                std::cout << "first frame after " << MillisecondsSinceStart() << "ms" << std::endl;
+                firstFrame = false;
+            }
+            RecordFrame();
+            UpdateFrameRate();
         }
 
         // 关闭窗口
+        UnloadRenderTexture(boardLayer);
         CloseWindow();
     }
 
@@ -109,13 +181,180 @@ private:
     GameMode gameMode;
     GameState gameState;
     Piece currentPlayer;
-    Piece board[BOARD_SIZE][BOARD_SIZE];
-    std::stack<std::pair<int, int>> moveHistory;
+    AIConfig aiConfig;
+    std::unique_ptr<GameSession> session; // 当前棋盘大小的局面和困难模式AI的搜索引擎
+    int cellSize;                         // 每个格子的大小,随棋盘大小变化
+    std::thread engineThread; // 在后台配置搜索引擎,joinable表示还没有等待它完成
+    // 困难模式AI在后台线程搜索,游戏循环每帧检查是否完成
+    std::thread aiThread;          // 后台搜索线程,joinable表示有一次搜索尚未取走结果
+    std::atomic<bool> aiDone;      // 搜索已结束,结果可以取走
+    std::atomic<bool> aiCancel;    // 取消标记,悔棋,清空棋盘,返回菜单时置位
+    std::atomic<bool> aiPonder;    // 后台思考标记:玩家思考期间搜索假设玩家走了ponderMove之后的局面
+    std::pair<int, int> ponderMove; // 预测的玩家下一步,(-1,-1)表示没有在后台思考
+    SearchResult aiResult;         // 搜索结果,aiDone之后才能读取
+    std::chrono::steady_clock::time_point playerMoveTime; // 玩家落子的时刻,用于统计AI的应答用时
+    std::vector<std::pair<int, int>> moveHistory; // 按顺序的落子,悔棋时从末尾撤销
+    // 对局记录
+    std::string recordPath;                              // 对局记录文件,空表示不记录
+    GameRecordWriter recordWriter;                       // 第一次保存时以追加方式打开
+    std::chrono::steady_clock::time_point gameStartTime; // 这一局开始的时刻
+    std::chrono::steady_clock::time_point lastMoveTime;  // 最近一步落子的时刻
+    uint32_t gameStartUnix;                              // 这一局开始的Unix时间
+    bool gameRecorded;                                   // 这一局已经保存,悔棋后清除
     Music bgMusic;
     Sound placeSound;
     Sound winSound;
     Sound aiWinSound;
+    std::vector<unsigned char> musicData; // 背景音乐的压缩数据,音乐流播放时边读边解码,要一直保留
+    std::thread audioThread;              // 后台加载音频的线程
+    std::atomic<bool> audioLoaded;        // 后台线程已经加载完毕
+    bool audioReady;                      // 游戏线程已经确认加载完毕,此前的音效直接跳过
     bool musicPlaying;
+    // 统计:没有打开统计的构建中计时器为空,下面的记录和显示代码都不会执行
+    bool showStats;                            // 显示统计面板
+    FrameTiming frame;                         // 当前帧的用时
+    FrameTiming frameHistory[FRAME_HISTORY];   // 最近的帧,循环覆盖
+    long long frameCount;                      // 已经记录的帧数
+    SearchResult lastSearch;                   // 最近一次困难模式搜索的结果
+    bool hasLastSearch;
+    std::ofstream searchLog;
+    std::ofstream frameLog;
+    // 绘制缓存和帧率
+    RenderTexture2D boardLayer; // 棋盘层的缓存,只在落子,悔棋,清空棋盘后重画
+    bool boardDirty;            // 棋盘层需要重画
+    int targetFps;              // 当前的目标帧率,0表示等待输入事件
+    double lastInputTime;       // 最后一次鼠标或键盘输入的时刻(秒)
+
+    // 等待后台的搜索引擎配置完成,之后才能使用session的搜索部分
+    void WaitForEngine()
+    {
+        if (engineThread.joinable())
+            engineThread.join();
+    }
+
+    // 换成size路的棋盘,重新创建会话
+    // 分配置换表(几十毫秒,主要是清零)和打开开局库放到后台,开始下一局前再等它完成
+    void SetBoardSize(int size)
+    {
+        CancelAIThinking();
+        SaveGameRecord();
+        WaitForEngine();
+        session = CreateGameSession(size);
+        cellSize = GRID_PIXELS / (size - 1);
+        boardDirty = true;
+        GameSession *configuring = session.get();
+        engineThread = std::thread([configuring, this]()
+                                   {
+                                       std::string error;
+                                       if (!configuring->Configure(aiConfig, error))
+                                           std::cerr << "warning: " << error << std::endl;
+                                   });
+    }
+
+    // 菜单上的棋盘大小按钮:在SUPPORTED_BOARD_SIZES中依次切换
+    void NextBoardSize()
+    {
+        const int count = (int)(sizeof(SUPPORTED_BOARD_SIZES) / sizeof(SUPPORTED_BOARD_SIZES[0]));
+        int next = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (SUPPORTED_BOARD_SIZES[i] == session->Size())
+                next = (i + 1) % count;
+        }
+        SetBoardSize(SUPPORTED_BOARD_SIZES[next]);
+    }
+
+    // 棋盘坐标在屏幕上的位置
+    int ScreenCoord(int i) const
+    {
+        return PADDING + i * cellSize;
+    }
+
+    static double MillisecondsSinceStart()
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - PROGRAM_START).count();
+    }
+
+    // 读取一个音频资源,找不到时在终端给出提示
+    static bool ReadAudioAsset(const AssetPack &pack, const char *name, std::vector<unsigned char> &data)
+    {
+        if (pack.IsOpen() && pack.Read(name, data))
+            return true;
+        const std::string dirs[2] = {GetApplicationDirectory(), ""};
+        for (const std::string &dir : dirs)
+        {
+            if (ReadWholeFile(dir + AUDIO_DIR + name, data))
+                return true;
+        }
+        std::cerr << "audio asset " << name << " not found" << std::endl;
+        return false;
+    }
+
+    // 文件的扩展名,小写,带点号,解码时用来识别格式
+    static std::string FileType(const char *name)
+    {
+        const char *dot = strrchr(name, '.');
+        std::string type = dot ? dot : "";
+        for (char &c : type)
+            c = (char)tolower((unsigned char)c);
+        return type;
+    }
+
+    static Sound DecodeSound(const AssetPack &pack, const char *name, float volume)
+    {
+        std::vector<unsigned char> data;
+        if (!ReadAudioAsset(pack, name, data))
+            return Sound();
+        Wave wave = LoadWaveFromMemory(FileType(name).c_str(), data.data(), (int)data.size());
+        Sound sound = LoadSoundFromWave(wave);
+        UnloadWave(wave);
+        SetSoundVolume(sound, volume);
+        return sound;
+    }
+
+    // 后台线程:初始化音频设备,解码音效,打开背景音乐的音乐流
+    // 音效在这里整段解码成波形,背景音乐只打开,播放时才逐段解码
+    void LoadAudio()
+    {
+        InitAudioDevice();
+        AssetPack pack;
+        const std::string packPaths[2] = {std::string(GetApplicationDirectory()) + AUDIO_PACK_PATH, AUDIO_PACK_PATH};
+        for (const std::string &path : packPaths)
+        {
+            if (pack.Open(path))
+                break;
+        }
+
+        placeSound = DecodeSound(pack, PLACE_SOUND_FILE, 0.7f); // 落子音效
+        winSound = DecodeSound(pack, WIN_SOUND_FILE, 0.8f);     // 黑子获胜音效
+        aiWinSound = DecodeSound(pack, AI_WIN_SOUND_FILE, 0.8f); // AI获胜音效
+        if (ReadAudioAsset(pack, MUSIC_FILE, musicData))
+        {
+            bgMusic = LoadMusicStreamFromMemory(FileType(MUSIC_FILE).c_str(), musicData.data(), (int)musicData.size());
+            SetMusicVolume(bgMusic, 0.5f);
+            bgMusic.looping = true; // 循环播放
+        }
+        audioLoaded.store(true, std::memory_order_release);
+    }
+
+    // 每帧检查后台加载是否完成,完成后开始播放加载期间点过的背景音乐
+    void CheckAudioLoaded()
+    {
+        if (audioReady || !audioLoaded.load(std::memory_order_acquire))
+            return;
+        audioThread.join();
+        audioReady = true;
+        std::cout << "audio ready after " << MillisecondsSinceStart() << "ms" << std::endl;
+        if (musicPlaying)
+            PlayMusicStream(bgMusic);
+    }
+
+    // 播放音效,音频还没有加载完时跳过
+    void PlayEffect(const Sound &sound)
+    {
+        if (audioReady)
+            PlaySound(sound);
+    }
 
     // 创建一个按钮变量
     Button CreateButton(float x, float y, float width, float height, const char *text)
@@ -139,15 +378,16 @@ private:
     // 初始化棋盘,此时没有任何棋子
     void InitBoard()
     {
-        while (!moveHistory.empty())
-            moveHistory.pop();
-        for (int y = 0; y < BOARD_SIZE; y++)
-        {
-            for (int x = 0; x < BOARD_SIZE; x++)
-            {
-                board[y][x] = PIECE_EMPTY;
-            }
-        }
+        CancelAIThinking();
+        SaveGameRecord();
+        moveHistory.clear();
+        gameRecorded = false;
+        gameStartTime = std::chrono::steady_clock::now();
+        gameStartUnix = (uint32_t)time(nullptr);
+        boardDirty = true;
+        WaitForEngine();
+        session->NewGame();
+        session->SetEngine(gameMode == MODE_PVE_MCTS ? AI_ENGINE_MCTS : AI_ENGINE_PVS);
         currentPlayer = PIECE_BLACK;
     }
 
@@ -158,323 +398,295 @@ private:
         gameState = STATE_PLAYING;
     }
 
-    // 绘制棋盘及其元素
+    // 绘制棋盘:棋盘层画在缓存的纹理里,只在棋盘变化后重画,平时每帧只贴一次纹理
     void DrawBoard()
     {
+        if (boardDirty)
+        {
+            BeginTextureMode(boardLayer);
+            ClearBackground(RAYWHITE);
+            DrawBoardLayer();
+            EndTextureMode();
+            boardDirty = false;
+        }
+        // 纹理的y轴与屏幕相反,源矩形取负高度翻转过来
+        DrawTextureRec(boardLayer.texture, Rectangle{0, 0, (float)BOARD_PIXELS, -(float)BOARD_PIXELS},
+                       Vector2{0, 0}, WHITE);
+    }
+
+    // 绘制棋盘及其元素
+    void DrawBoardLayer()
+    {
+        const int size = session->Size();
+        const int last = ScreenCoord(size - 1);
         // 棋盘背景
         DrawRectangle(
             PADDING - 10,
             PADDING - 10,
-            (BOARD_SIZE - 1) * CELL_SIZE + 20,
-            (BOARD_SIZE - 1) * CELL_SIZE + 20,
+            last - PADDING + 20,
+            last - PADDING + 20,
             BOARD_COLOR);
 
         // 网格线
-        for (int i = 0; i < BOARD_SIZE; i++)
+        for (int i = 0; i < size; i++)
         {
             DrawLineEx(
-                Vector2{(float)PADDING, (float)(PADDING + i * CELL_SIZE)},
-                Vector2{(float)(PADDING + (BOARD_SIZE - 1) * CELL_SIZE), (float)(PADDING + i * CELL_SIZE)},
+                Vector2{(float)PADDING, (float)ScreenCoord(i)},
+                Vector2{(float)last, (float)ScreenCoord(i)},
                 1.5f, LINE_COLOR);
             DrawLineEx(
-                Vector2{(float)(PADDING + i * CELL_SIZE), (float)PADDING},
-                Vector2{(float)(PADDING + i * CELL_SIZE), (float)(PADDING + (BOARD_SIZE - 1) * CELL_SIZE)},
+                Vector2{(float)ScreenCoord(i), (float)PADDING},
+                Vector2{(float)ScreenCoord(i), (float)last},
                 1.5f, LINE_COLOR);
         }
 
-        // 星位点(五子棋棋盘的标准布局)
-        const int starPoints[5][2] = {{3, 3}, {11, 3}, {3, 11}, {11, 11}, {7, 7}};
+        // 星位点:四角离边3路,加上天元;19路棋盘再加上四边的中点,共9个
+        const int near = 3, far = size - 4, mid = size / 2;
+        std::vector<std::pair<int, int>> starPoints = {{near, near}, {far, near}, {near, far}, {far, far}, {mid, mid}};
+        if (size >= 19)
+        {
+            starPoints.insert(starPoints.end(), {{mid, near}, {near, mid}, {far, mid}, {mid, far}});
+        }
         for (const auto &point : starPoints)
         {
             DrawCircle(
-                PADDING + point[0] * CELL_SIZE,
-                PADDING + point[1] * CELL_SIZE,
+                ScreenCoord(point.first),
+                ScreenCoord(point.second),
                 5, LINE_COLOR);
         }
 
         // 放置棋子
-        for (int y = 0; y < BOARD_SIZE; y++)
+        const int radius = cellSize / 2 - 2;
+        for (int y = 0; y < size; y++)
         {
-            for (int x = 0; x < BOARD_SIZE; x++)
+            for (int x = 0; x < size; x++)
             {
-                if (board[y][x] == PIECE_BLACK)
+                Piece piece = session->At(x, y);
+                if (piece == PIECE_BLACK)
                 {
-                    DrawCircle(
-                        PADDING + x * CELL_SIZE,
-                        PADDING + y * CELL_SIZE,
-                        CELL_SIZE / 2 - 2, BLACK);
+                    DrawCircle(ScreenCoord(x), ScreenCoord(y), radius, BLACK);
                 }
-                else if (board[y][x] == PIECE_WHITE)
+                else if (piece == PIECE_WHITE)
                 {
-                    DrawCircle(
-                        PADDING + x * CELL_SIZE,
-                        PADDING + y * CELL_SIZE,
-                        CELL_SIZE / 2 - 2, WHITE);
-                    DrawCircleLines(
-                        PADDING + x * CELL_SIZE,
-                        PADDING + y * CELL_SIZE,
-                        CELL_SIZE / 2 - 2, BLACK);
+                    DrawCircle(ScreenCoord(x), ScreenCoord(y), radius, WHITE);
+                    DrawCircleLines(ScreenCoord(x), ScreenCoord(y), radius, BLACK);
                 }
             }
         }
     }
 
-    // 检查是否有五子连珠,检查黑子和白子在四个方向(横,竖,左斜,右斜)
-    bool CheckWin(int x, int y)
-    {
-        if (board[y][x] == PIECE_EMPTY)
-            return false;
-
-        const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
-        for (const auto &dir : dirs)
-        {
-            int count = 1;
-            int dx = dir[0], dy = dir[1];
-
-            for (int i = 1; i < 5; i++)
-            {
-                int nx = x + dx * i, ny = y + dy * i;
-                if (nx >= BOARD_SIZE || ny >= BOARD_SIZE || board[ny][nx] != board[y][x])
-                    break;
-                count++;
-            }
-
-            for (int i = 1; i < 5; i++)
-            {
-                int nx = x - dx * i, ny = y - dy * i;
-                if (nx < 0 || ny < 0 || board[ny][nx] != board[y][x])
-                    break;
-                count++;
-            }
-
-            // 如果同一个方向等于五个字,就直接返回
-            if (count >= 5)
-                return true;
-        }
-
-        return false;
-    }
-
     // 悔棋函数,使用栈的数据结构实现,撤销最近的一步棋
     void UndoMove()
     {
+        CancelAIThinking();
         if (moveHistory.empty())
             return;
 
-        auto lastMove = moveHistory.top();
-        moveHistory.pop();
-        board[lastMove.second][lastMove.first] = PIECE_EMPTY;
+        auto lastMove = moveHistory.back();
+        moveHistory.pop_back();
+        session->UnmakeMove(lastMove.first, lastMove.second);
+        boardDirty = true;
+        gameRecorded = false;
         currentPlayer = (currentPlayer == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
 
         // 如果撤回的是AI的轮次,则回退两步棋(AI一次,人类一次),保证悔棋完成后是人类的轮次
-        if ((gameMode == MODE_PVE_EASY || gameMode == MODE_PVE_HARD) &&
-            currentPlayer == PIECE_WHITE && !moveHistory.empty())
+        if (gameMode != MODE_PVP && currentPlayer == PIECE_WHITE && !moveHistory.empty())
         {
-            lastMove = moveHistory.top();
-            moveHistory.pop();
-            board[lastMove.second][lastMove.first] = PIECE_EMPTY;
+            lastMove = moveHistory.back();
+            moveHistory.pop_back();
+            session->UnmakeMove(lastMove.first, lastMove.second);
             currentPlayer = PIECE_BLACK;
         }
     }
 
-    //***********以下是AI算法部分************
-    // 评估函数,评估棋盘的得分,从而选择下一步棋的最佳位置
-    int EvaluateBoard()
+    // 记下一步落子
+    void AddToHistory(std::pair<int, int> move)
     {
-        int score = 0;
-        for (int y = 0; y < BOARD_SIZE; y++)
-        {
-            for (int x = 0; x < BOARD_SIZE; x++)
-            {
-                if (board[y][x] != PIECE_EMPTY)
-                {
-                    const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
-
-                    for (const auto &dir : dirs)
-                    {
-                        int dx = dir[0], dy = dir[1];
-                        int count = 1;
-                        bool blocked = false;
+        moveHistory.push_back(move);
+        lastMoveTime = std::chrono::steady_clock::now();
+    }
 
-                        for (int i = 1; i < 5; i++)
-                        {
-                            int nx = x + dx * i, ny = y + dy * i;
-                            if (nx < 0 || nx >= BOARD_SIZE || ny < 0 || ny >= BOARD_SIZE)
-                            {
-                                blocked = true;
-                                break;
-                            }
-                            if (board[ny][nx] == board[y][x])
-                                count++;
-                            else if (board[ny][nx] == PIECE_EMPTY)
-                                break;
-                            else
-                            {
-                                blocked = true;
-                                break;
-                            }
-                        }
+    // 把当前这一局追加到对局记录文件,没有落子或者已经保存过时跳过
+    // 胜方由最后一步是否成五判断,悔棋之后的状态也不会记错
+    void SaveGameRecord()
+    {
+        if (recordPath.empty() || gameRecorded || moveHistory.empty())
+            return;
+        gameRecorded = true;
+        if (!recordWriter.IsOpen() && !recordWriter.Open(recordPath, true))
+        {
+            std::cerr << "cannot open game record " << recordPath << std::endl;
+            recordPath.clear();
+            return;
+        }
+        GameRecord game;
+        game.boardSize = session->Size();
+        const std::pair<int, int> &last = moveHistory.back();
+        if (session->CheckWin(last.first, last.second))
+            game.winner = session->At(last.first, last.second);
+        game.finished = game.winner != PIECE_EMPTY || (int)moveHistory.size() == game.boardSize * game.boardSize;
+        game.moves = moveHistory;
+        game.moveTimeMs = (gameMode == MODE_PVE_HARD || gameMode == MODE_PVE_MCTS) ? aiConfig.moveTimeMs : 0;
+        game.startTime = gameStartUnix;
+        game.durationMs = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(lastMoveTime - gameStartTime).count();
+        if (!recordWriter.Write(game) || !recordWriter.Flush())
+            std::cerr << "cannot write game record " << recordPath << std::endl;
+    }
 
-                        if (count >= 5)
-                            return (board[y][x] == PIECE_BLACK) ? INT_MAX : INT_MIN;
+    //***********以下是AI算法部分************
+    // 在终端输出本次搜索的深度,节点数和置换表统计
+    void PrintSearchStats(const SearchResult &result)
+    {
+        if (result.bookMove)
+        {
+            std::cout << "book move (" << result.bestMove.first << "," << result.bestMove.second << ")" << std::endl;
+            return;
+        }
+        const ThreatResult &threat = result.threat;
+        std::cout << "threat " << (threat.found ? "win" : "none")
+                  << " nodes=" << threat.nodes
+                  << " time=" << threat.timeMs << "ms";
+        if (threat.found)
+            std::cout << " move=(" << threat.move.first << "," << threat.move.second << ") depth=" << threat.depth;
+        std::cout << " leafvcf=" << result.leafVcfNodes << std::endl;
+        if (threat.found)
+            return;
+        const TTStats &stats = result.ttStats;
+        double hitRate = stats.probes ? 100.0 * stats.hits / stats.probes : 0.0;
+        std::cout << "depth=" << result.depth
+                  << " nodes=" << result.nodes
+                  << " time=" << result.timeMs << "ms"
+                  << " nps=" << (result.timeMs > 0 ? (long long)(result.nodes * 1000.0 / result.timeMs) : 0)
+                  << " threads=" << result.threads << std::endl;
+        std::cout << "TT " << session->HashSizeInBytes() / (1024 * 1024) << "MB"
+                  << " probes=" << stats.probes
+                  << " hits=" << stats.hits << " (" << hitRate << "%)"
+                  << " misses=" << stats.misses
+                  << " cutoffs=" << stats.cutoffs
+                  << " stores=" << stats.stores
+                  << " overwrites=" << stats.overwrites << std::endl;
+    }
 
-                        int value = 0;
-                        switch (count)
-                        {
-                        case 4:
-                            value = (blocked) ? 500 : 2000;
-                            break;
-                        case 3:
-                            value = (blocked) ? 100 : 500;
-                            break;
-                        case 2:
-                            value = (blocked) ? 10 : 50;
-                            break;
-                        case 1:
-                            value = 1;
-                            break;
-                        }
+    // 在后台线程开始搜索当前局面(assumedMove不为(-1,-1)时是对手走了这一步之后的局面),
+    // 搜索使用局面的副本,游戏线程可以照常绘制和响应输入
+    // ponder为true时是后台思考,不受时间预算限制,直到玩家落子后清除aiPonder
+    void StartAIThinking(Piece side, bool ponder, std::pair<int, int> assumedMove = {-1, -1})
+    {
+        aiDone.store(false);
+        aiCancel.store(false);
+        aiPonder.store(ponder);
+        std::function<SearchResult()> task = session->SearchTask(side, &aiCancel, &aiPonder, assumedMove);
+        aiThread = std::thread([this, task]()
+                               {
+                                   aiResult = task();
+                                   aiDone.store(true, std::memory_order_release);
+                               });
+    }
 
-                        if (board[y][x] == PIECE_BLACK)
-                            score += value;
-                        else
-                            score -= value;
-                    }
-                }
-            }
+    // 取消正在进行的搜索并等待后台线程退出,结果直接丢弃
+    void CancelAIThinking()
+    {
+        if (aiThread.joinable())
+        {
+            aiCancel.store(true);
+            aiThread.join();
         }
-        return score;
+        aiPonder.store(false);
+        ponderMove = {-1, -1};
     }
 
-    // 获取当前棋盘上所有可下的位置
-    std::vector<std::pair<int, int>> GetPossibleMoves()
+    // AI落子后轮到玩家:用置换表里刚搜索过的结果预测玩家的下一步,
+    // 在后台搜索玩家走了这一步之后AI的应对,搜索结果同时留在置换表里
+    void StartPondering()
     {
-        std::vector<std::pair<int, int>> moves;
-        for (int y = 0; y < BOARD_SIZE; y++)
-        {
-            for (int x = 0; x < BOARD_SIZE; x++)
-            {
-                if (board[y][x] != PIECE_EMPTY)
-                {
-                    for (int dy = -1; dy <= 1; dy++)
-                    {
-                        for (int dx = -1; dx <= 1; dx++)
-                        {
-                            if (dx == 0 && dy == 0)
-                                continue;
+        std::pair<int, int> predicted;
+        if (!session->PredictMove(currentPlayer, predicted))
+            return;
+        session->MakeMove(predicted.first, predicted.second, currentPlayer);
+        bool wins = session->CheckWin(predicted.first, predicted.second);
+        session->UnmakeMove(predicted.first, predicted.second);
+        if (wins)
+            return;
+        ponderMove = predicted;
+        StartAIThinking((currentPlayer == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK, true, predicted);
+    }
 
-                            int nx = x + dx, ny = y + dy;
-                            if (nx >= 0 && nx < BOARD_SIZE && ny >= 0 && ny < BOARD_SIZE &&
-                                board[ny][nx] == PIECE_EMPTY)
-                            {
-                                bool exists = false;
-                                for (const auto &move : moves)
-                                {
-                                    if (move.first == nx && move.second == ny)
-                                    {
-                                        exists = true;
-                                        break;
-                                    }
-                                }
-                                if (!exists)
-                                    moves.emplace_back(nx, ny);
-                            }
-                        }
-                    }
-                }
-            }
+    // 玩家落子后处理后台思考:猜中时清除aiPonder,后台的搜索转为正常计时,
+    // 已经用满时间预算的话立即给出结果;没猜中就取消,轮到AI时重新搜索,置换表中的结果仍然可以复用
+    void OnPlayerMove(int x, int y)
+    {
+        playerMoveTime = std::chrono::steady_clock::now();
+        if (ponderMove.first < 0)
+            return;
+        if (gameState == STATE_PLAYING && ponderMove == std::make_pair(x, y))
+        {
+            aiPonder.store(false);
+            ponderMove = {-1, -1};
+            std::cout << "ponder hit (" << x << "," << y << ")" << std::endl;
+        }
+        else
+        {
+            CancelAIThinking();
         }
-        if (moves.empty())
-            moves.emplace_back(BOARD_SIZE / 2, BOARD_SIZE / 2);
-        return moves;
     }
 
-    // 递归实现最小最大算法,加上Alpha-Beta 剪枝，用于AI决策
-    int Minimax(int depth, int alpha, int beta, bool maximizingPlayer)
+    bool IsPondering() const
     {
-        if (depth == 0)
-            return EvaluateBoard();
+        return ponderMove.first >= 0;
+    }
 
-        auto moves = GetPossibleMoves();
-        if (moves.empty())
-            return EvaluateBoard();
+    bool IsAIThinking() const
+    {
+        return aiThread.joinable();
+    }
 
-        if (maximizingPlayer)
+    // 实现AI下棋的逻辑,轮到AI时每帧调用一次
+    // 困难模式和MCTS模式:没有搜索时启动后台搜索,搜索结束后取走结果落子;简单模式直接计算
+    void AIPlay(bool hardMode)
+    {
+        if (hardMode)
         {
-            int maxEval = INT_MIN;
-            for (const auto &move : moves)
+            if (!aiThread.joinable())
             {
-                int x = move.first, y = move.second;
-                board[y][x] = PIECE_BLACK;
-                if (CheckWin(x, y))
-                {
-                    board[y][x] = PIECE_EMPTY;
-                    return INT_MAX;
-                }
-                int eval = Minimax(depth - 1, alpha, beta, false);
-                board[y][x] = PIECE_EMPTY;
-                maxEval = std::max(maxEval, eval);
-                alpha = std::max(alpha, eval);
-                if (beta <= alpha)
-                    break;
+                StartAIThinking(currentPlayer, false);
             }
-            return maxEval;
-        }
-        else
-        {
-            int minEval = INT_MAX;
-            for (const auto &move : moves)
+            else if (aiDone.load(std::memory_order_acquire))
             {
-                int x = move.first, y = move.second;
-                board[y][x] = PIECE_WHITE;
-                if (CheckWin(x, y))
-                {
-                    board[y][x] = PIECE_EMPTY;
-                    return INT_MIN;
-                }
-                int eval = Minimax(depth - 1, alpha, beta, true);
-                board[y][x] = PIECE_EMPTY;
-                minEval = std::min(minEval, eval);
-                beta = std::min(beta, eval);
-                if (beta <= alpha)
-                    break;
+                aiThread.join();
+                if (aiResult.depth > 0 || aiResult.threat.found || aiResult.bookMove)
+                    PrintSearchStats(aiResult);
+                RecordSearch(aiResult);
+                double replyMs = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - playerMoveTime)
+                                     .count();
+                std::cout << "reply " << replyMs << "ms after the player's move" << std::endl;
+                PlaceAIMove(aiResult.bestMove);
+                if (gameState == STATE_PLAYING)
+                    StartPondering();
             }
-            return minEval;
+            return;
         }
-    }
 
-    // 实现AI下棋的逻辑
-    void AIPlay(bool hardMode)
-    {
-        auto moves = GetPossibleMoves();
+        auto moves = session->GetPossibleMoves();
         if (moves.empty())
             return;
 
-        int bestScore = (currentPlayer == PIECE_BLACK) ? INT_MIN : INT_MAX;
         std::pair<int, int> bestMove = moves[0];
-
+        int bestScore = (currentPlayer == PIECE_BLACK) ? INT_MIN : INT_MAX;
         for (const auto &move : moves)
         {
             int x = move.first, y = move.second;
-            board[y][x] = currentPlayer;
-            if (CheckWin(x, y))
+            session->MakeMove(x, y, currentPlayer);
+            if (session->CheckWin(x, y))
             {
-                board[y][x] = PIECE_EMPTY;
+                session->UnmakeMove(x, y);
                 bestMove = move;
                 break;
             }
-            int score;
-            if (hardMode)
-            {
-                score = Minimax(3, INT_MIN, INT_MAX, currentPlayer == PIECE_WHITE);
-            }
-            else
-            {
-                score = EvaluateBoard();
-                if (currentPlayer == PIECE_WHITE)
-                    score = -score;
-            }
-            board[y][x] = PIECE_EMPTY;
+            int score = session->EvaluateBoard();
+            if (currentPlayer == PIECE_WHITE)
+                score = -score;
+            session->UnmakeMove(x, y);
 
             if (currentPlayer == PIECE_BLACK)
             {
@@ -493,22 +705,29 @@ private:
                 }
             }
         }
+        PlaceAIMove(bestMove);
+    }
 
+    // AI落子,判断胜负并交换走棋方
+    void PlaceAIMove(std::pair<int, int> bestMove)
+    {
         int x = bestMove.first, y = bestMove.second;
-        board[y][x] = currentPlayer;
-        moveHistory.push(bestMove);
-        PlaySound(placeSound);
+        session->MakeMove(x, y, currentPlayer);
+        boardDirty = true;
+        AddToHistory(bestMove);
+        PlayEffect(placeSound);
 
-        if (CheckWin(x, y))
+        if (session->CheckWin(x, y))
         {
             gameState = (currentPlayer == PIECE_BLACK) ? STATE_BLACK_WIN : STATE_WHITE_WIN;
+            SaveGameRecord();
             if (gameMode == MODE_PVP || currentPlayer == PIECE_BLACK)
             {
-                PlaySound(winSound);
+                PlayEffect(winSound);
             }
             else
             {
-                PlaySound(aiWinSound);
+                PlayEffect(aiWinSound);
             }
         }
         else
@@ -518,6 +737,87 @@ private:
     }
     // 至此,AI游戏算法部分完成
 
+    //***********以下是统计部分************
+    // 记录一帧的用时,写入帧日志
+    void RecordFrame()
+    {
+        if (!STATS_ENABLED)
+            return;
+        frame.frameMs = GetFrameTime() * 1000.0;
+        frameHistory[frameCount % FRAME_HISTORY] = frame;
+        frameCount++;
+        if (frameLog.is_open())
+        {
+            frameLog << frameCount << "," << frame.frameMs << "," << frame.updateMs << ","
+                     << frame.drawMs << "," << frame.aiPlayMs << "\n";
+        }
+    }
+
+    // 记录一次困难模式搜索,写入搜索日志
+    void RecordSearch(const SearchResult &result)
+    {
+        if (!STATS_ENABLED)
+            return;
+        lastSearch = result;
+        hasLastSearch = true;
+        if (searchLog.is_open())
+            searchLog << SearchResultJson(result) << std::endl;
+    }
+
+    // 在右侧边栏下方显示统计面板:最近FRAME_HISTORY帧各部分的平均和最大用时,以及最近一次搜索的计数
+    void DrawStatsOverlay()
+    {
+        int frames = (int)std::min<long long>(frameCount, FRAME_HISTORY);
+        FrameTiming sum, peak;
+        for (int i = 0; i < frames; i++)
+        {
+            const FrameTiming &t = frameHistory[i];
+            sum.frameMs += t.frameMs;
+            sum.updateMs += t.updateMs;
+            sum.drawMs += t.drawMs;
+            sum.aiPlayMs += t.aiPlayMs;
+            peak.frameMs = std::max(peak.frameMs, t.frameMs);
+            peak.updateMs = std::max(peak.updateMs, t.updateMs);
+            peak.drawMs = std::max(peak.drawMs, t.drawMs);
+            peak.aiPlayMs = std::max(peak.aiPlayMs, t.aiPlayMs);
+        }
+        double n = (frames > 0) ? frames : 1;
+
+        int y = 400;
+        const int line = 20;
+        DrawText(TextFormat("FPS %d  (avg/max ms, %d frames)", GetFPS(), frames), 720, y, 16, TEXT_COLOR);
+        y += line;
+        DrawText(TextFormat("frame  %6.2f / %6.2f", sum.frameMs / n, peak.frameMs), 720, y, 16, TEXT_COLOR);
+        y += line;
+        DrawText(TextFormat("update %6.2f / %6.2f", sum.updateMs / n, peak.updateMs), 720, y, 16, TEXT_COLOR);
+        y += line;
+        DrawText(TextFormat("draw   %6.2f / %6.2f", sum.drawMs / n, peak.drawMs), 720, y, 16, TEXT_COLOR);
+        y += line;
+        DrawText(TextFormat("aiplay %6.2f / %6.2f", sum.aiPlayMs / n, peak.aiPlayMs), 720, y, 16, TEXT_COLOR);
+        y += line + 8;
+
+        if (!hasLastSearch)
+        {
+            DrawText("no search yet", 720, y, 16, TEXT_COLOR);
+            return;
+        }
+        const SearchResult &r = lastSearch;
+        long long cutoffs = r.counters.TotalCutoffs();
+        DrawText(TextFormat("depth %d  %.0f ms  %s", r.depth, r.timeMs,
+                            r.bookMove ? "book" : (r.threat.found ? "threat" : "")),
+                 720, y, 16, TEXT_COLOR);
+        y += line;
+        DrawText(TextFormat("nodes %lld  leaf evals %lld", r.nodes, r.counters.leafEvals.Value()), 720, y, 16, TEXT_COLOR);
+        y += line;
+        DrawText(TextFormat("TT hits %.1f%%  cutoffs %lld",
+                            r.ttStats.probes ? 100.0 * r.ttStats.hits / r.ttStats.probes : 0.0, (long long)r.ttStats.cutoffs),
+                 720, y, 16, TEXT_COLOR);
+        y += line;
+        DrawText(TextFormat("beta cutoffs %lld  first move %.1f%%", cutoffs,
+                            cutoffs ? 100.0 * r.counters.betaCutoffs[0].Value() / cutoffs : 0.0),
+                 720, y, 16, TEXT_COLOR);
+    }
+
     // 绘制游戏右侧UI,边栏部分
     void DrawGameUI()
     {
@@ -537,6 +837,9 @@ private:
         case MODE_PVE_HARD:
             modeText = "AI Game(Hard)";
             break;
+        case MODE_PVE_MCTS:
+            modeText = "AI Game(MCTS)";
+            break;
         }
         DrawText(modeText, 720, 60, 20, TEXT_COLOR);
 
@@ -572,22 +875,49 @@ private:
             }
             else if (btnMenu.isHovered)
             {
+                CancelAIThinking();
                 gameState = STATE_MENU;
             }
             else if (btnMusic.isHovered)
             {
                 musicPlaying = !musicPlaying;
-                if (musicPlaying)
+                // 音频还在加载时,加载完成后由CheckAudioLoaded开始播放
+                if (audioReady && musicPlaying)
                 {
                     PlayMusicStream(bgMusic);
                 }
-                else
+                else if (audioReady)
                 {
                     StopMusicStream(bgMusic);
                 }
             }
         }
 
+        // 后台思考中:只显示深度,最佳走法是对假设局面的应对,不画在棋盘上
+        if (IsPondering())
+        {
+            int depth;
+            std::pair<int, int> best;
+            session->GetProgress(depth, best);
+            DrawText(TextFormat("Pondering... depth %d", depth), 720, 320, 20, DARKGRAY);
+        }
+        // AI思考中:显示正在搜索的深度和目前的最佳走法
+        else if (IsAIThinking())
+        {
+            int depth;
+            std::pair<int, int> best;
+            session->GetProgress(depth, best);
+            DrawText(TextFormat("Thinking... depth %d", depth), 720, 320, 20, DARKBLUE);
+            if (best.first >= 0)
+            {
+                DrawText(TextFormat("Best so far: (%d, %d)", best.first, best.second), 720, 350, 20, DARKBLUE);
+                DrawCircleLines(
+                    ScreenCoord(best.first),
+                    ScreenCoord(best.second),
+                    cellSize / 2 - 4, DARKBLUE);
+            }
+        }
+
         if (gameState == STATE_BLACK_WIN)
         {
             DrawText("Black Wins!", 720, 320, 30, RED);
@@ -596,6 +926,9 @@ private:
         {
             DrawText("White Wins!", 720, 320, 30, RED);
         }
+
+        if (STATS_ENABLED && showStats)
+            DrawStatsOverlay();
     }
 
     // 绘制游戏主菜单界面
@@ -614,14 +947,21 @@ private:
         Button btnPVP = CreateButton(startX, 200, buttonWidth, buttonHeight, "Pair Game");
         Button btnPVEEasy = CreateButton(startX, 280, buttonWidth, buttonHeight, "AI Game(Easy)");
         Button btnPVEHard = CreateButton(startX, 360, buttonWidth, buttonHeight, "AI Game(Hard)");
+        Button btnPVEMcts = CreateButton(startX, 440, buttonWidth, buttonHeight, "AI Game(MCTS)");
+        const char *sizeText = TextFormat("Board: %dx%d", session->Size(), session->Size());
+        Button btnSize = CreateButton(startX, 520, buttonWidth, 40, sizeText);
 
         btnPVP.isHovered = CheckCollisionPointRec(GetMousePosition(), btnPVP.bounds);
         btnPVEEasy.isHovered = CheckCollisionPointRec(GetMousePosition(), btnPVEEasy.bounds);
         btnPVEHard.isHovered = CheckCollisionPointRec(GetMousePosition(), btnPVEHard.bounds);
+        btnPVEMcts.isHovered = CheckCollisionPointRec(GetMousePosition(), btnPVEMcts.bounds);
+        btnSize.isHovered = CheckCollisionPointRec(GetMousePosition(), btnSize.bounds);
 
         DrawButton(&btnPVP);
         DrawButton(&btnPVEEasy);
         DrawButton(&btnPVEHard);
+        DrawButton(&btnPVEMcts);
+        DrawButton(&btnSize);
 
         if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
         {
@@ -643,22 +983,74 @@ private:
                 gameState = STATE_PLAYING;
                 InitBoard();
             }
+            else if (btnPVEMcts.isHovered)
+            {
+                gameMode = MODE_PVE_MCTS;
+                gameState = STATE_PLAYING;
+                InitBoard();
+            }
+            else if (btnSize.isHovered)
+            {
+                NextBoardSize();
+            }
         }
     }
 
     // 更新逻辑
     void Update()
     {
-        if (musicPlaying)
+        CheckAudioLoaded();
+        if (musicPlaying && audioReady)
         {
             UpdateMusicStream(bgMusic);
         }
+        if (STATS_ENABLED && IsKeyPressed(KEY_F3))
+            showStats = !showStats;
+
+        Vector2 mouseDelta = GetMouseDelta();
+        if (mouseDelta.x != 0 || mouseDelta.y != 0 || IsMouseButtonPressed(MOUSE_LEFT_BUTTON) || GetKeyPressed() != 0)
+            lastInputTime = GetTime();
+    }
+
+    // 根据正在进行的事情调整帧率:AI思考,播放音乐(需要每帧填充音频流)或者刚有输入时保持ACTIVE_FPS;
+    // 只有后台思考时用PONDER_FPS刷新进度;其余时候画面不会变化,等待输入事件,不占用CPU
+    void UpdateFrameRate()
+    {
+        int fps = 0;
+        if ((IsAIThinking() && !IsPondering()) || musicPlaying || GetTime() - lastInputTime < INPUT_ACTIVE_SECONDS)
+            fps = ACTIVE_FPS;
+        else if (IsPondering())
+            fps = PONDER_FPS;
+        if (fps == targetFps)
+            return;
+        if (fps == 0)
+        {
+            EnableEventWaiting();
+        }
+        else
+        {
+            if (targetFps == 0)
+                DisableEventWaiting();
+            SetTargetFPS(fps);
+        }
+        targetFps = fps;
     }
 
     // 绘制图像的函数,把UI绘制出来
+    // EndDrawing中包含等待下一帧的时间,不计入绘制用时
     void Draw()
     {
         BeginDrawing();
+        {
+            ScopedTimer timer(frame.drawMs);
+            DrawFrame();
+        }
+        EndDrawing();
+    }
+
+    // 一帧的绘制和输入处理
+    void DrawFrame()
+    {
         ClearBackground(RAYWHITE);
 
         if (gameState == STATE_MENU)
@@ -669,40 +1061,43 @@ private:
         {
             if (gameState == STATE_PLAYING)
             {
-                if ((gameMode == MODE_PVE_EASY || gameMode == MODE_PVE_HARD) &&
-                    currentPlayer == PIECE_WHITE)
+                if (gameMode != MODE_PVP && currentPlayer == PIECE_WHITE)
                 {
-                    AIPlay(gameMode == MODE_PVE_HARD);
+                    ScopedTimer aiTimer(frame.aiPlayMs);
+                    AIPlay(gameMode != MODE_PVE_EASY);
                 }
                 else
                 {
                     Vector2 mousePos = GetMousePosition();
                     if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
                     {
-                        int x = (mousePos.x - PADDING) / CELL_SIZE;
-                        int y = (mousePos.y - PADDING) / CELL_SIZE;
-                        if (x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE &&
-                            board[y][x] == PIECE_EMPTY)
+                        int x = (mousePos.x - PADDING) / cellSize;
+                        int y = (mousePos.y - PADDING) / cellSize;
+                        if (x >= 0 && x < session->Size() && y >= 0 && y < session->Size() &&
+                            session->IsEmpty(x, y))
                         {
-                            board[y][x] = currentPlayer;
-                            moveHistory.push({x, y});
-                            PlaySound(placeSound);
-                            if (CheckWin(x, y))
+                            session->MakeMove(x, y, currentPlayer);
+                            boardDirty = true;
+                            AddToHistory({x, y});
+                            PlayEffect(placeSound);
+                            if (session->CheckWin(x, y))
                             {
                                 gameState = (currentPlayer == PIECE_BLACK) ? STATE_BLACK_WIN : STATE_WHITE_WIN;
+                                SaveGameRecord();
                                 if (gameMode == MODE_PVP || currentPlayer == PIECE_BLACK)
                                 {
-                                    PlaySound(winSound);
+                                    PlayEffect(winSound);
                                 }
                                 else
                                 {
-                                    PlaySound(aiWinSound);
+                                    PlayEffect(aiWinSound);
                                 }
                             }
                             else
                             {
                                 currentPlayer = (currentPlayer == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
                             }
+                            OnPlayerMove(x, y);
                         }
                     }
                 }
@@ -710,15 +1105,62 @@ private:
             DrawBoard();
             DrawGameUI();
         }
-        EndDrawing();
     }
 };
 
 // 主函数
-int main()
+// 可选参数:
+//   --hash <MB>      置换表大小,范围16~1024
+//   --movetime <ms>  困难模式AI每步的思考时间,0表示不限时
+//   --nodes <n>      困难模式AI每步的节点预算,0表示不限
+//   --threads <n>    困难模式和MCTS模式AI的搜索线程数
+//   --threat-nodes <n> 搜索前威胁空间搜索(VCF/VCT)的节点预算,0表示不做
+//   --threat-ms <ms>   威胁空间搜索的时间上限,0表示不限
+//   --leaf-vcf <n>     搜索树最后一层VCF的节点预算,0表示不做
+//   --book <file>    开局库文件,默认为book/opening.book,文件不存在或棋盘大小不同时不用开局库
+//   --weights <file> 棋型权重文件(由gomoku-tune生成),读取失败时警告并用默认权重
+//   --mcts-mb <MB>   MCTS模式的节点池大小,默认64
+//   --board-size <n> 启动时的棋盘大小,15或19,菜单中也可以切换
+//   --record <file>  对局记录文件,默认为games.gmr,每盘棋追加到文件末尾
+//   --no-record      不保存对局记录
+//   --stats              启动时显示统计面板(游戏中按F3切换)
+//   --search-log <file>  把困难模式每步搜索的统计写入文件,每行一个JSON对象
+//   --frame-log <file>   把每帧的用时写入CSV文件
+// 统计相关的选项只在打开统计的构建(调试构建或定义GOMOKU_STATS)中起作用
+int main(int argc, char *argv[])
 {
-    GomokuGame game;
+    AIConfig config;
+    config.bookPath = AI_DEFAULT_BOOK_PATH;
+    InstrumentConfig instrument;
+    int boardSize = BOARD_SIZE;
+    std::string recordPath = GAME_RECORD_PATH;
+    for (int i = 1; i < argc; i++)
+    {
+        if (ParseAIConfigArg(argc, argv, i, config))
+            continue;
+        if (strcmp(argv[i], "--stats") == 0)
+            instrument.overlay = true;
+        else if (strcmp(argv[i], "--search-log") == 0 && i + 1 < argc)
+            instrument.searchLog = argv[++i];
+        else if (strcmp(argv[i], "--frame-log") == 0 && i + 1 < argc)
+            instrument.frameLog = argv[++i];
+        else if (strcmp(argv[i], "--board-size") == 0 && i + 1 < argc)
+            boardSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (strcmp(argv[i], "--no-record") == 0)
+            recordPath.clear();
+    }
+    if (!IsSupportedBoardSize(boardSize))
+    {
+        std::cerr << "unsupported board size " << boardSize << ", using " << BOARD_SIZE << std::endl;
+        boardSize = BOARD_SIZE;
+    }
+    if (!STATS_ENABLED && (instrument.overlay || !instrument.searchLog.empty() || !instrument.frameLog.empty()))
+        std::cerr << "statistics are disabled in this build, define GOMOKU_STATS to enable them" << std::endl;
+
+    GomokuGame game(config, instrument, boardSize, recordPath);
     game.Run();
 
     return 0;
-}
\ No newline at end of file
+}
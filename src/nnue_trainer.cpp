@@ -0,0 +1,457 @@
+// 神经网络评估的训练工具:读取对局分析工具用 --dump 导出的样本,用浮点数训练与引擎相同结构的网络,
+// 再按引擎的量化方式写成网络文件;样本随机做8种对称变换,相当于把数据扩大8倍
+// 训练目标是轮到的一方的胜率:sigmoid(搜索分数/scale)与对局结果按lambda加权,损失为均方误差
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "engine/book.h"
+#include "engine/nnue.h"
+
+// 训练选项
+struct TrainConfig
+{
+    int boardSize = 15;
+    int epochs = 10;
+    int batchSize = 256;
+    double learningRate = 0.001;
+    double lambda = 0.7;   // 目标中搜索分数所占的比例
+    int scale = 600;       // 网络输出1.0对应的评估分数
+    unsigned seed = 1;
+    double validation = 0.1; // 留出验证的样本比例
+};
+
+// 一个样本:按顺序摆下的棋子(黑白交替)和轮到的一方视角的目标胜率
+struct Sample
+{
+    uint32_t offset; // 在棋子数组中的起点
+    uint16_t count;  // 棋子数,偶数时轮到黑方
+    float target;
+};
+
+struct SampleSet
+{
+    std::vector<uint16_t> stones; // y * N + x
+    std::vector<Sample> samples;
+};
+
+double Sigmoid(double x)
+{
+    return 1.0 / (1.0 + std::exp(-x));
+}
+
+// 读取样本文件,棋盘大小不同或者格式不对的行跳过
+bool LoadSamples(const std::string &path, const TrainConfig &config, SampleSet &set, long long &skipped)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream words(line);
+        int size, score;
+        double result;
+        if (!(words >> size >> result >> score) || size != config.boardSize)
+        {
+            skipped++;
+            continue;
+        }
+        Sample sample;
+        sample.offset = (uint32_t)set.stones.size();
+        std::string word;
+        bool ok = true;
+        int count = 0;
+        while (ok && words >> word)
+        {
+            int x, y;
+            ok = sscanf(word.c_str(), "%d,%d", &x, &y) == 2 && x >= 0 && x < size && y >= 0 && y < size;
+            if (ok)
+            {
+                set.stones.push_back((uint16_t)(y * size + x));
+                count++;
+            }
+        }
+        if (!ok || count >= size * size)
+        {
+            set.stones.resize(sample.offset);
+            skipped++;
+            continue;
+        }
+        sample.count = (uint16_t)count;
+        // 文件里是黑方视角,换成轮到的一方
+        bool whiteToMove = count % 2 == 1;
+        double scoreTarget = Sigmoid((whiteToMove ? -score : score) / (double)config.scale);
+        double resultTarget = whiteToMove ? 1.0 - result : result;
+        sample.target = (float)(config.lambda * scoreTarget + (1.0 - config.lambda) * resultTarget);
+        set.samples.push_back(sample);
+    }
+    return true;
+}
+
+// 浮点数网络,结构与NnueNetwork相同;累加器和全连接层的激活都截断到[0,1]
+template <int N>
+class FloatNetwork
+{
+public:
+    static const int FEATURES = 2 * N * N;
+    static const int INPUTS = 2 * NNUE_HIDDEN;
+
+    // 量化后的取值范围,训练时每一步之后把参数截到这个范围内
+    static constexpr float FEATURE_LIMIT = (float)NNUE_FEATURE_WEIGHT_LIMIT / NNUE_ACTIVATION_MAX;
+    static constexpr float DENSE_LIMIT = 127.0f / NNUE_WEIGHT_SCALE;
+
+    std::vector<float> params; // 所有参数连续存放,便于Adam统一更新
+    float *featureBias, *featureWeights, *denseBias, *denseWeights, *outputBias, *outputWeights;
+
+    FloatNetwork()
+    {
+        params.assign(Count(), 0.0f);
+        Bind(params.data(), featureBias, featureWeights, denseBias, denseWeights, outputBias, outputWeights);
+    }
+
+    static size_t Count()
+    {
+        return NNUE_HIDDEN + (size_t)FEATURES * NNUE_HIDDEN + NNUE_DENSE + (size_t)NNUE_DENSE * INPUTS + 1 + NNUE_DENSE;
+    }
+
+    // 按参数的排列方式给出各部分的起点,梯度数组也用同样的排列
+    static void Bind(float *base, float *&fb, float *&fw, float *&db, float *&dw, float *&ob, float *&ow)
+    {
+        fb = base;
+        fw = fb + NNUE_HIDDEN;
+        db = fw + (size_t)FEATURES * NNUE_HIDDEN;
+        dw = db + NNUE_DENSE;
+        ob = dw + (size_t)NNUE_DENSE * INPUTS;
+        ow = ob + 1;
+    }
+
+    void Initialize(std::mt19937 &rng)
+    {
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        for (int h = 0; h < NNUE_HIDDEN; h++)
+            featureBias[h] = 0.5f;
+        for (size_t i = 0; i < (size_t)FEATURES * NNUE_HIDDEN; i++)
+            featureWeights[i] = 0.05f * uniform(rng);
+        for (int o = 0; o < NNUE_DENSE; o++)
+            denseBias[o] = 0.25f;
+        for (size_t i = 0; i < (size_t)NNUE_DENSE * INPUTS; i++)
+            denseWeights[i] = uniform(rng) / std::sqrt((float)INPUTS);
+        *outputBias = 0.0f;
+        for (int o = 0; o < NNUE_DENSE; o++)
+            outputWeights[o] = uniform(rng) / std::sqrt((float)NNUE_DENSE);
+    }
+
+    // 轮到的一方是视角0的特征编号,对方是视角1;sym是对称变换
+    static void Features(const SampleSet &set, const Sample &sample, int sym, int perspective, std::vector<int> &features)
+    {
+        features.clear();
+        int mover = sample.count % 2; // 轮到的一方,0黑1白
+        for (int i = 0; i < sample.count; i++)
+        {
+            int move = set.stones[sample.offset + i];
+            int x, y;
+            TransformPoint<N>(sym, move % N, move / N, x, y);
+            int color = i % 2;
+            int side = (perspective == 0) ? mover : 1 - mover;
+            features.push_back((color == side ? 0 : N * N) + y * N + x);
+        }
+    }
+
+    // 前向计算一个样本,返回网络输出;记下反向传播需要的中间值
+    float Forward(const std::vector<int> (&features)[2], float *accumulators, float *hidden) const
+    {
+        for (int p = 0; p < 2; p++)
+        {
+            float *acc = accumulators + p * NNUE_HIDDEN;
+            for (int h = 0; h < NNUE_HIDDEN; h++)
+                acc[h] = featureBias[h];
+            for (int f : features[p])
+            {
+                const float *row = featureWeights + (size_t)f * NNUE_HIDDEN;
+                for (int h = 0; h < NNUE_HIDDEN; h++)
+                    acc[h] += row[h];
+            }
+        }
+        float output = *outputBias;
+        for (int o = 0; o < NNUE_DENSE; o++)
+        {
+            const float *weights = denseWeights + (size_t)o * INPUTS;
+            float sum = denseBias[o];
+            for (int k = 0; k < INPUTS; k++)
+                sum += std::min(std::max(accumulators[k], 0.0f), 1.0f) * weights[k];
+            hidden[o] = sum;
+            output += std::min(std::max(sum, 0.0f), 1.0f) * outputWeights[o];
+        }
+        return output;
+    }
+
+    // 反向传播,把损失对输出的导数dOutput累加到grad中
+    void Backward(const std::vector<int> (&features)[2], const float *accumulators, const float *hidden,
+                  float dOutput, std::vector<float> &grad) const
+    {
+        float *gfb, *gfw, *gdb, *gdw, *gob, *gow;
+        Bind(grad.data(), gfb, gfw, gdb, gdw, gob, gow);
+        float dInput[INPUTS] = {};
+        *gob += dOutput;
+        for (int o = 0; o < NNUE_DENSE; o++)
+        {
+            float h = hidden[o];
+            gow[o] += dOutput * std::min(std::max(h, 0.0f), 1.0f);
+            if (h <= 0.0f || h >= 1.0f)
+                continue;
+            float dHidden = dOutput * outputWeights[o];
+            gdb[o] += dHidden;
+            const float *weights = denseWeights + (size_t)o * INPUTS;
+            float *gw = gdw + (size_t)o * INPUTS;
+            for (int k = 0; k < INPUTS; k++)
+            {
+                float a = accumulators[k];
+                if (a <= 0.0f || a >= 1.0f)
+                    continue;
+                gw[k] += dHidden * a;
+                dInput[k] += dHidden * weights[k];
+            }
+        }
+        for (int p = 0; p < 2; p++)
+        {
+            const float *dAcc = dInput + p * NNUE_HIDDEN;
+            for (int h = 0; h < NNUE_HIDDEN; h++)
+                gfb[h] += dAcc[h];
+            for (int f : features[p])
+            {
+                float *row = gfw + (size_t)f * NNUE_HIDDEN;
+                for (int h = 0; h < NNUE_HIDDEN; h++)
+                    row[h] += dAcc[h];
+            }
+        }
+    }
+
+    void Clamp()
+    {
+        for (int h = 0; h < NNUE_HIDDEN; h++)
+            featureBias[h] = std::min(std::max(featureBias[h], -FEATURE_LIMIT), FEATURE_LIMIT);
+        for (size_t i = 0; i < (size_t)FEATURES * NNUE_HIDDEN; i++)
+            featureWeights[i] = std::min(std::max(featureWeights[i], -FEATURE_LIMIT), FEATURE_LIMIT);
+        for (size_t i = 0; i < (size_t)NNUE_DENSE * INPUTS; i++)
+            denseWeights[i] = std::min(std::max(denseWeights[i], -DENSE_LIMIT), DENSE_LIMIT);
+        for (int o = 0; o < NNUE_DENSE; o++)
+            outputWeights[o] = std::min(std::max(outputWeights[o], -DENSE_LIMIT), DENSE_LIMIT);
+    }
+
+    // 按引擎的量化方式转换:累加器的1.0为127,全连接层的权重乘64,偏置乘127*64
+    void Quantize(int scale, NnueNetwork &net) const
+    {
+        net.Allocate(N, scale);
+        const float activation = NNUE_ACTIVATION_MAX, weight = NNUE_WEIGHT_SCALE;
+        for (int h = 0; h < NNUE_HIDDEN; h++)
+            net.featureBias[h] = (int16_t)std::lround(featureBias[h] * activation);
+        for (size_t i = 0; i < (size_t)FEATURES * NNUE_HIDDEN; i++)
+            net.featureWeights[i] = (int16_t)std::lround(featureWeights[i] * activation);
+        for (int o = 0; o < NNUE_DENSE; o++)
+            net.denseBias[o] = (int32_t)std::lround(denseBias[o] * activation * weight);
+        for (size_t i = 0; i < (size_t)NNUE_DENSE * INPUTS; i++)
+            net.denseWeights[i] = (int8_t)std::lround(denseWeights[i] * weight);
+        net.outputBias = (int32_t)std::lround(*outputBias * activation * weight);
+        for (int o = 0; o < NNUE_DENSE; o++)
+            net.outputWeights[o] = (int8_t)std::lround(outputWeights[o] * weight);
+    }
+};
+
+// Adam优化器,所有参数一起更新
+struct Adam
+{
+    std::vector<float> m, v;
+    double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    long long step = 0;
+
+    explicit Adam(size_t count) : m(count, 0.0f), v(count, 0.0f) {}
+
+    void Update(std::vector<float> &params, const std::vector<float> &grad, double learningRate)
+    {
+        step++;
+        double correction1 = 1.0 - std::pow(beta1, (double)step);
+        double correction2 = 1.0 - std::pow(beta2, (double)step);
+        for (size_t i = 0; i < params.size(); i++)
+        {
+            if (grad[i] == 0.0f && m[i] == 0.0f)
+                continue;
+            m[i] = (float)(beta1 * m[i] + (1.0 - beta1) * grad[i]);
+            v[i] = (float)(beta2 * v[i] + (1.0 - beta2) * grad[i] * grad[i]);
+            params[i] -= (float)(learningRate * (m[i] / correction1) / (std::sqrt(v[i] / correction2) + epsilon));
+        }
+    }
+};
+
+// 验证集上浮点网络和量化网络(用引擎的累加器和推理)的损失,两者接近说明量化没有损失精度
+template <int N>
+void Validate(const FloatNetwork<N> &model, const NnueNetwork &net, const SampleSet &set,
+              const std::vector<size_t> &indices, int scale, double &floatLoss, double &quantizedLoss)
+{
+    floatLoss = quantizedLoss = 0;
+    std::vector<int> features[2];
+    float accumulators[2 * NNUE_HIDDEN], hidden[NNUE_DENSE];
+    for (size_t index : indices)
+    {
+        const Sample &sample = set.samples[index];
+        for (int p = 0; p < 2; p++)
+            FloatNetwork<N>::Features(set, sample, 0, p, features[p]);
+        double p = Sigmoid(model.Forward(features, accumulators, hidden));
+        floatLoss += (p - sample.target) * (p - sample.target);
+
+        BitBoardT<N> board;
+        board.Clear();
+        NnueAccumulatorT<N> accumulator;
+        accumulator.Reset(board, &net);
+        for (int i = 0; i < sample.count; i++)
+        {
+            int move = set.stones[sample.offset + i];
+            Piece piece = (i % 2 == 0) ? PIECE_BLACK : PIECE_WHITE;
+            board.Place(move % N, move / N, piece);
+            accumulator.OnPlace(move % N, move / N, piece);
+        }
+        Piece side = (sample.count % 2 == 0) ? PIECE_BLACK : PIECE_WHITE;
+        double q = Sigmoid(accumulator.Evaluate(side) / (double)scale);
+        quantizedLoss += (q - sample.target) * (q - sample.target);
+    }
+    if (!indices.empty())
+    {
+        floatLoss /= indices.size();
+        quantizedLoss /= indices.size();
+    }
+}
+
+template <int N>
+int Train(const TrainConfig &config, const SampleSet &set, const std::string &outPath)
+{
+    std::mt19937 rng(config.seed);
+    std::vector<size_t> order(set.samples.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    size_t validationCount = (size_t)(order.size() * config.validation);
+    std::vector<size_t> validation(order.begin(), order.begin() + validationCount);
+    std::vector<size_t> training(order.begin() + validationCount, order.end());
+    if (training.empty())
+    {
+        std::cerr << "no training samples" << std::endl;
+        return 1;
+    }
+
+    FloatNetwork<N> model;
+    model.Initialize(rng);
+    Adam adam(model.params.size());
+    std::vector<float> grad(model.params.size());
+    std::vector<int> features[2];
+    float accumulators[2 * NNUE_HIDDEN], hidden[NNUE_DENSE];
+    NnueNetwork net;
+    std::uniform_int_distribution<int> symmetry(0, 7);
+    for (int epoch = 1; epoch <= config.epochs; epoch++)
+    {
+        std::shuffle(training.begin(), training.end(), rng);
+        double loss = 0;
+        for (size_t begin = 0; begin < training.size(); begin += config.batchSize)
+        {
+            size_t end = std::min(begin + config.batchSize, training.size());
+            std::fill(grad.begin(), grad.end(), 0.0f);
+            for (size_t i = begin; i < end; i++)
+            {
+                const Sample &sample = set.samples[training[i]];
+                int sym = symmetry(rng);
+                for (int p = 0; p < 2; p++)
+                    FloatNetwork<N>::Features(set, sample, sym, p, features[p]);
+                double prediction = Sigmoid(model.Forward(features, accumulators, hidden));
+                double error = prediction - sample.target;
+                loss += error * error;
+                float dOutput = (float)(2.0 * error * prediction * (1.0 - prediction) / (end - begin));
+                model.Backward(features, accumulators, hidden, dOutput, grad);
+            }
+            adam.Update(model.params, grad, config.learningRate);
+            model.Clamp();
+        }
+        model.Quantize(config.scale, net);
+        double floatLoss, quantizedLoss;
+        Validate(model, net, set, validation, config.scale, floatLoss, quantizedLoss);
+        printf("epoch %d  train loss %.5f  validation loss %.5f  quantized %.5f\n", epoch, loss / training.size(),
+               floatLoss, quantizedLoss);
+        fflush(stdout);
+    }
+    if (!net.Save(outPath))
+    {
+        std::cerr << "cannot write " << outPath << std::endl;
+        return 1;
+    }
+    printf("%zu training samples, %zu validation samples -> %s\n", training.size(), validation.size(), outPath.c_str());
+    return 0;
+}
+
+// 主函数
+// 用法: gomoku-nnue-train [选项] <样本文件>...
+// 可选参数:
+//   --out <file>     网络文件(默认 nnue.bin)
+//   --size <n>       棋盘大小(默认15),其他大小的样本跳过
+//   --epochs <n>     训练轮数(默认10)
+//   --batch <n>      每批样本数(默认256)
+//   --lr <x>         学习率(默认0.001)
+//   --lambda <x>     目标中搜索分数所占的比例,其余为对局结果(默认0.7)
+//   --scale <n>      网络输出1.0对应的评估分数(默认600)
+//   --seed <n>       随机数种子(默认1)
+int main(int argc, char *argv[])
+{
+    TrainConfig config;
+    std::string outPath = "nnue.bin";
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            config.boardSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--epochs") == 0 && i + 1 < argc)
+            config.epochs = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            config.batchSize = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--lr") == 0 && i + 1 < argc)
+            config.learningRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--lambda") == 0 && i + 1 < argc)
+            config.lambda = std::min(std::max(atof(argv[++i]), 0.0), 1.0);
+        else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+            config.scale = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            config.seed = (unsigned)atoi(argv[++i]);
+        else if (argv[i][0] == '-')
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty() || !IsSupportedBoardSize(config.boardSize))
+    {
+        std::cerr << "usage: gomoku-nnue-train [--out <file>] [--size 15|19] [--epochs <n>] <samples>..." << std::endl;
+        return 1;
+    }
+
+    SampleSet set;
+    long long skipped = 0;
+    for (const std::string &path : paths)
+    {
+        if (!LoadSamples(path, config, set, skipped))
+        {
+            std::cerr << "cannot read " << path << std::endl;
+            return 1;
+        }
+    }
+    printf("%zu samples loaded, %lld skipped\n", set.samples.size(), skipped);
+    if (config.boardSize == 19)
+        return Train<19>(config, set, outPath);
+    return Train<15>(config, set, outPath);
+}
@@ -0,0 +1,383 @@
+// 无界面的AI程序,使用Gomocup(piskvork)的标准输入输出协议
+// 从标准输入逐行读取命令,向标准输出写回应答,坐标为从0开始的"x,y"
+// 支持的命令: START, RECTSTART, RESTART, BEGIN, TURN, BOARD ... DONE, TAKEBACK, INFO, ABOUT, END
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdio>
+#include "engine/search.h"
+
+// 一盘棋的协议状态
+class PbrainSession
+{
+public:
+    PbrainSession(const AIConfig &config)
+        : aiConfig(config), ownPiece(PIECE_BLACK), started(false),
+          timeoutTurnMs(AI_DEFAULT_MOVE_TIME_MS), timeLeftMs(-1), maxMemoryBytes(0),
+          hashMegabytes(config.hashMegabytes), mctsMegabytes(config.mctsMegabytes)
+    {
+        engine.Configure(aiConfig);
+        pos.Clear();
+    }
+
+    // 处理一行命令,收到END时返回false
+    bool HandleLine(std::string line)
+    {
+        while (!line.empty() && (line.back() == '\r' || line.back() == '\n' || line.back() == ' '))
+            line.pop_back();
+        if (line.empty())
+            return true;
+
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+        for (char &c : command)
+            c = (char)toupper((unsigned char)c);
+        std::string rest;
+        std::getline(in, rest);
+        while (!rest.empty() && rest[0] == ' ')
+            rest.erase(0, 1);
+
+        if (command == "START")
+        {
+            if (atoi(rest.c_str()) != BOARD_SIZE)
+            {
+                Reply("ERROR unsupported board size, only " + std::to_string(BOARD_SIZE) + " is supported");
+                return true;
+            }
+            NewGame();
+            Reply("OK");
+        }
+        else if (command == "RECTSTART")
+        {
+            int width = 0, height = 0;
+            if (sscanf(rest.c_str(), "%d,%d", &width, &height) != 2 ||
+                width != BOARD_SIZE || height != BOARD_SIZE)
+            {
+                Reply("ERROR unsupported board size, only " + std::to_string(BOARD_SIZE) + " is supported");
+                return true;
+            }
+            NewGame();
+            Reply("OK");
+        }
+        else if (command == "RESTART")
+        {
+            NewGame();
+            Reply("OK");
+        }
+        else if (!started && command != "INFO" && command != "ABOUT" && command != "END")
+        {
+            Reply("ERROR game not started");
+        }
+        else if (command == "BEGIN")
+        {
+            ownPiece = PIECE_BLACK;
+            PlayOwnMove();
+        }
+        else if (command == "TURN")
+        {
+            int x, y;
+            if (!ParseCoords(rest, x, y) || !pos.board.IsEmpty(x, y))
+            {
+                Reply("ERROR invalid move " + rest);
+                return true;
+            }
+            // 空棋盘上先收到对方的落子,说明我方执白
+            if (moves.empty())
+                ownPiece = PIECE_WHITE;
+            Play(x, y, Opponent());
+            PlayOwnMove();
+        }
+        else if (command == "BOARD")
+        {
+            if (ReadBoard())
+                PlayOwnMove();
+            else
+                Reply("ERROR invalid board");
+        }
+        else if (command == "TAKEBACK")
+        {
+            int x, y;
+            if (!ParseCoords(rest, x, y) || pos.board.IsEmpty(x, y))
+            {
+                Reply("ERROR invalid takeback " + rest);
+                return true;
+            }
+            Takeback(x, y);
+            Reply("OK");
+        }
+        else if (command == "INFO")
+        {
+            HandleInfo(rest);
+        }
+        else if (command == "ABOUT")
+        {
+            Reply("name=\"Gomoku_Game\", version=\"1.0\", author=\"KaiHaverz\"");
+        }
+        else if (command == "END")
+        {
+            return false;
+        }
+        else
+        {
+            Reply("UNKNOWN " + command);
+        }
+        return true;
+    }
+
+private:
+    AIConfig aiConfig;
+    SearchEngine engine;
+    Position pos;
+    std::vector<std::pair<int, int>> moves; // 已下的棋,按顺序
+    std::vector<Piece> movePieces;          // 对应每一步的棋子颜色
+    Piece ownPiece;                         // 我方棋子的颜色
+    bool started;
+    long long timeoutTurnMs;  // 每步的时间上限
+    long long timeLeftMs;     // 整局剩余时间,-1表示未知
+    long long maxMemoryBytes; // 内存上限,0表示不限
+    int hashMegabytes;        // 置换表最近一次请求的大小(MB),实际分配的会向下取到2的幂
+    int mctsMegabytes;        // 蒙特卡洛树搜索的节点池最近一次请求的大小(MB)
+
+    static void Reply(const std::string &text)
+    {
+        std::cout << text << std::endl;
+    }
+
+    Piece Opponent() const
+    {
+        return (ownPiece == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    }
+
+    static bool ParseCoords(const std::string &text, int &x, int &y)
+    {
+        if (sscanf(text.c_str(), "%d,%d", &x, &y) != 2)
+            return false;
+        return x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE;
+    }
+
+    void NewGame()
+    {
+        pos.Clear();
+        moves.clear();
+        movePieces.clear();
+        ownPiece = PIECE_BLACK;
+        engine.NewGame();
+        started = true;
+    }
+
+    void Play(int x, int y, Piece piece)
+    {
+        pos.MakeMove(x, y, piece);
+        moves.emplace_back(x, y);
+        movePieces.push_back(piece);
+    }
+
+    // 悔掉(x,y)的棋子:是最后一步时直接撤销,否则按剩余的棋谱重建局面
+    void Takeback(int x, int y)
+    {
+        if (moves.back() == std::make_pair(x, y))
+        {
+            pos.UnmakeMove(x, y);
+            moves.pop_back();
+            movePieces.pop_back();
+            return;
+        }
+        for (size_t i = 0; i < moves.size(); i++)
+        {
+            if (moves[i] == std::make_pair(x, y))
+            {
+                moves.erase(moves.begin() + i);
+                movePieces.erase(movePieces.begin() + i);
+                break;
+            }
+        }
+        pos.Clear();
+        for (size_t i = 0; i < moves.size(); i++)
+            pos.MakeMove(moves[i].first, moves[i].second, movePieces[i]);
+    }
+
+    // 读取BOARD命令后的局面,每行"x,y,field",field为1是我方,2是对方,3是连续对局中标出的对方胜线
+    // 同一格出现两次或者双方棋子数相差超过一个时返回false,棋盘留空
+    bool ReadBoard()
+    {
+        pos.Clear();
+        moves.clear();
+        movePieces.clear();
+        std::vector<std::pair<int, int>> own, other;
+        bool seen[BOARD_SIZE][BOARD_SIZE] = {};
+        bool valid = true;
+        std::string line;
+        while (std::getline(std::cin, line))
+        {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+                line.pop_back();
+            std::string upper = line;
+            for (char &c : upper)
+                c = (char)toupper((unsigned char)c);
+            if (upper == "DONE")
+                break;
+            int x, y, field;
+            if (sscanf(line.c_str(), "%d,%d,%d", &x, &y, &field) != 3 ||
+                x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE)
+                continue;
+            // 读到DONE之前不能返回,否则剩下的行会被当成命令
+            if (seen[y][x])
+                valid = false;
+            seen[y][x] = true;
+            if (field == 1)
+                own.emplace_back(x, y);
+            else
+                other.emplace_back(x, y);
+        }
+        if (!valid || own.size() > other.size() + 1 || other.size() > own.size() + 1)
+            return false;
+        // 轮到我方走,双方棋子数相同时我方执黑
+        ownPiece = (own.size() >= other.size()) ? PIECE_BLACK : PIECE_WHITE;
+        // 按黑白交替的顺序放入,保持与真实对局一致
+        size_t i = 0, j = 0;
+        const auto &blackStones = (ownPiece == PIECE_BLACK) ? own : other;
+        const auto &whiteStones = (ownPiece == PIECE_BLACK) ? other : own;
+        while (i < blackStones.size() || j < whiteStones.size())
+        {
+            if (i < blackStones.size())
+            {
+                Play(blackStones[i].first, blackStones[i].second, PIECE_BLACK);
+                i++;
+            }
+            if (j < whiteStones.size())
+            {
+                Play(whiteStones[j].first, whiteStones[j].second, PIECE_WHITE);
+                j++;
+            }
+        }
+        return true;
+    }
+
+    void HandleInfo(const std::string &text)
+    {
+        std::istringstream in(text);
+        std::string key;
+        long long value = 0;
+        in >> key >> value;
+        if (key == "timeout_turn")
+        {
+            timeoutTurnMs = value;
+        }
+        else if (key == "time_left")
+        {
+            timeLeftMs = value;
+        }
+        else if (key == "max_memory")
+        {
+            maxMemoryBytes = value;
+            // 置换表(蒙特卡洛树搜索时加上节点池)最多用掉上限的一半,其余留给程序本身
+            int megabytes = aiConfig.hashMegabytes;
+            int poolMegabytes = aiConfig.mctsMegabytes;
+            if (maxMemoryBytes > 0)
+            {
+                long long limit = std::max(1LL, maxMemoryBytes / 2 / (1024 * 1024));
+                if (aiConfig.engine != AI_ENGINE_MCTS)
+                    megabytes = (int)std::min((long long)megabytes, limit);
+                else if (megabytes + poolMegabytes > limit)
+                {
+                    // 超出时两者按原来的比例缩小,节点池不小于MCTS_MIN_MB
+                    long long total = megabytes + poolMegabytes;
+                    poolMegabytes = (int)std::max((long long)MCTS_MIN_MB, poolMegabytes * limit / total);
+                    megabytes = (int)std::max(1LL, std::min(megabytes * limit / total, limit - poolMegabytes));
+                }
+            }
+            // 管理程序在对局中也会发这条INFO,大小不变时不重新配置,以免清空置换表
+            if (megabytes != hashMegabytes || poolMegabytes != mctsMegabytes)
+            {
+                hashMegabytes = megabytes;
+                mctsMegabytes = poolMegabytes;
+                AIConfig config = aiConfig;
+                config.hashMegabytes = megabytes;
+                config.mctsMegabytes = poolMegabytes;
+                engine.Configure(config);
+            }
+        }
+        // timeout_match, game_type, rule, folder等不影响搜索,忽略
+    }
+
+    bool FirstEmpty(int &x, int &y) const
+    {
+        for (y = 0; y < BOARD_SIZE; y++)
+        {
+            for (x = 0; x < BOARD_SIZE; x++)
+            {
+                if (pos.board.IsEmpty(x, y))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    // 根据每步上限和整局剩余时间计算这一步的时间预算,留出余量保证不超时
+    int MoveBudgetMs() const
+    {
+        long long budget = (timeoutTurnMs > 0) ? timeoutTurnMs : 10;
+        if (timeLeftMs >= 0)
+            budget = std::min(budget, timeLeftMs / 10);
+        budget -= std::max(30LL, budget / 20);
+        return (int)std::max(budget, 5LL);
+    }
+
+    void PlayOwnMove()
+    {
+        engine.SetLimits(MoveBudgetMs(), aiConfig.moveNodes);
+        SearchResult result = engine.Think(pos, ownPiece);
+        int x = result.bestMove.first, y = result.bestMove.second;
+        // 搜索没有给出合法的走法(例如棋盘已满)时改下第一个空位,没有空位就报错
+        if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE || !pos.board.IsEmpty(x, y))
+        {
+            if (!FirstEmpty(x, y))
+            {
+                Reply("ERROR no empty cell");
+                return;
+            }
+            Reply("MESSAGE search returned no legal move, playing the first empty cell");
+        }
+        Play(x, y, ownPiece);
+        if (result.bookMove)
+            Reply("MESSAGE book move");
+        else if (result.threat.found)
+            Reply("MESSAGE threat win in " + std::to_string(result.threat.depth + 1) + " nodes " +
+                  std::to_string(result.threat.nodes) + " time " + std::to_string((int)result.timeMs) + "ms");
+        else
+            Reply("MESSAGE depth " + std::to_string(result.depth) + " score " + std::to_string(result.score) +
+                  " nodes " + std::to_string(result.nodes) + " time " + std::to_string((int)result.timeMs) + "ms");
+        Reply(std::to_string(x) + "," + std::to_string(y));
+    }
+};
+
+// 主函数,可选参数与图形界面相同: --hash <MB>, --threads <n>, --nodes <n>, --threat-nodes <n>, --threat-ms <ms>, --leaf-vcf <n>,
+// --book <file>(默认也是book/opening.book,相对于当前目录), --nnue <file>, --weights <file>, --mcts-mb <MB>;
+// --engine mcts 改用蒙特卡洛树搜索
+// 每步时间由协议的INFO timeout_turn和time_left决定
+int main(int argc, char *argv[])
+{
+    AIConfig config;
+    config.bookPath = AI_DEFAULT_BOOK_PATH;
+    for (int i = 1; i < argc; i++)
+        ParseAIConfigArg(argc, argv, i, config);
+    std::string error;
+    if (!CheckAIConfigFiles(config, BOARD_SIZE, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    std::ios::sync_with_stdio(false);
+    PbrainSession session(config);
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        if (!session.HandleLine(line))
+            break;
+    }
+    return 0;
+}
@@ -0,0 +1,942 @@
+// 对局会话服务器:没有界面,同时托管成千上万盘互相独立的对局,通过标准输入输出的行协议使用
+// 每个会话只保存压缩的棋盘和落子记录;AI走棋的请求先按客户端公平排队,再交给共享的工作窃取线程池,
+// 每个工作线程持有单线程的搜索引擎,执行请求时从落子记录重新摆出局面,所以引擎的数量与会话数无关
+// 加 --load 时不读标准输入,在进程内模拟大量会话连续请求AI走棋,报告每步延迟的分位数
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "engine/search.h"
+
+const int SERVER_DEFAULT_BUDGET_MS = 100; // go 没有给出预算时每步的时间
+const int SERVER_MAX_BUDGET_MS = 600000;  // go 的预算上限(10分钟),更大的直接拒绝
+const int SERVER_MIN_SEARCH_MS = 5;       // 排队已经用掉预算时,至少还搜索这么久
+const int SERVER_TIME_MARGIN_MS = 2;      // 搜索时间留出的余量(至少这么多,预算大时留剩余时间的1/20),抵消搜索超时和回复的开销
+const int SERVER_FAIR_QUANTUM_MS = 100;   // 公平队列每一轮给每个客户端的额度(毫秒预算)
+const int SERVER_MAX_CLIENTS = 65536;     // 客户端编号的上限(不含),协议里超出的编号直接拒绝
+const int SERVER_INJECT_BATCH = 2;        // 工作线程一次从公平队列取出的请求数,多取的放进自己的队列供其他线程窃取
+
+using Clock = std::chrono::steady_clock;
+
+double MillisecondsBetween(Clock::time_point from, Clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// 压缩的棋盘:每格2位,19路棋盘也只要91字节;只用来检查落子和判断胜负,搜索时另外摆出位棋盘
+struct CompactBoard
+{
+    uint8_t cells[(MAX_BOARD_SIZE * MAX_BOARD_SIZE + 3) / 4] = {};
+    uint8_t size = BOARD_SIZE;
+
+    Piece At(int x, int y) const
+    {
+        int i = y * size + x;
+        return (Piece)((cells[i >> 2] >> ((i & 3) * 2)) & 3);
+    }
+
+    void Set(int x, int y, Piece piece)
+    {
+        int i = y * size + x;
+        cells[i >> 2] = (uint8_t)((cells[i >> 2] & ~(3 << ((i & 3) * 2))) | (piece << ((i & 3) * 2)));
+    }
+
+    bool Inside(int x, int y) const
+    {
+        return x >= 0 && x < size && y >= 0 && y < size;
+    }
+
+    // 按行找第一个空位,棋盘已满时返回false
+    bool FirstEmpty(int &x, int &y) const
+    {
+        for (y = 0; y < size; y++)
+        {
+            for (x = 0; x < size; x++)
+            {
+                if (At(x, y) == PIECE_EMPTY)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    // (x,y)上的棋子是否连成五子,沿四个方向向两侧数同色棋子
+    bool HasFive(int x, int y) const
+    {
+        Piece piece = At(x, y);
+        const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+        for (const auto &dir : dirs)
+        {
+            int count = 1;
+            for (int sign = -1; sign <= 1; sign += 2)
+            {
+                int nx = x + sign * dir[0], ny = y + sign * dir[1];
+                while (Inside(nx, ny) && At(nx, ny) == piece)
+                {
+                    count++;
+                    nx += sign * dir[0];
+                    ny += sign * dir[1];
+                }
+            }
+            if (count >= 5)
+                return true;
+        }
+        return false;
+    }
+};
+
+// 一盘对局,落子记录中每步是 y * size + x,黑方先走
+struct Session
+{
+    uint32_t client = 0;
+    CompactBoard board;
+    std::vector<uint16_t> moveHistory;
+    Piece winner = PIECE_EMPTY;
+    bool busy = false;   // 有AI走棋的请求在排队或者正在搜索
+    bool closed = false; // 搜索期间被关闭,结果丢弃后再释放
+
+    Piece ToMove() const { return (moveHistory.size() % 2 == 0) ? PIECE_BLACK : PIECE_WHITE; }
+    bool Finished() const { return winner != PIECE_EMPTY || (int)moveHistory.size() == board.size * board.size; }
+};
+
+// 一个AI走棋请求
+struct MoveRequest
+{
+    uint32_t session = 0;
+    uint32_t client = 0;
+    int budgetMs = SERVER_DEFAULT_BUDGET_MS; // 从提交到给出走法的时间预算,包括排队的时间
+    Clock::time_point submitted;
+};
+
+// 请求的结果
+struct MoveReply
+{
+    uint32_t session = 0;
+    uint32_t client = 0;
+    std::pair<int, int> move = {-1, -1}; // 会话在搜索期间被关闭或者没有可走的空位时为(-1,-1)
+    std::string error;                   // 没有可走的空位时的原因
+    Piece winner = PIECE_EMPTY;
+    bool finished = false;               // 这一步之后对局结束
+    double waitMs = 0;                   // 排队的时间
+    double latencyMs = 0;                // 从提交到给出走法的时间
+};
+
+// 按客户端的公平队列(差额轮转):客户端轮流出队,每轮各得SERVER_FAIR_QUANTUM_MS的额度,
+// 请求按时间预算扣额度,请求很多或者预算很大的客户端不会挤占其他客户端;不加锁,由调用者保护
+// 预算不超过SERVER_MAX_BUDGET_MS,一个请求最多等SERVER_MAX_BUDGET_MS/SERVER_FAIR_QUANTUM_MS轮
+class FairQueue
+{
+public:
+    void Push(const MoveRequest &request)
+    {
+        ClientQueue &queue = clients[request.client];
+        if (queue.items.empty())
+            active.push_back(request.client);
+        queue.items.push_back(request);
+        size++;
+    }
+
+    bool Pop(MoveRequest &request)
+    {
+        while (!active.empty())
+        {
+            uint32_t client = active.front();
+            ClientQueue &queue = clients[client];
+            if (!queue.charged)
+            {
+                queue.deficit += SERVER_FAIR_QUANTUM_MS;
+                queue.charged = true;
+            }
+            if (queue.items.front().budgetMs <= queue.deficit)
+            {
+                request = queue.items.front();
+                queue.items.pop_front();
+                queue.deficit -= request.budgetMs;
+                size--;
+                if (queue.items.empty())
+                {
+                    // 队列空了就退出这一轮,额度不保留
+                    clients.erase(client);
+                    active.pop_front();
+                }
+                return true;
+            }
+            // 额度不够,留到下一轮
+            queue.charged = false;
+            active.pop_front();
+            active.push_back(client);
+        }
+        return false;
+    }
+
+    size_t Size() const { return size; }
+
+private:
+    struct ClientQueue
+    {
+        std::deque<MoveRequest> items;
+        long long deficit = 0;
+        bool charged = false; // 这一轮已经加过额度
+    };
+    std::unordered_map<uint32_t, ClientQueue> clients;
+    std::deque<uint32_t> active; // 有请求的客户端,按轮转顺序
+    size_t size = 0;
+};
+
+// 工作窃取线程池:请求先进公平队列,空闲的工作线程依次从自己的队列头部,其他线程队列的尾部,公平队列取请求
+// 每个线程自己的队列很短,只起均衡作用,请求的先后基本由公平队列决定
+class WorkStealingPool
+{
+public:
+    using Handler = std::function<void(int worker, const MoveRequest &request)>;
+
+    WorkStealingPool(int workers, Handler handler) : locals(workers), execute(std::move(handler))
+    {
+        for (int i = 0; i < workers; i++)
+            threads.emplace_back([this, i]()
+                                 { WorkerLoop(i); });
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(injectMutex);
+            stopping = true;
+            wake.notify_all();
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    void Submit(const MoveRequest &request)
+    {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        fair.Push(request);
+        wake.notify_one();
+    }
+
+    size_t Queued()
+    {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        return fair.Size() + (size_t)localCount.load();
+    }
+
+    long long Steals() const { return steals.load(); }
+
+private:
+    struct LocalQueue
+    {
+        std::mutex mutex;
+        std::deque<MoveRequest> items;
+    };
+
+    std::vector<LocalQueue> locals;
+    std::vector<std::thread> threads;
+    Handler execute;
+    std::mutex injectMutex; // 保护公平队列和stopping
+    std::condition_variable wake;
+    FairQueue fair;
+    std::atomic<int> localCount{0}; // 所有线程自己的队列中的请求数,在injectMutex下增加,等待时一并检查
+    std::atomic<long long> steals{0};
+    bool stopping = false;
+
+    bool PopLocal(int id, MoveRequest &request)
+    {
+        LocalQueue &local = locals[id];
+        std::lock_guard<std::mutex> lock(local.mutex);
+        if (local.items.empty())
+            return false;
+        request = local.items.front();
+        local.items.pop_front();
+        localCount--;
+        return true;
+    }
+
+    bool Steal(int id, MoveRequest &request)
+    {
+        int count = (int)locals.size();
+        for (int k = 1; k < count; k++)
+        {
+            LocalQueue &victim = locals[(id + k) % count];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.items.empty())
+                continue;
+            request = victim.items.back();
+            victim.items.pop_back();
+            localCount--;
+            steals++;
+            return true;
+        }
+        return false;
+    }
+
+    bool Next(int id, MoveRequest &request)
+    {
+        while (true)
+        {
+            if (PopLocal(id, request) || Steal(id, request))
+                return true;
+            std::unique_lock<std::mutex> lock(injectMutex);
+            if (fair.Pop(request))
+            {
+                MoveRequest extra;
+                for (int k = 1; k < SERVER_INJECT_BATCH && fair.Pop(extra); k++)
+                {
+                    std::lock_guard<std::mutex> localLock(locals[id].mutex);
+                    locals[id].items.push_back(extra);
+                    localCount++;
+                    wake.notify_one();
+                }
+                return true;
+            }
+            if (stopping)
+                return false;
+            wake.wait(lock, [this]()
+                      { return stopping || fair.Size() > 0 || localCount.load() > 0; });
+        }
+    }
+
+    void WorkerLoop(int id)
+    {
+        MoveRequest request;
+        while (Next(id, request))
+            execute(id, request);
+    }
+};
+
+// 延迟记录,取分位数时排序一份副本
+class LatencyLog
+{
+public:
+    void Add(const MoveReply &reply)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        latency.push_back((float)reply.latencyMs);
+        wait.push_back((float)reply.waitMs);
+        perClient[reply.client]++;
+    }
+
+    // 形如 "moves 2000  latency p50 12.1 p90 ... ms  wait p50 ... ms"
+    std::string Summary()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "moves %zu  latency p50 %.1f p90 %.1f p99 %.1f max %.1f ms  queue wait p50 %.1f p99 %.1f ms",
+                 latency.size(), Percentile(latency, 0.5), Percentile(latency, 0.9), Percentile(latency, 0.99),
+                 Percentile(latency, 1.0), Percentile(wait, 0.5), Percentile(wait, 0.99));
+        return buffer;
+    }
+
+    std::map<uint32_t, long long> PerClient()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return perClient;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<float> latency;
+    std::vector<float> wait;
+    std::map<uint32_t, long long> perClient;
+
+    static double Percentile(std::vector<float> values, double fraction)
+    {
+        if (values.empty())
+            return 0;
+        size_t index = std::min((size_t)(fraction * values.size()), values.size() - 1);
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+};
+
+// 每个工作线程的搜索引擎;默认棋盘大小的在启动时创建,另一种在第一次用到时创建
+struct WorkerEngines
+{
+    std::unique_ptr<SearchEngineT<15>> engine15;
+    std::unique_ptr<SearchEngineT<19>> engine19;
+};
+
+template <int N>
+void CreateEngine(std::unique_ptr<SearchEngineT<N>> &engine, const AIConfig &config)
+{
+    engine.reset(new SearchEngineT<N>());
+    // 启动时已经检查过文件,这里只会是网络的棋盘大小不同,改用棋型评估
+    if (!engine->Configure(config))
+        std::cerr << "warning: " << engine->ConfigError() << std::endl;
+}
+
+// 从落子记录摆出局面,搜索轮到的一方的走法;创建引擎和摆局面的时间也算在deadline之内
+template <int N>
+std::pair<int, int> SearchMove(std::unique_ptr<SearchEngineT<N>> &engine, const AIConfig &config,
+                               const std::vector<uint16_t> &moves, Clock::time_point deadline)
+{
+    if (!engine)
+        CreateEngine(engine, config);
+    PositionT<N> pos;
+    pos.Clear();
+    Piece side = PIECE_BLACK;
+    for (uint16_t move : moves)
+    {
+        pos.MakeMove(move % N, move / N, side);
+        side = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    }
+    int remainingMs = (int)MillisecondsBetween(Clock::now(), deadline);
+    int searchMs = std::max(remainingMs - std::max(SERVER_TIME_MARGIN_MS, remainingMs / 20), SERVER_MIN_SEARCH_MS);
+    engine->SetLimits(searchMs, 0);
+    return engine->Think(pos, side).bestMove;
+}
+
+// 会话服务器:会话表,公平队列和线程池;会话表由一把锁保护,搜索时不持有它
+class SessionServer
+{
+public:
+    using ReplyHandler = std::function<void(const MoveReply &reply)>;
+
+    SessionServer(const AIConfig &config, int workers, ReplyHandler handler)
+        : aiConfig(config), engines(workers), onReply(std::move(handler))
+    {
+        aiConfig.threads = 1;
+        // 分配置换表要十几毫秒,放在启动时做,免得每个工作线程的第一个请求超出预算
+        for (WorkerEngines &worker : engines)
+        {
+            if (BOARD_SIZE == 19)
+                CreateEngine(worker.engine19, aiConfig);
+            else
+                CreateEngine(worker.engine15, aiConfig);
+        }
+        pool.reset(new WorkStealingPool(workers, [this](int worker, const MoveRequest &request)
+                                        { Execute(worker, request); }));
+    }
+
+    // 先停线程池,正在进行的搜索结束后才释放会话和引擎
+    ~SessionServer() { pool.reset(); }
+
+    // 新的一盘,返回会话编号;棋盘大小不支持或者客户端编号越界时返回false
+    bool NewSession(int size, long long client, uint32_t &id, std::string &error)
+    {
+        if (!IsSupportedBoardSize(size))
+        {
+            error = "unsupported board size";
+            return false;
+        }
+        if (client < 0 || client >= SERVER_MAX_CLIENTS)
+        {
+            error = "client out of range";
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        id = (uint32_t)sessions.size();
+        sessions.emplace_back(new Session());
+        sessions[id]->client = (uint32_t)client;
+        sessions[id]->board.size = (uint8_t)size;
+        openSessions++;
+        return true;
+    }
+
+    // 轮到的一方(由玩家)在(x,y)落子
+    bool Play(uint32_t id, int x, int y, Piece &winner, std::string &error)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Session *session = Find(id, error);
+        if (!session)
+            return false;
+        if (session->busy || session->Finished())
+        {
+            error = session->busy ? "busy" : "game over";
+            return false;
+        }
+        if (!session->board.Inside(x, y) || session->board.At(x, y) != PIECE_EMPTY)
+        {
+            error = "illegal move";
+            return false;
+        }
+        Apply(*session, x, y);
+        winner = session->winner;
+        return true;
+    }
+
+    // 撤销最后一步
+    bool Undo(uint32_t id, std::string &error)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Session *session = Find(id, error);
+        if (!session)
+            return false;
+        if (session->busy || session->moveHistory.empty())
+        {
+            error = session->busy ? "busy" : "no moves";
+            return false;
+        }
+        uint16_t last = session->moveHistory.back();
+        session->moveHistory.pop_back();
+        session->board.Set(last % session->board.size, last / session->board.size, PIECE_EMPTY);
+        session->winner = PIECE_EMPTY;
+        return true;
+    }
+
+    // 请求AI替轮到的一方走一步,结果通过onReply异步给出;每个会话同时只能有一个请求
+    // 预算小于1毫秒时按1毫秒,超过SERVER_MAX_BUDGET_MS时拒绝
+    bool RequestMove(uint32_t id, int budgetMs, std::string &error)
+    {
+        if (budgetMs > SERVER_MAX_BUDGET_MS)
+        {
+            error = "budget out of range";
+            return false;
+        }
+        MoveRequest request;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Session *session = Find(id, error);
+            if (!session)
+                return false;
+            if (session->busy || session->Finished())
+            {
+                error = session->busy ? "busy" : "game over";
+                return false;
+            }
+            session->busy = true;
+            request.session = id;
+            request.client = session->client;
+        }
+        request.budgetMs = std::max(budgetMs, 1);
+        request.submitted = Clock::now();
+        pending++;
+        pool->Submit(request);
+        return true;
+    }
+
+    bool Close(uint32_t id, std::string &error)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Session *session = Find(id, error);
+        if (!session)
+            return false;
+        openSessions--;
+        if (session->busy)
+            session->closed = true;
+        else
+            sessions[id].reset();
+        return true;
+    }
+
+    // 会话的落子记录,写作 x,y
+    bool Moves(uint32_t id, std::string &text, std::string &error)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Session *session = Find(id, error);
+        if (!session)
+            return false;
+        text.clear();
+        for (uint16_t move : session->moveHistory)
+            text += (text.empty() ? "" : " ") + std::to_string(move % session->board.size) + "," +
+                    std::to_string(move / session->board.size);
+        return true;
+    }
+
+    // 等待所有请求完成
+    void Drain()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        drained.wait(lock, [this]()
+                     { return pending.load() == 0; });
+    }
+
+    // 会话数,排队的请求数,未完成的请求数(包括排队的),窃取次数和延迟分位数
+    std::string Stats()
+    {
+        size_t open;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            open = openSessions;
+        }
+        char buffer[128];
+        snprintf(buffer, sizeof(buffer), "sessions %zu  queued %zu  pending %lld  steals %lld  ", open,
+                 pool->Queued(), pending.load(), pool->Steals());
+        return buffer + latency.Summary();
+    }
+
+    LatencyLog &Latency() { return latency; }
+
+private:
+    AIConfig aiConfig;
+    std::vector<WorkerEngines> engines;
+    ReplyHandler onReply;
+    std::mutex mutex; // 保护sessions及其内容
+    std::condition_variable drained;
+    std::vector<std::unique_ptr<Session>> sessions;
+    size_t openSessions = 0;
+    std::atomic<long long> pending{0};
+    LatencyLog latency;
+    std::unique_ptr<WorkStealingPool> pool;
+
+    Session *Find(uint32_t id, std::string &error)
+    {
+        if (id >= sessions.size() || !sessions[id] || sessions[id]->closed)
+        {
+            error = "no such session";
+            return nullptr;
+        }
+        return sessions[id].get();
+    }
+
+    static void Apply(Session &session, int x, int y)
+    {
+        Piece piece = session.ToMove();
+        session.board.Set(x, y, piece);
+        session.moveHistory.push_back((uint16_t)(y * session.board.size + x));
+        if (session.board.HasFive(x, y))
+            session.winner = piece;
+    }
+
+    // 工作线程执行一个请求:复制落子记录后放开锁搜索,再回来落子
+    // 预算包括排队的时间,排队越久搜索越短,过载时延迟不会无限增长
+    void Execute(int worker, const MoveRequest &request)
+    {
+        Clock::time_point start = Clock::now();
+        MoveReply reply;
+        reply.session = request.session;
+        reply.client = request.client;
+        reply.waitMs = MillisecondsBetween(request.submitted, start);
+        int size;
+        bool closed;
+        std::vector<uint16_t> moves;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const Session &session = *sessions[request.session];
+            size = session.board.size;
+            closed = session.closed;
+            moves = session.moveHistory;
+        }
+        std::pair<int, int> move = {-1, -1};
+        if (!closed)
+        {
+            Clock::time_point deadline = request.submitted + std::chrono::milliseconds(request.budgetMs);
+            move = (size == 19) ? SearchMove(engines[worker].engine19, aiConfig, moves, deadline)
+                                : SearchMove(engines[worker].engine15, aiConfig, moves, deadline);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Session &session = *sessions[request.session];
+            session.busy = false;
+            if (session.closed)
+                sessions[request.session].reset();
+            else
+            {
+                // 搜索没有给出合法的走法时改下第一个空位,与gomoku-pbrain相同
+                if (!session.board.Inside(move.first, move.second) ||
+                    session.board.At(move.first, move.second) != PIECE_EMPTY)
+                {
+                    std::cerr << "warning: search returned no legal move in session " << request.session
+                              << ", playing the first empty cell" << std::endl;
+                    if (!session.board.FirstEmpty(move.first, move.second))
+                        move = {-1, -1};
+                }
+                if (move.first < 0)
+                    reply.error = "no empty cell in session " + std::to_string(request.session);
+                else
+                    Apply(session, move.first, move.second);
+                reply.move = move;
+                reply.winner = session.winner;
+                reply.finished = session.Finished();
+            }
+        }
+        reply.latencyMs = MillisecondsBetween(request.submitted, Clock::now());
+        if (reply.move.first >= 0)
+            latency.Add(reply);
+        onReply(reply);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0)
+            drained.notify_all();
+    }
+};
+
+// 模拟负载的选项
+struct LoadConfig
+{
+    int sessions = 0;       // 会话数,0表示不模拟,读取标准输入
+    int plies = 10;         // 每个会话请求AI走的步数
+    int budgetMs = 50;      // 每个请求的时间预算
+    int clients = 4;        // 会话平均分给这么多个客户端
+    int thinkMs = 0;        // 拿到走法之后隔多久再请求下一步,模拟玩家思考
+    int size = BOARD_SIZE;  // 棋盘大小
+    unsigned seed = 1;      // 第一步的随机种子
+};
+
+// 模拟负载:每个会话黑方先在天元附近随机下一步,之后双方都请求AI走,直到走满plies步或者分出胜负
+// 请求都由主线程按计划的时刻提交,工作线程完成一步后只登记下一次请求的时刻
+int RunLoad(const AIConfig &config, int workers, const LoadConfig &load)
+{
+    std::mutex loadMutex;
+    std::condition_variable changed;
+    std::vector<int> plies(load.sessions, 0);
+    int finished = 0;
+    using Scheduled = std::pair<Clock::time_point, uint32_t>;
+    std::priority_queue<Scheduled, std::vector<Scheduled>, std::greater<Scheduled>> schedule;
+
+    SessionServer server(config, workers, [&](const MoveReply &reply)
+                         {
+                             std::lock_guard<std::mutex> lock(loadMutex);
+                             if (++plies[reply.session] >= load.plies || reply.finished || reply.move.first < 0)
+                                 finished++;
+                             else
+                                 schedule.push({Clock::now() + std::chrono::milliseconds(load.thinkMs), reply.session});
+                             changed.notify_one();
+                         });
+
+    printf("%d sessions (%d clients), %d workers, %d plies each, budget %d ms, think %d ms\n", load.sessions,
+           load.clients, workers, load.plies, load.budgetMs, load.thinkMs);
+    std::mt19937 rng(load.seed);
+    std::uniform_int_distribution<int> offset(-2, 2);
+    std::string error;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < load.sessions; i++)
+    {
+        uint32_t id = 0;
+        Piece winner;
+        server.NewSession(load.size, i % load.clients, id, error);
+        server.Play(id, load.size / 2 + offset(rng), load.size / 2 + offset(rng), winner, error);
+        schedule.push({start, id});
+    }
+
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(loadMutex);
+        if (finished == load.sessions)
+            break;
+        if (schedule.empty())
+        {
+            changed.wait(lock);
+            continue;
+        }
+        Clock::time_point due = schedule.top().first;
+        if (due > Clock::now())
+        {
+            changed.wait_until(lock, due);
+            continue;
+        }
+        uint32_t id = schedule.top().second;
+        schedule.pop();
+        lock.unlock();
+        if (!server.RequestMove(id, load.budgetMs, error))
+        {
+            std::cerr << "session " << id << ": " << error << std::endl;
+            return 1;
+        }
+    }
+    server.Drain();
+    double seconds = MillisecondsBetween(start, Clock::now()) / 1000;
+
+    long long moves = 0;
+    std::map<uint32_t, long long> perClient = server.Latency().PerClient();
+    for (const auto &client : perClient)
+        moves += client.second;
+    printf("%lld moves in %.1f s, %.1f moves/s\n", moves, seconds, moves / seconds);
+    printf("%s\n", server.Stats().c_str());
+    for (const auto &client : perClient)
+        printf("client %u: %lld moves\n", client.first, client.second);
+    printf("session state %zu bytes + %zu bytes per move\n", sizeof(Session), sizeof(uint16_t));
+    return 0;
+}
+
+// 读取一条命令中的会话编号
+bool ReadSessionId(std::istringstream &in, uint32_t &id)
+{
+    long long value;
+    if (!(in >> value) || value < 0)
+        return false;
+    id = (uint32_t)value;
+    return true;
+}
+
+// 标准输入输出的行协议,每行一条命令:
+//   new [size] [client]    新的一盘(默认15路,客户端0)       -> session <id>
+//   play <id> <x> <y>      轮到的一方落子                     -> ok | win <id> black|white
+//   go <id> [budget_ms]    请求AI替轮到的一方走一步,完成时输出 -> move <id> <x> <y> <latency_ms> [win black|white]
+//                          预算最多600000毫秒,例如 go 0 2147483647 -> error budget out of range
+//   undo <id>              撤销最后一步                       -> ok
+//   moves <id>             落子记录                           -> moves <id> x,y x,y ...
+//   close <id>             结束会话                           -> ok
+//   stats                  会话数,排队数和延迟分位数          -> stats ...
+//   quit                   等所有请求完成后输出 stats 并退出
+// 出错时输出 error <原因>;go 的结果由工作线程输出,与其他回复的顺序不固定
+int RunProtocol(const AIConfig &config, int workers)
+{
+    std::mutex outputMutex;
+    auto reply = [&outputMutex](const std::string &line)
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        fputs(line.c_str(), stdout);
+        fputc('\n', stdout);
+        fflush(stdout);
+    };
+    auto winnerName = [](Piece winner)
+    {
+        return (winner == PIECE_BLACK) ? "black" : "white";
+    };
+    SessionServer server(config, workers, [&](const MoveReply &done)
+                         {
+                             if (done.move.first < 0)
+                             {
+                                 if (!done.error.empty())
+                                     reply("error " + done.error);
+                                 return;
+                             }
+                             char line[128];
+                             int length = snprintf(line, sizeof(line), "move %u %d %d %.1f", done.session,
+                                                   done.move.first, done.move.second, done.latencyMs);
+                             if (done.winner != PIECE_EMPTY)
+                                 snprintf(line + length, sizeof(line) - length, " win %s", winnerName(done.winner));
+                             reply(line);
+                         });
+
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        std::istringstream in(line);
+        std::string command, error;
+        uint32_t id = 0;
+        if (!(in >> command))
+            continue;
+        if (command == "new")
+        {
+            int size = BOARD_SIZE;
+            long long client = 0;
+            in >> size >> client;
+            if (server.NewSession(size, client, id, error))
+                reply("session " + std::to_string(id));
+            else
+                reply("error " + error);
+        }
+        else if (command == "play")
+        {
+            int x, y;
+            Piece winner;
+            if (!ReadSessionId(in, id) || !(in >> x >> y))
+                reply("error usage: play <id> <x> <y>");
+            else if (!server.Play(id, x, y, winner, error))
+                reply("error " + error);
+            else if (winner != PIECE_EMPTY)
+                reply("win " + std::to_string(id) + " " + winnerName(winner));
+            else
+                reply("ok");
+        }
+        else if (command == "go")
+        {
+            int budget = SERVER_DEFAULT_BUDGET_MS;
+            if (!ReadSessionId(in, id))
+                reply("error usage: go <id> [budget_ms]");
+            else if ((in >> budget, !server.RequestMove(id, budget, error)))
+                reply("error " + error);
+        }
+        else if (command == "undo" || command == "close")
+        {
+            if (!ReadSessionId(in, id))
+                reply("error usage: " + command + " <id>");
+            else if (command == "undo" ? server.Undo(id, error) : server.Close(id, error))
+                reply("ok");
+            else
+                reply("error " + error);
+        }
+        else if (command == "moves")
+        {
+            std::string text;
+            if (!ReadSessionId(in, id))
+                reply("error usage: moves <id>");
+            else if (server.Moves(id, text, error))
+                reply("moves " + std::to_string(id) + (text.empty() ? "" : " ") + text);
+            else
+                reply("error " + error);
+        }
+        else if (command == "stats")
+        {
+            reply("stats " + server.Stats());
+        }
+        else if (command == "quit")
+        {
+            break;
+        }
+        else
+        {
+            reply("error unknown command " + command);
+        }
+    }
+    server.Drain();
+    reply("stats " + server.Stats());
+    return 0;
+}
+
+// 主函数
+// 可选参数:
+//   --workers <n>    工作线程数(默认为CPU核数),每个线程一个单线程的搜索引擎
+//   --load <n>       不读标准输入,模拟n个会话的负载,输出每步延迟的分位数
+//   --plies <n>      模拟时每个会话请求AI走的步数(默认10)
+//   --budget <ms>    模拟时每个请求的时间预算(默认50)
+//   --clients <n>    模拟时会话分给几个客户端(默认4,最多65536)
+//   --think <ms>     模拟时拿到走法之后隔多久再请求下一步(默认0)
+//   --size <n>       模拟时的棋盘大小(默认15)
+//   --seed <n>       模拟时第一步的随机种子
+//   --hash <MB> 等   与图形界面相同的引擎参数,置换表每个工作线程每种棋盘大小各一份(默认16MB)
+int main(int argc, char *argv[])
+{
+    AIConfig config;
+    config.hashMegabytes = TT_MIN_MB;
+    LoadConfig load;
+    int workers = std::max((int)std::thread::hardware_concurrency(), 1);
+    for (int i = 1; i < argc; i++)
+    {
+        if (ParseAIConfigArg(argc, argv, i, config))
+            continue;
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+            workers = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc)
+            load.sessions = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--plies") == 0 && i + 1 < argc)
+            load.plies = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+            load.budgetMs = std::min(std::max(atoi(argv[++i]), 1), SERVER_MAX_BUDGET_MS);
+        else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc)
+            load.clients = std::min(std::max(atoi(argv[++i]), 1), SERVER_MAX_CLIENTS);
+        else if (strcmp(argv[i], "--think") == 0 && i + 1 < argc)
+            load.thinkMs = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            load.size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            load.seed = (unsigned)atoi(argv[++i]);
+        else
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (!IsSupportedBoardSize(load.size))
+    {
+        std::cerr << "unsupported board size " << load.size << std::endl;
+        return 1;
+    }
+    std::string error;
+    if (!CheckAIConfigFiles(config, 0, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (load.sessions > 0)
+        return RunLoad(config, workers, load);
+    return RunProtocol(config, workers);
+}
@@ -0,0 +1,511 @@
+// 棋型权重的调优工具(Texel方法):从对局记录中取出安静的局面,按对局结果用逻辑回归拟合每个棋型一个子的分数
+// 棋型评估是各棋型子数之差的线性函数:分数 = sum(权重[p] * (黑方p棋型的子数 - 白方p棋型的子数)),
+// 所以每个局面只需要保存各棋型的子数之差和对局结果,每个局面13字节,几百万个局面也能放在内存里每一轮从头算
+// 模型:黑方胜率 = sigmoid(分数 / scale),损失为交叉熵;scale先用初始权重拟合后固定,调出的权重与原来的分数尺度一致,
+// 搜索中与分数有关的常数(期望窗口,MCTS的价值换算)不用跟着改
+// 梯度按批计算,每一批平均分给所有线程,各自累加部分和后合并
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "engine/record.h"
+#include "engine/search.h"
+
+// 参与拟合的棋型:单子到连活三;冲四和活四只出现在不安静的局面里,没有数据可以拟合,保持初始权重
+const int TUNE_FIRST_PATTERN = PATTERN_ONE;
+const int TUNE_FEATURES = PATTERN_THREE - PATTERN_ONE + 1;
+
+// 调优选项
+struct TuneConfig
+{
+    int boardSize = 15;
+    int threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    int epochs = 100;
+    int batchSize = 65536;
+    double learningRate = 1.0; // Adam每一步的幅度,以分数为单位
+    double scale = 0;          // 分数换算成胜率的尺度,0表示用初始权重拟合
+    int skipPlies = 6;         // 每盘跳过的开局步数
+    double validation = 0.1;   // 留出验证的局面比例
+    unsigned seed = 1;
+};
+
+// 所有局面,按局面连续存放:features[i * TUNE_FEATURES + f]是第i个局面第f个棋型的子数之差(黑减白)
+// results[i]是黑方的得分乘2:黑胜2,和棋1,白胜0
+struct Dataset
+{
+    std::vector<int16_t> features;
+    std::vector<uint8_t> results;
+
+    size_t Size() const { return results.size(); }
+};
+
+// 一段局面的损失和梯度之和
+struct alignas(64) PartialSums
+{
+    double loss = 0;
+    double grad[TUNE_FEATURES] = {};
+};
+
+double Sigmoid(double x)
+{
+    return 1.0 / (1.0 + std::exp(-x));
+}
+
+// 统计每个棋子在四个方向上的棋型,counts[颜色][棋型],一个棋型里的每个子各计一次,与评估的计分方式相同
+template <int N>
+void CountPatterns(const BitBoardT<N> &board, int (&counts)[2][PATTERN_COUNT])
+{
+    using Board = BitBoardT<N>;
+    memset(counts, 0, sizeof(counts));
+    for (int kind = 0; kind < 4; kind++)
+    {
+        for (int index = 0; index < IncrementalEvaluatorT<N>::LineCount(kind); index++)
+        {
+            uint32_t lines[2], span = Board::FULL_LINE;
+            for (int c = 0; c < 2; c++)
+            {
+                switch (kind)
+                {
+                case LINE_ROW:
+                    lines[c] = board.rows[c][index];
+                    break;
+                case LINE_COL:
+                    lines[c] = board.cols[c][index];
+                    break;
+                case LINE_DIAG:
+                    lines[c] = board.diags[c][index];
+                    span = Board::DiagSpan(index);
+                    break;
+                default:
+                    lines[c] = board.antiDiags[c][index];
+                    span = Board::DiagSpan(index);
+                    break;
+                }
+            }
+            for (int c = 0; c < 2; c++)
+            {
+                uint32_t stones = lines[c];
+                while (stones)
+                {
+                    int i = __builtin_ctz(stones);
+                    stones &= stones - 1;
+                    counts[c][LookupPattern(lines[c], lines[1 - c] | ~span, i).pattern]++;
+                }
+            }
+        }
+    }
+}
+
+// 安静的局面:没有五连,双方都没有冲四和活四,轮到的一方也没有活三
+// 不满足时下一两步就会分出胜负或者必须应对,静态评估说明不了局面的好坏
+bool IsQuiet(const int (&counts)[2][PATTERN_COUNT], int mover)
+{
+    for (int c = 0; c < 2; c++)
+    {
+        if (counts[c][PATTERN_FIVE] || counts[c][PATTERN_FOUR] || counts[c][PATTERN_OPEN_FOUR])
+            return false;
+    }
+    return counts[mover][PATTERN_THREE] == 0 && counts[mover][PATTERN_SPLIT_THREE] == 0;
+}
+
+// 按顺序重放一盘棋,把开局之后的安静局面加入data;返回加入的局面数
+// 遇到落在已有棋子上的走法或者已经连成五子时停止,后面的记录不用
+template <int N>
+long long ExtractPositions(const GameRecord &game, const TuneConfig &config, Dataset &data)
+{
+    // 黑方的得分乘2;没下完的棋没有结果
+    uint8_t result = (game.winner == PIECE_BLACK) ? 2 : (game.winner == PIECE_WHITE) ? 0 : 1;
+    PositionT<N> pos;
+    pos.Clear();
+    long long added = 0;
+    int counts[2][PATTERN_COUNT];
+    for (size_t ply = 0; ply < game.moves.size(); ply++)
+    {
+        const auto &move = game.moves[ply];
+        if (!pos.board.IsEmpty(move.first, move.second))
+            break;
+        if ((int)ply >= config.skipPlies)
+        {
+            CountPatterns(pos.board, counts);
+            if (IsQuiet(counts, (int)(ply % 2)))
+            {
+#ifndef NDEBUG
+                int score = 0;
+                for (int p = 0; p < PATTERN_COUNT; p++)
+                    score += PATTERN_STONE_SCORE[p] * (counts[0][p] - counts[1][p]);
+                assert(score == pos.EvaluateBoard());
+#endif
+                for (int f = 0; f < TUNE_FEATURES; f++)
+                {
+                    int p = TUNE_FIRST_PATTERN + f;
+                    data.features.push_back((int16_t)(counts[0][p] - counts[1][p]));
+                }
+                data.results.push_back(result);
+                added++;
+            }
+        }
+        pos.MakeMove(move.first, move.second, (ply % 2 == 0) ? PIECE_BLACK : PIECE_WHITE);
+        if (pos.CheckWin(move.first, move.second))
+            break;
+    }
+    return added;
+}
+
+// 固定的一组线程:每次Evaluate把一段局面平均分给所有线程(包括调用线程),各自算出部分和,
+// 调用线程等全部完成后按线程顺序合并,线程数相同时结果完全确定
+class GradientPool
+{
+public:
+    GradientPool(const Dataset &data, int threads) : data(data), partials(threads)
+    {
+        for (int id = 1; id < threads; id++)
+            workers.emplace_back([this, id]() { Work(id); });
+    }
+
+    ~GradientPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        start.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    // 在weights下计算[begin,end)的损失之和,gradient为true时同时算出梯度之和
+    PartialSums Evaluate(size_t begin, size_t end, const double (&weights)[TUNE_FEATURES], double scale, bool gradient)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job.begin = begin;
+            job.end = end;
+            std::copy(weights, weights + TUNE_FEATURES, job.weights);
+            job.scale = scale;
+            job.gradient = gradient;
+            pending = (int)workers.size();
+            generation++;
+        }
+        start.notify_all();
+        Compute(0);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return pending == 0; });
+        }
+        PartialSums total;
+        for (const PartialSums &part : partials)
+        {
+            total.loss += part.loss;
+            for (int f = 0; f < TUNE_FEATURES; f++)
+                total.grad[f] += part.grad[f];
+        }
+        return total;
+    }
+
+private:
+    struct Job
+    {
+        size_t begin = 0, end = 0;
+        double weights[TUNE_FEATURES] = {};
+        double scale = 1;
+        bool gradient = false;
+    };
+
+    const Dataset &data;
+    std::vector<PartialSums> partials; // 每个线程一份,按缓存行对齐,互不干扰
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start, done;
+    Job job;
+    long long generation = 0;
+    int pending = 0;
+    bool quit = false;
+
+    void Work(int id)
+    {
+        long long seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start.wait(lock, [&]() { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+            }
+            Compute(id);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            done.notify_one();
+        }
+    }
+
+    // 第id个线程负责的一段;job在所有线程完成之前不会改变
+    void Compute(int id)
+    {
+        size_t count = job.end - job.begin, threads = partials.size();
+        size_t begin = job.begin + count * id / threads, end = job.begin + count * (id + 1) / threads;
+        PartialSums sums;
+        double inverseScale = 1.0 / job.scale;
+        const int16_t *features = data.features.data();
+        for (size_t i = begin; i < end; i++)
+        {
+            const int16_t *x = features + i * TUNE_FEATURES;
+            double score = 0;
+            for (int f = 0; f < TUNE_FEATURES; f++)
+                score += job.weights[f] * x[f];
+            double target = data.results[i] * 0.5;
+            double p = Sigmoid(score * inverseScale);
+            double clamped = std::min(std::max(p, 1e-12), 1.0 - 1e-12);
+            sums.loss -= target * std::log(clamped) + (1.0 - target) * std::log(1.0 - clamped);
+            if (job.gradient)
+            {
+                double error = (p - target) * inverseScale;
+                for (int f = 0; f < TUNE_FEATURES; f++)
+                    sums.grad[f] += error * x[f];
+            }
+        }
+        partials[id] = sums;
+    }
+};
+
+// 平均损失
+double MeanLoss(GradientPool &pool, size_t begin, size_t end, const double (&weights)[TUNE_FEATURES], double scale)
+{
+    return (end > begin) ? pool.Evaluate(begin, end, weights, scale, false).loss / (end - begin) : 0.0;
+}
+
+// 固定权重,在对数尺度上三分搜索使训练集损失最小的scale
+double FitScale(GradientPool &pool, size_t count, const double (&weights)[TUNE_FEATURES])
+{
+    double low = std::log(10.0), high = std::log(100000.0);
+    for (int step = 0; step < 60; step++)
+    {
+        double a = low + (high - low) / 3, b = high - (high - low) / 3;
+        if (MeanLoss(pool, 0, count, weights, std::exp(a)) < MeanLoss(pool, 0, count, weights, std::exp(b)))
+            high = b;
+        else
+            low = a;
+    }
+    return std::exp((low + high) / 2);
+}
+
+// 取整并截断到引擎接受的范围,写回weights
+void RoundWeights(double (&weights)[TUNE_FEATURES])
+{
+    for (int f = 0; f < TUNE_FEATURES; f++)
+        weights[f] = std::min(std::max(std::round(weights[f]), 0.0), (double)PATTERN_WEIGHT_LIMIT);
+}
+
+int Tune(const TuneConfig &config, Dataset &data, const PatternWeights &initial, const std::string &outPath)
+{
+    // 打乱一次后把局面按新顺序重新排列,之后每一批都是连续的一段
+    std::mt19937 rng(config.seed);
+    std::vector<size_t> order(data.Size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    Dataset shuffled;
+    shuffled.features.resize(data.features.size());
+    shuffled.results.resize(data.results.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        std::copy_n(&data.features[order[i] * TUNE_FEATURES], TUNE_FEATURES, &shuffled.features[i * TUNE_FEATURES]);
+        shuffled.results[i] = data.results[order[i]];
+    }
+    data = Dataset();
+
+    size_t total = shuffled.Size();
+    size_t trainCount = total - (size_t)(total * config.validation);
+    if (trainCount == 0)
+    {
+        std::cerr << "no training positions" << std::endl;
+        return 1;
+    }
+    GradientPool pool(shuffled, config.threads);
+
+    double start[TUNE_FEATURES], weights[TUNE_FEATURES];
+    for (int f = 0; f < TUNE_FEATURES; f++)
+        start[f] = weights[f] = initial.Score(TUNE_FIRST_PATTERN + f);
+    double scale = config.scale > 0 ? config.scale : FitScale(pool, trainCount, start);
+    double startTrain = MeanLoss(pool, 0, trainCount, start, scale);
+    double startValidation = MeanLoss(pool, trainCount, total, start, scale);
+    printf("scale %.1f  initial train loss %.6f  validation loss %.6f\n", scale, startTrain, startValidation);
+
+    // Adam:各个棋型的子数相差很大,按梯度的历史幅度归一化后每个权重每步移动的幅度相近
+    double m[TUNE_FEATURES] = {}, v[TUNE_FEATURES] = {};
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-12;
+    long long step = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int epoch = 1; epoch <= config.epochs; epoch++)
+    {
+        double loss = 0;
+        for (size_t first = 0; first < trainCount; first += config.batchSize)
+        {
+            size_t last = std::min(first + (size_t)config.batchSize, trainCount);
+            PartialSums sums = pool.Evaluate(first, last, weights, scale, true);
+            loss += sums.loss;
+            step++;
+            double correction1 = 1.0 - std::pow(beta1, (double)step);
+            double correction2 = 1.0 - std::pow(beta2, (double)step);
+            for (int f = 0; f < TUNE_FEATURES; f++)
+            {
+                double g = sums.grad[f] / (last - first);
+                m[f] = beta1 * m[f] + (1.0 - beta1) * g;
+                v[f] = beta2 * v[f] + (1.0 - beta2) * g * g;
+                weights[f] -= config.learningRate * (m[f] / correction1) / (std::sqrt(v[f] / correction2) + epsilon);
+                weights[f] = std::min(std::max(weights[f], 0.0), (double)PATTERN_WEIGHT_LIMIT);
+            }
+        }
+        if (epoch % 10 == 0 || epoch == config.epochs)
+        {
+            printf("epoch %d  train loss %.6f  validation loss %.6f\n", epoch, loss / trainCount,
+                   MeanLoss(pool, trainCount, total, weights, scale));
+            fflush(stdout);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    RoundWeights(weights);
+    double finalTrain = MeanLoss(pool, 0, trainCount, weights, scale);
+    double finalValidation = MeanLoss(pool, trainCount, total, weights, scale);
+    printf("%-14s %7s %7s\n", "pattern", "before", "after");
+    int values[PATTERN_COUNT];
+    for (int p = 0; p < PATTERN_COUNT; p++)
+        values[p] = initial.Score(p);
+    for (int f = 0; f < TUNE_FEATURES; f++)
+    {
+        int p = TUNE_FIRST_PATTERN + f;
+        values[p] = (int)weights[f];
+        printf("%-14s %7d %7d\n", PatternWeights::PatternName(p), initial.Score(p), values[p]);
+    }
+    printf("rounded: train loss %.6f  validation loss %.6f (initial %.6f)\n", finalTrain, finalValidation,
+           startValidation);
+    double positionsPerSecond = seconds > 0 ? (double)trainCount * config.epochs / seconds : 0.0;
+    printf("%zu training positions, %zu validation, %d threads, %.1fM positions/s\n", trainCount, total - trainCount,
+           config.threads, positionsPerSecond / 1e6);
+
+    PatternWeights tuned;
+    tuned.Set(values);
+    char comment[256];
+    snprintf(comment, sizeof(comment), "gomoku-tune: %zu positions, scale %.1f\nvalidation loss %.6f -> %.6f", total,
+             scale, startValidation, finalValidation);
+    if (!tuned.Save(outPath, comment))
+    {
+        std::cerr << "cannot write " << outPath << std::endl;
+        return 1;
+    }
+    printf("-> %s\n", outPath.c_str());
+    return 0;
+}
+
+// 主函数
+// 用法: gomoku-tune [选项] <对局记录>...
+// 可选参数:
+//   --out <file>     输出的权重文件(默认 pattern.weights),引擎用 --weights <file> 加载
+//   --init <file>    初始权重文件,默认从引擎的默认权重开始
+//   --size <n>       棋盘大小(默认15),其他大小的对局跳过
+//   --threads <n>    计算梯度的线程数(默认为CPU核数)
+//   --epochs <n>     训练轮数(默认100)
+//   --batch <n>      每批局面数(默认65536)
+//   --lr <x>         Adam每一步的幅度,以分数为单位(默认1.0)
+//   --scale <x>      分数换算成胜率的尺度,默认用初始权重拟合
+//   --skip <n>       每盘跳过的开局步数(默认6)
+//   --validation <x> 留出验证的局面比例(默认0.1)
+//   --seed <n>       随机数种子(默认1)
+int main(int argc, char *argv[])
+{
+    TuneConfig config;
+    std::string outPath = "pattern.weights", initPath;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if (strcmp(argv[i], "--init") == 0 && i + 1 < argc)
+            initPath = argv[++i];
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            config.boardSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            config.threads = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--epochs") == 0 && i + 1 < argc)
+            config.epochs = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            config.batchSize = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--lr") == 0 && i + 1 < argc)
+            config.learningRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+            config.scale = std::max(atof(argv[++i]), 0.0);
+        else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc)
+            config.skipPlies = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--validation") == 0 && i + 1 < argc)
+            config.validation = std::min(std::max(atof(argv[++i]), 0.0), 0.5);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            config.seed = (unsigned)atoi(argv[++i]);
+        else if (argv[i][0] == '-')
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty() || !IsSupportedBoardSize(config.boardSize))
+    {
+        std::cerr << "usage: gomoku-tune [--out <file>] [--init <file>] [--size 15|19] [--threads <n>] <records>..."
+                  << std::endl;
+        return 1;
+    }
+    PatternWeights initial;
+    if (!initPath.empty() && !initial.Load(initPath))
+    {
+        std::cerr << "cannot read weights " << initPath << std::endl;
+        return 1;
+    }
+
+    Dataset data;
+    long long games = 0, skippedGames = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (const std::string &path : paths)
+    {
+        GameRecordReader reader;
+        if (!reader.Open(path))
+        {
+            std::cerr << "cannot read " << path << std::endl;
+            return 1;
+        }
+        GameRecord game;
+        while (reader.Next(game))
+        {
+            // 只用分出胜负或者下满棋盘的对局
+            if (game.boardSize != config.boardSize || !game.finished)
+            {
+                skippedGames++;
+                continue;
+            }
+            if (config.boardSize == 19)
+                ExtractPositions<19>(game, config, data);
+            else
+                ExtractPositions<15>(game, config, data);
+            games++;
+        }
+        if (reader.Corrupted())
+            std::cerr << path << ": corrupted record, stopped reading" << std::endl;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    printf("%lld games, %lld skipped, %zu quiet positions (%.1f MB) in %.1fs\n", games, skippedGames, data.Size(),
+           (data.features.size() * sizeof(int16_t) + data.results.size()) / 1048576.0, seconds);
+    return Tune(config, data, initial, outPath);
+}
@@ -0,0 +1,750 @@
+// 对局比赛工具:让两个引擎(两组参数,或者两个版本编译出的无界面AI程序)自动对局,用来检验修改是否真的变强
+// 多个对局在线程池中同时进行,每个线程持有一对选手;开局取自固定的列表,同一开局双方各执一次黑棋,
+// 可以用SPRT(序贯概率比检验)在结果足够明确时提前停止;输出Elo差,95%置信区间和每秒对局数
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "engine/search.h"
+#include "engine/record.h"
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// 开局:开局的几步棋,之后由双方引擎接着下
+struct Opening
+{
+    std::string name;
+    std::vector<std::pair<int, int>> moves;
+};
+
+// 一方选手的设置:exe为空时在本进程内用config搜索,否则启动exe(使用Gomocup协议的AI程序),args为它的命令行参数
+struct PlayerSpec
+{
+    std::string name;
+    AIConfig config;
+    std::string exe;
+    std::vector<std::string> args;
+};
+
+// 比赛的设置
+struct MatchConfig
+{
+    int games = 1000;        // 最多对局数,按开局成对进行,取偶数
+    int concurrency = 1;     // 同时进行的对局数
+    bool sprt = false;       // 是否用SPRT提前停止
+    double elo0 = 0;         // SPRT的原假设:A比B强elo0
+    double elo1 = 5;         // SPRT的备择假设:A比B强elo1
+    double alpha = 0.05;     // 第一类错误率
+    double beta = 0.05;      // 第二类错误率
+    int reportEvery = 100;   // 每多少盘输出一次进度
+};
+
+// 选手接口:一盘棋开始时调用NewGame,之后每轮到它时调用Move;返回false表示选手出错,按负处理
+class MatchPlayer
+{
+public:
+    virtual ~MatchPlayer() = default;
+    virtual bool NewGame() = 0;
+    virtual bool Move(const Position &pos, const std::vector<std::pair<int, int>> &moves, Piece side,
+                      std::pair<int, int> &move) = 0;
+};
+
+// 本进程内的搜索引擎
+class EnginePlayer : public MatchPlayer
+{
+public:
+    explicit EnginePlayer(const AIConfig &config)
+    {
+        engine.Configure(config);
+    }
+
+    bool NewGame() override
+    {
+        engine.NewGame();
+        return true;
+    }
+
+    bool Move(const Position &pos, const std::vector<std::pair<int, int>> &, Piece side, std::pair<int, int> &move) override
+    {
+        move = engine.Think(pos, side).bestMove;
+        return true;
+    }
+
+private:
+    SearchEngine engine;
+};
+
+#ifndef _WIN32
+// 外部程序每步的应答时间:INFO timeout_turn之外再多等这么久(进程调度和管道的延迟),
+// 超时按负处理;其余命令(START等)和不限时的走法最多等PROCESS_COMMAND_TIMEOUT_MS
+const int PROCESS_REPLY_GRACE_MS = 1000;
+const int PROCESS_COMMAND_TIMEOUT_MS = 10000;
+
+// 外部的AI程序,通过管道使用Gomocup协议:每一步用BOARD命令给出整个局面,不依赖对方程序保存的状态
+// 程序退出或者应答超时时杀掉它,这一盘判负,下一盘开始时重新启动
+class ProcessPlayer : public MatchPlayer
+{
+public:
+    ProcessPlayer(const std::string &exe, const std::vector<std::string> &args, int moveTimeMs)
+        : turnMs(moveTimeMs)
+    {
+        // fork之后子进程只能调用异步信号安全的函数,参数表在fork之前准备好
+        argvStorage.push_back(exe);
+        argvStorage.insert(argvStorage.end(), args.begin(), args.end());
+        for (std::string &arg : argvStorage)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+    }
+
+    ~ProcessPlayer() override
+    {
+        if (pid > 0)
+            Send("END");
+        Stop(false);
+    }
+
+    bool NewGame() override
+    {
+        if (pid <= 0 && !Start())
+            return false;
+        std::string reply;
+        if (!Send(started ? "RESTART" : "START " + std::to_string(BOARD_SIZE)) ||
+            !ReadReply(reply, PROCESS_COMMAND_TIMEOUT_MS) || reply != "OK")
+        {
+            Stop(true);
+            return false;
+        }
+        started = true;
+        return Send("INFO timeout_turn " + std::to_string(turnMs));
+    }
+
+    bool Move(const Position &pos, const std::vector<std::pair<int, int>> &moves, Piece side, std::pair<int, int> &move) override
+    {
+        if (pid <= 0)
+            return false;
+        std::string board = "BOARD";
+        for (const auto &m : moves)
+        {
+            int field = (pos.board.At(m.first, m.second) == side) ? 1 : 2;
+            board += "\n" + std::to_string(m.first) + "," + std::to_string(m.second) + "," + std::to_string(field);
+        }
+        board += "\nDONE";
+        std::string reply;
+        int timeoutMs = (turnMs > 0) ? turnMs + PROCESS_REPLY_GRACE_MS : PROCESS_COMMAND_TIMEOUT_MS;
+        if (!Send(board) || !ReadReply(reply, timeoutMs))
+        {
+            Stop(true);
+            return false;
+        }
+        return sscanf(reply.c_str(), "%d,%d", &move.first, &move.second) == 2;
+    }
+
+private:
+    std::vector<std::string> argvStorage;
+    std::vector<char *> argv;
+    pid_t pid = -1;
+    int out = -1;       // 写到子进程的标准输入
+    int in = -1;        // 读子进程的标准输出
+    std::string buffer; // 已经读到但还没有取走的输出
+    bool started = false;
+    int turnMs;
+
+    // 管道的两端都设置close-on-exec,同时运行的其他外部程序不会继承它们,
+    // 否则一个程序退出后,管道的写端还开在别的程序里,这边永远读不到EOF
+    static bool MakePipe(int fds[2])
+    {
+#ifdef __linux__
+        return pipe2(fds, O_CLOEXEC) == 0;
+#else
+        if (pipe(fds) != 0)
+            return false;
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+#endif
+    }
+
+    bool Start()
+    {
+        int toChild[2], fromChild[2];
+        if (!MakePipe(toChild))
+            return false;
+        if (!MakePipe(fromChild))
+        {
+            close(toChild[0]);
+            close(toChild[1]);
+            return false;
+        }
+        pid = fork();
+        if (pid == 0)
+        {
+            // dup2得到的标准输入输出不带close-on-exec,其余的描述符在execv时关闭
+            dup2(toChild[0], STDIN_FILENO);
+            dup2(fromChild[1], STDOUT_FILENO);
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+        close(toChild[0]);
+        close(fromChild[1]);
+        if (pid < 0)
+        {
+            close(toChild[1]);
+            close(fromChild[0]);
+            return false;
+        }
+        out = toChild[1];
+        in = fromChild[0];
+        buffer.clear();
+        started = false;
+        return true;
+    }
+
+    // 关闭管道并等待子进程退出;kill为true时先杀掉它(程序出错或者卡住)
+    void Stop(bool kill)
+    {
+        if (out >= 0)
+            close(out);
+        if (in >= 0)
+            close(in);
+        out = in = -1;
+        if (pid > 0)
+        {
+            if (kill)
+                ::kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+        pid = -1;
+    }
+
+    bool Send(const std::string &text)
+    {
+        std::string line = text + "\n";
+        for (size_t done = 0; done < line.size();)
+        {
+            ssize_t n = write(out, line.data() + done, line.size() - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            done += (size_t)n;
+        }
+        return true;
+    }
+
+    // 在timeoutMs之内读取一行应答,跳过MESSAGE和DEBUG;超时,EOF或者ERROR应答时返回false
+    bool ReadReply(std::string &reply, int timeoutMs)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (true)
+        {
+            size_t end = buffer.find('\n');
+            if (end != std::string::npos)
+            {
+                reply = buffer.substr(0, end);
+                buffer.erase(0, end + 1);
+                while (!reply.empty() && (reply.back() == '\r' || reply.back() == ' '))
+                    reply.pop_back();
+                if (reply.compare(0, 7, "MESSAGE") != 0 && reply.compare(0, 5, "DEBUG") != 0)
+                    return reply.compare(0, 5, "ERROR") != 0;
+                continue;
+            }
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0)
+                return false;
+            pollfd fd = {in, POLLIN, 0};
+            int ready = poll(&fd, 1, (int)left.count());
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready <= 0)
+                return false;
+            char chunk[4096];
+            ssize_t n = read(in, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            buffer.append(chunk, (size_t)n);
+        }
+    }
+};
+#endif
+
+std::unique_ptr<MatchPlayer> CreatePlayer(const PlayerSpec &spec)
+{
+    if (spec.exe.empty())
+        return std::unique_ptr<MatchPlayer>(new EnginePlayer(spec.config));
+#ifndef _WIN32
+    return std::unique_ptr<MatchPlayer>(new ProcessPlayer(spec.exe, spec.args, spec.config.moveTimeMs));
+#else
+    return nullptr;
+#endif
+}
+
+// 标准的26种三子开局:黑子天元,白子直接相邻(直指)或斜向相邻(斜指),第三子(黑)在天元周围5x5的范围内,
+// 关于前两子所在直线对称的两个位置只取一个,直指和斜指各13种
+std::vector<Opening> StandardOpenings()
+{
+    std::vector<Opening> openings;
+    const int c = BOARD_SIZE / 2;
+    for (int kind = 0; kind < 2; kind++)
+    {
+        int wx = (kind == 0) ? 0 : 1, wy = -1;
+        int index = 0;
+        for (int dy = -2; dy <= 2; dy++)
+        {
+            for (int dx = -2; dx <= 2; dx++)
+            {
+                if ((dx == 0 && dy == 0) || (dx == wx && dy == wy))
+                    continue;
+                // 直指关于竖线对称,斜指关于经过两子的斜线对称
+                int mx = (kind == 0) ? -dx : -dy, my = (kind == 0) ? dy : -dx;
+                if (std::make_pair(mx, my) < std::make_pair(dx, dy))
+                    continue;
+                char name[32];
+                snprintf(name, sizeof(name), "%s-%02d", kind == 0 ? "direct" : "indirect", ++index);
+                openings.push_back({name, {{c, c}, {c + wx, c + wy}, {c + dx, c + dy}}});
+            }
+        }
+    }
+    return openings;
+}
+
+// 读取开局文件,每行一个开局,形如"x,y"的词是落子,第一个词不是落子时作为名字;
+// 所以基准测试的局面文件("名字 类别 x,y ...")和棋谱文件都可以直接使用;空行和#开头的行忽略
+// 开局中有重复的落子或者已经连成五子时报出行号并返回false
+bool LoadOpenings(const std::string &path, std::vector<Opening> &openings)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "cannot open openings " << path << std::endl;
+        return false;
+    }
+    openings.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream in(line);
+        Opening opening;
+        std::string word;
+        while (in >> word)
+        {
+            int x, y;
+            if (sscanf(word.c_str(), "%d,%d", &x, &y) == 2 && x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE)
+                opening.moves.emplace_back(x, y);
+            else if (opening.name.empty() && opening.moves.empty())
+                opening.name = word;
+        }
+        if (opening.moves.empty())
+            continue;
+        Position pos;
+        pos.Clear();
+        Piece side = PIECE_BLACK;
+        for (const auto &move : opening.moves)
+        {
+            if (!pos.board.IsEmpty(move.first, move.second))
+            {
+                std::cerr << path << ":" << lineNumber << ": repeated move " << move.first << "," << move.second
+                          << std::endl;
+                return false;
+            }
+            pos.MakeMove(move.first, move.second, side);
+            if (pos.CheckWin(move.first, move.second))
+            {
+                std::cerr << path << ":" << lineNumber << ": opening already has five in a row" << std::endl;
+                return false;
+            }
+            side = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+        }
+        if (opening.name.empty())
+            opening.name = "opening-" + std::to_string(openings.size() + 1);
+        openings.push_back(opening);
+    }
+    return !openings.empty();
+}
+
+// 一盘的结果
+enum GameOutcome
+{
+    OUTCOME_A_WIN,
+    OUTCOME_B_WIN,
+    OUTCOME_DRAW
+};
+
+// 下一盘棋:先摆开局,再由双方接着下,直到成五或下满棋盘;选手出错或走了非法的棋判负
+GameOutcome PlayGame(MatchPlayer &black, MatchPlayer &white, bool aIsBlack, const Opening &opening, GameRecord &record)
+{
+    Position pos;
+    pos.Clear();
+    record = GameRecord();
+    record.startTime = (uint32_t)time(nullptr);
+    auto start = std::chrono::steady_clock::now();
+    Piece side = PIECE_BLACK;
+    Piece winner = PIECE_EMPTY;
+    bool ok = black.NewGame() && white.NewGame();
+    for (size_t ply = 0; ok && (int)ply < BOARD_SIZE * BOARD_SIZE; ply++)
+    {
+        std::pair<int, int> move;
+        if (ply < opening.moves.size())
+        {
+            // 读取时已经检查过,这里再挡一次,开局没摆完的一盘不计分
+            move = opening.moves[ply];
+            if (!pos.board.IsEmpty(move.first, move.second))
+            {
+                std::cerr << "opening " << opening.name << " repeats " << move.first << "," << move.second << std::endl;
+                break;
+            }
+        }
+        else
+        {
+            MatchPlayer &player = (side == PIECE_BLACK) ? black : white;
+            if (!player.Move(pos, record.moves, side, move) || move.first < 0 || move.first >= BOARD_SIZE ||
+                move.second < 0 || move.second >= BOARD_SIZE || !pos.board.IsEmpty(move.first, move.second))
+            {
+                std::cerr << (side == PIECE_BLACK ? "black" : "white") << " failed to move in " << opening.name
+                          << ", game lost" << std::endl;
+                winner = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+                break;
+            }
+        }
+        pos.MakeMove(move.first, move.second, side);
+        record.moves.push_back(move);
+        if (pos.CheckWin(move.first, move.second))
+        {
+            winner = side;
+            break;
+        }
+        side = (side == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+    }
+    record.winner = winner;
+    record.finished = winner != PIECE_EMPTY || (int)record.moves.size() == BOARD_SIZE * BOARD_SIZE;
+    record.durationMs = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    if (winner == PIECE_EMPTY)
+        return OUTCOME_DRAW;
+    return ((winner == PIECE_BLACK) == aIsBlack) ? OUTCOME_A_WIN : OUTCOME_B_WIN;
+}
+
+// 比赛的累计结果,全部从A的角度
+struct MatchStats
+{
+    long long wins = 0, losses = 0, draws = 0;
+    long long moves = 0;
+
+    long long Games() const { return wins + losses + draws; }
+
+    double Score() const
+    {
+        return Games() ? (wins + 0.5 * draws) / Games() : 0.5;
+    }
+
+    // 每盘得分(1,0.5,0)的方差
+    double Variance() const
+    {
+        if (Games() == 0)
+            return 0;
+        double m = Score();
+        return (wins * (1 - m) * (1 - m) + draws * (0.5 - m) * (0.5 - m) + losses * m * m) / Games();
+    }
+};
+
+// 得分率和Elo差的换算
+double EloFromScore(double score)
+{
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+double ScoreFromElo(double elo)
+{
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+// SPRT的对数似然比,用得分的正态近似
+double LogLikelihoodRatio(const MatchStats &stats, double elo0, double elo1)
+{
+    double variance = stats.Variance();
+    if (stats.Games() == 0 || variance <= 0)
+        return 0;
+    double s0 = ScoreFromElo(elo0), s1 = ScoreFromElo(elo1);
+    return stats.Games() * (s1 - s0) * (2 * stats.Score() - s0 - s1) / (2 * variance);
+}
+
+// Elo差和95%置信区间的文字:得分率的区间在(0,1)之内时输出"+x +/- y",
+// 超出时超出的一侧没有界,输出不对称的区间;方差为0(全胜,全负或全和)时正态近似给不出区间
+std::string FormatElo(const MatchStats &stats)
+{
+    long long games = stats.Games();
+    double score = stats.Score();
+    char text[128];
+    auto bound = [](double s, char *out, size_t size)
+    {
+        if (s <= 0 || s >= 1)
+            snprintf(out, size, "%s", s <= 0 ? "-inf" : "+inf");
+        else
+            snprintf(out, size, "%+.1f", EloFromScore(s));
+    };
+    char elo[32];
+    bound(score, elo, sizeof(elo));
+    if (score > 0 && score < 1 && std::fabs(EloFromScore(score)) < 0.05)
+        snprintf(elo, sizeof(elo), "+0.0"); // 不输出-0.0
+    double variance = stats.Variance();
+    if (games == 0 || variance <= 0)
+    {
+        snprintf(text, sizeof(text), "elo %s (no interval)", elo);
+        return text;
+    }
+    double margin = 1.96 * std::sqrt(variance / games);
+    double low = score - margin, high = score + margin;
+    if (low > 0 && high < 1)
+    {
+        snprintf(text, sizeof(text), "elo %s +/- %.1f", elo, (EloFromScore(high) - EloFromScore(low)) / 2);
+        return text;
+    }
+    char lowText[32], highText[32];
+    bound(low, lowText, sizeof(lowText));
+    bound(high, highText, sizeof(highText));
+    snprintf(text, sizeof(text), "elo %s [%s, %s]", elo, lowText, highText);
+    return text;
+}
+
+void PrintStats(const MatchStats &stats, const MatchConfig &match, double seconds)
+{
+    long long games = stats.Games();
+    printf("games %lld  +%lld -%lld =%lld  score %.1f%%  %s", games, stats.wins, stats.losses, stats.draws,
+           100 * stats.Score(), FormatElo(stats).c_str());
+    if (match.sprt)
+    {
+        printf("  LLR %.2f [%.2f, %.2f]", LogLikelihoodRatio(stats, match.elo0, match.elo1),
+               std::log(match.beta / (1 - match.alpha)), std::log((1 - match.beta) / match.alpha));
+    }
+    printf("  %.2f games/s  %.1f moves/game\n", seconds > 0 ? games / seconds : 0.0,
+           games ? (double)stats.moves / games : 0.0);
+    fflush(stdout);
+}
+
+// 把一组选手参数拆成单词,用ParseAIConfigArg解析;外部程序的参数原样传给它
+bool ParsePlayerOptions(const std::string &options, PlayerSpec &spec)
+{
+    std::istringstream in(options);
+    std::string word;
+    while (in >> word)
+        spec.args.push_back(word);
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>("player"));
+    for (std::string &arg : spec.args)
+        argv.push_back(&arg[0]);
+    for (int i = 1; i < (int)argv.size(); i++)
+    {
+        if (!ParseAIConfigArg((int)argv.size(), argv.data(), i, spec.config) && spec.exe.empty())
+        {
+            std::cerr << "unknown option " << argv[i] << " for " << spec.name << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 主函数
+// 可选参数:
+//   --a "<options>", --b "<options>"  两个选手各自的引擎参数,与图形界面相同,例如 --b "--leaf-vcf 0"
+//   --a-exe <file>, --b-exe <file>    选手是外部的AI程序(例如另一个版本编译的pbrain-gomoku),上面的参数作为它的命令行参数,
+//                                     --movetime作为每步的时间通过INFO timeout_turn告诉它
+//   --games <n>          最多对局数(默认1000)
+//   --concurrency <n>    同时进行的对局数(默认为CPU核数)
+//   --openings <file>    开局文件,每行一个开局,默认使用26种标准三子开局
+//   --sprt <elo0> <elo1> 用SPRT在A比B强elo0和强elo1两个假设之间检验,结果明确时提前停止
+//   --alpha <p>, --beta <p> SPRT的两类错误率(默认都是0.05)
+//   --records <file>     把所有对局写成对局记录,可以用gomoku-analyze分析
+//   --report <n>         每n盘输出一次进度(默认100)
+//   其余的引擎参数(--movetime, --nodes, --hash 等)对双方都起作用,默认每步50毫秒,单线程,16MB置换表,不用开局库
+int main(int argc, char *argv[])
+{
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN); // 外部程序退出后写管道不能让比赛进程退出
+#endif
+    AIConfig base;
+    base.moveTimeMs = 50;
+    base.hashMegabytes = 16;
+    MatchConfig match;
+    match.concurrency = std::max((int)std::thread::hardware_concurrency(), 1);
+    std::string optionsA, optionsB, exeA, exeB, openingsPath, recordsPath;
+    for (int i = 1; i < argc; i++)
+    {
+        if (ParseAIConfigArg(argc, argv, i, base))
+            continue;
+        if (strcmp(argv[i], "--a") == 0 && i + 1 < argc)
+            optionsA = argv[++i];
+        else if (strcmp(argv[i], "--b") == 0 && i + 1 < argc)
+            optionsB = argv[++i];
+        else if (strcmp(argv[i], "--a-exe") == 0 && i + 1 < argc)
+            exeA = argv[++i];
+        else if (strcmp(argv[i], "--b-exe") == 0 && i + 1 < argc)
+            exeB = argv[++i];
+        else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+            match.games = std::max(atoi(argv[++i]), 2);
+        else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc)
+            match.concurrency = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--openings") == 0 && i + 1 < argc)
+            openingsPath = argv[++i];
+        else if (strcmp(argv[i], "--sprt") == 0 && i + 2 < argc)
+        {
+            match.sprt = true;
+            match.elo0 = atof(argv[++i]);
+            match.elo1 = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc)
+            match.alpha = atof(argv[++i]);
+        else if (strcmp(argv[i], "--beta") == 0 && i + 1 < argc)
+            match.beta = atof(argv[++i]);
+        else if (strcmp(argv[i], "--records") == 0 && i + 1 < argc)
+            recordsPath = argv[++i];
+        else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc)
+            match.reportEvery = std::max(atoi(argv[++i]), 1);
+        else
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    match.games += match.games % 2;
+#ifdef _WIN32
+    if (!exeA.empty() || !exeB.empty())
+    {
+        std::cerr << "external engines are not supported on this platform" << std::endl;
+        return 1;
+    }
+#endif
+
+    PlayerSpec specA, specB;
+    specA.name = "A";
+    specB.name = "B";
+    specA.config = specB.config = base;
+    specA.exe = exeA;
+    specB.exe = exeB;
+    if (!ParsePlayerOptions(optionsA, specA) || !ParsePlayerOptions(optionsB, specB))
+        return 1;
+    // 本进程内的选手在工作线程中才创建引擎,配置的文件不能用时在开始之前就停止
+    for (const PlayerSpec *spec : {&specA, &specB})
+    {
+        std::string error;
+        if (spec->exe.empty() && !CheckAIConfigFiles(spec->config, BOARD_SIZE, error))
+        {
+            std::cerr << spec->name << ": " << error << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Opening> openings = StandardOpenings();
+    if (!openingsPath.empty() && !LoadOpenings(openingsPath, openings))
+        return 1;
+
+    GameRecordWriter records;
+    if (!recordsPath.empty() && !records.Open(recordsPath))
+    {
+        std::cerr << "cannot write " << recordsPath << std::endl;
+        return 1;
+    }
+
+    printf("A: %s %s\nB: %s %s\n", exeA.empty() ? "engine" : exeA.c_str(), optionsA.c_str(),
+           exeB.empty() ? "engine" : exeB.c_str(), optionsB.c_str());
+    printf("%d openings, up to %d games, %d concurrent\n", (int)openings.size(), match.games, match.concurrency);
+
+    std::mutex statsMutex;
+    MatchStats stats;
+    std::atomic<int> nextGame(0);
+    std::atomic<bool> stop(false);
+    std::atomic<bool> failed(false);
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&]()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    // 第2k盘和第2k+1盘用同一个开局,A分别执黑和执白
+    auto worker = [&]()
+    {
+        std::unique_ptr<MatchPlayer> playerA = CreatePlayer(specA);
+        std::unique_ptr<MatchPlayer> playerB = CreatePlayer(specB);
+        while (!stop.load())
+        {
+            int game = nextGame.fetch_add(1);
+            if (game >= match.games)
+                break;
+            const Opening &opening = openings[(game / 2) % openings.size()];
+            bool aIsBlack = game % 2 == 0;
+            GameRecord record;
+            GameOutcome outcome = aIsBlack ? PlayGame(*playerA, *playerB, true, opening, record)
+                                           : PlayGame(*playerB, *playerA, false, opening, record);
+            record.moveTimeMs = base.moveTimeMs;
+
+            std::lock_guard<std::mutex> lock(statsMutex);
+            if (record.moves.size() < opening.moves.size())
+            {
+                // 连开局都没摆完,说明选手启动失败或者开局不合法
+                failed.store(true);
+                stop.store(true);
+                break;
+            }
+            if (records.IsOpen())
+                records.Write(record);
+            if (outcome == OUTCOME_A_WIN)
+                stats.wins++;
+            else if (outcome == OUTCOME_B_WIN)
+                stats.losses++;
+            else
+                stats.draws++;
+            stats.moves += (long long)record.moves.size();
+            if (stats.Games() % match.reportEvery == 0)
+                PrintStats(stats, match, elapsed());
+            if (match.sprt)
+            {
+                double llr = LogLikelihoodRatio(stats, match.elo0, match.elo1);
+                if (llr <= std::log(match.beta / (1 - match.alpha)) || llr >= std::log((1 - match.beta) / match.alpha))
+                    stop.store(true);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < match.concurrency; t++)
+        threads.emplace_back(worker);
+    for (std::thread &thread : threads)
+        thread.join();
+    records.Flush();
+
+    if (failed.load())
+        std::cerr << "a player could not start a game or an opening is invalid, match aborted" << std::endl;
+    printf("final: ");
+    PrintStats(stats, match, elapsed());
+    if (match.sprt)
+    {
+        double llr = LogLikelihoodRatio(stats, match.elo0, match.elo1);
+        const char *verdict = (llr >= std::log((1 - match.beta) / match.alpha))  ? "H1 accepted (A is stronger by elo1)"
+                              : (llr <= std::log(match.beta / (1 - match.alpha))) ? "H0 accepted (A is not stronger by elo1)"
+                                                                                   : "inconclusive";
+        printf("SPRT elo0=%.1f elo1=%.1f alpha=%.2f beta=%.2f: %s\n", match.elo0, match.elo1, match.alpha, match.beta, verdict);
+    }
+    return failed.load() ? 1 : 0;
+}